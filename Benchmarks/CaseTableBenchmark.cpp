@@ -0,0 +1,167 @@
+/*
+Compares the walk over triangleConnectionTable to its -1 end, which the mesher used to do for every cube,
+with the per case tables MarchingCubeData::cubeCases derives at compile time.
+The cubes are the cubes of a noisy field that the surface passes through, in the order the mesher visits them.
+
+Build and run from the repository root:
+	g++ -std=c++17 -O2 -IBenchmarks -ITerrain Benchmarks/CaseTableBenchmark.cpp Terrain/MarchingCubeData.cpp -o caseTableBenchmark
+	./caseTableBenchmark [size]
+*/
+#include "pch.h"
+#include "MarchingCubeData.h"
+
+namespace
+{
+	const float SURFACE_VALUE = 126;
+	const int REPEATS = 10;
+
+	struct ActiveCube
+	{
+		int cubeIndex;
+		float4 corners[8];
+	};
+
+	// Cubes of a sum of waves with a little noise that have corners on both sides of the surface
+	std::vector<ActiveCube> generateCubes(int size)
+	{
+		std::vector<unsigned char> field((size_t)size * size * size);
+		std::mt19937 random(42);
+		std::uniform_int_distribution<int> noise(-8, 8);
+		for (int z = 0; z < size; z++)
+			for (int y = 0; y < size; y++)
+				for (int x = 0; x < size; x++)
+				{
+					float value = 126 + 60 * sinf(x * 0.21f) * cosf(y * 0.17f) + 50 * sinf(z * 0.13f + y * 0.05f);
+					field[x + (size_t)y * size + (size_t)z * size * size] = (unsigned char)Clamp((int)value + noise(random), 0, 255);
+				}
+
+		std::vector<ActiveCube> cubes;
+		for (int z = 0; z < size - 1; z++)
+			for (int y = 0; y < size - 1; y++)
+				for (int x = 0; x < size - 1; x++)
+				{
+					ActiveCube cube;
+					cube.cubeIndex = 0;
+					for (int i = 0; i < 8; i++)
+					{
+						int cx = x + (int)MarchingCubeData::vertexOffset[i][0];
+						int cy = y + (int)MarchingCubeData::vertexOffset[i][1];
+						int cz = z + (int)MarchingCubeData::vertexOffset[i][2];
+						float value = field[cx + (size_t)cy * size + (size_t)cz * size * size];
+						cube.corners[i] = float4((float)cx, (float)cy, (float)cz, value);
+						if (value < SURFACE_VALUE)
+							cube.cubeIndex |= 1 << i;
+					}
+					if (cube.cubeIndex != 0 && cube.cubeIndex != 255)
+						cubes.push_back(cube);
+				}
+		return cubes;
+	}
+
+	// The triangle count and crossed edges of a cube, as pass 1 of the mesher needs them
+	long long countWalk(const std::vector<ActiveCube>& cubes)
+	{
+		long long checksum = 0;
+		for (const ActiveCube& cube : cubes)
+		{
+			const int* triangles = MarchingCubeData::triangleConnectionTable[cube.cubeIndex];
+			int triangleCount = 0;
+			int edgeMask = 0;
+			for (int i = 0; triangles[i] != -1; i++)
+			{
+				edgeMask |= 1 << triangles[i];
+				if (i % 3 == 0)
+					triangleCount++;
+			}
+			checksum += triangleCount * 4096 + edgeMask;
+		}
+		return checksum;
+	}
+
+	long long countCases(const std::vector<ActiveCube>& cubes)
+	{
+		long long checksum = 0;
+		for (const ActiveCube& cube : cubes)
+		{
+			const MarchingCubeData::CubeCase& cubeCase = MarchingCubeData::cubeCases[cube.cubeIndex];
+			checksum += cubeCase.triangleCount * 4096 + cubeCase.edgeMask;
+		}
+		return checksum;
+	}
+
+	double sumPoints(const float3 points[3])
+	{
+		return points[0].x + points[1].y * 2 + points[2].z * 3;
+	}
+
+	// Triangle points of a cube, the way getCubeTriangles built them before and after the tables
+	double trianglesWalk(const std::vector<ActiveCube>& cubes)
+	{
+		double checksum = 0;
+		for (const ActiveCube& cube : cubes)
+		{
+			const int* triangles = MarchingCubeData::triangleConnectionTable[cube.cubeIndex];
+			for (int i = 0; triangles[i] != -1; i += 3)
+			{
+				int edge0 = triangles[i];
+				int edge1 = triangles[i + 1];
+				int edge2 = triangles[i + 2];
+				float3 tri[3];
+				tri[0] = MarchingCubeData::pointLerp(cube.corners[MarchingCubeData::edgeConnection[edge1][0]], cube.corners[MarchingCubeData::edgeConnection[edge1][1]], SURFACE_VALUE);
+				tri[1] = MarchingCubeData::pointLerp(cube.corners[MarchingCubeData::edgeConnection[edge0][0]], cube.corners[MarchingCubeData::edgeConnection[edge0][1]], SURFACE_VALUE);
+				tri[2] = MarchingCubeData::pointLerp(cube.corners[MarchingCubeData::edgeConnection[edge2][0]], cube.corners[MarchingCubeData::edgeConnection[edge2][1]], SURFACE_VALUE);
+				checksum += sumPoints(tri);
+			}
+		}
+		return checksum;
+	}
+
+	double trianglesCases(const std::vector<ActiveCube>& cubes)
+	{
+		double checksum = 0;
+		for (const ActiveCube& cube : cubes)
+		{
+			const MarchingCubeData::CubeCase& cubeCase = MarchingCubeData::cubeCases[cube.cubeIndex];
+			for (int i = 0; i < cubeCase.triangleCount; i++)
+			{
+				float3 tri[3];
+				for (int ip = 0; ip < 3; ip++)
+				{
+					int corners = cubeCase.cornerPairs[i * 3 + ip];
+					tri[ip] = MarchingCubeData::pointLerp(cube.corners[corners & 15], cube.corners[corners >> 4], SURFACE_VALUE);
+				}
+				checksum += sumPoints(tri);
+			}
+		}
+		return checksum;
+	}
+
+	template<typename Result, typename Kernel>
+	void run(const char* kernel, const char* tables, const std::vector<ActiveCube>& cubes, Kernel function)
+	{
+		Result checksum = Result();
+		double best = 1e30;
+		for (int r = 0; r < REPEATS; r++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			checksum = function(cubes);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = min(best, elapsed.count());
+		}
+		printf("%-10s %-8s %8.2f ms %8.2f ns/cube   (checksum %.0f)\n", kernel, tables, best, best * 1e6 / cubes.size(), (double)checksum);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int size = argc > 1 ? atoi(argv[1]) : 128;
+	std::vector<ActiveCube> cubes = generateCubes(size);
+	printf("%d^3 field, %zu cubes on the surface, best of %d runs\n\n", size, cubes.size(), REPEATS);
+
+	run<long long>("count", "walk", cubes, countWalk);
+	run<long long>("count", "cases", cubes, countCases);
+	printf("\n");
+	run<double>("triangles", "walk", cubes, trianglesWalk);
+	run<double>("triangles", "cases", cubes, trianglesCases);
+	return 0;
+}
@@ -0,0 +1,177 @@
+/*
+Times the marching kernel of MarchingCube with the chunk extents known at compile time (FixedExtents) against the
+runtime sized fallback (RuntimeExtents), for every chunk size the mesher has a specialization for.
+The kernel mirrors MarchingCube::marchCubes on a voxel window per chunk: classify every row, build the corners of
+every active cube, lerp its triangle points and take the density gradient at both corners of every crossed edge.
+
+Build and run from the repository root:
+	g++ -std=c++17 -O2 -IBenchmarks -ITerrain Benchmarks/ChunkExtentsBenchmark.cpp Terrain/MarchingCubeData.cpp Terrain/MarchingCubeClassifier.cpp -o chunkExtentsBenchmark
+	./chunkExtentsBenchmark [size]
+*/
+#include "pch.h"
+#include "ChunkExtents.h"
+#include "MarchingCubeData.h"
+#include "MarchingCubeClassifier.h"
+
+namespace
+{
+	const float SURFACE_VALUE = 126;
+	const int REPEATS = 10;
+
+	// The windows of every chunk of the field, laid out like MarchingCube::VoxelWindow
+	struct ChunkWindows
+	{
+		int chunkSize = 0;
+		int chunkCount = 0;
+		size_t windowCells = 0;
+		std::vector<unsigned char> cells;
+
+		const unsigned char* origin(int chunk) const
+		{
+			int pitchY = chunkSize + 3;
+			return cells.data() + chunk * windowCells + 1 + pitchY + pitchY * (chunkSize + 3);
+		}
+	};
+
+	ChunkWindows makeWindows(const std::vector<unsigned char>& field, int size, int chunkSize)
+	{
+		ChunkWindows windows;
+		int pitch = chunkSize + 3;
+		int chunksPerAxis = size / chunkSize;
+		windows.chunkSize = chunkSize;
+		windows.chunkCount = chunksPerAxis * chunksPerAxis * chunksPerAxis;
+		windows.windowCells = (size_t)pitch * pitch * pitch + MarchingCubeClassifier::ROW_PADDING;
+		windows.cells.assign(windows.windowCells * windows.chunkCount, 0);
+		for (int chunk = 0; chunk < windows.chunkCount; chunk++)
+		{
+			int startX = (chunk % chunksPerAxis) * chunkSize;
+			int startY = (chunk / chunksPerAxis % chunksPerAxis) * chunkSize;
+			int startZ = (chunk / chunksPerAxis / chunksPerAxis) * chunkSize;
+			unsigned char* out = &windows.cells[chunk * windows.windowCells];
+			for (int z = -1; z <= chunkSize + 1; z++)
+				for (int y = -1; y <= chunkSize + 1; y++)
+					for (int x = -1; x <= chunkSize + 1; x++)
+					{
+						int fx = Clamp(startX + x, 0, size - 1);
+						int fy = Clamp(startY + y, 0, size - 1);
+						int fz = Clamp(startZ + z, 0, size - 1);
+						*out++ = field[fx + (size_t)fy * size + (size_t)fz * size * size];
+					}
+		}
+		return windows;
+	}
+
+	template<typename Extents>
+	float gradientLength(const Extents& extents, const unsigned char* cell)
+	{
+		float gx = (float)cell[1] - (float)cell[-1];
+		float gy = (float)cell[extents.pitchY] - (float)cell[-extents.pitchY];
+		float gz = (float)cell[extents.pitchZ] - (float)cell[-extents.pitchZ];
+		return gx * gx + gy * gy + gz * gz;
+	}
+
+	template<typename Extents>
+	double marchChunk(const Extents& extents, const unsigned char* origin, unsigned char* cubeIndices, int* activeCubes)
+	{
+		double checksum = 0;
+		for (int iz = 0; iz < extents.z; iz++)
+		{
+			for (int iy = 0; iy < extents.y; iy++)
+			{
+				const unsigned char* rows[4];
+				for (int i = 0; i < 4; i++)
+					rows[i] = origin + (iy + (i & 1)) * extents.pitchY + (iz + (i >> 1)) * extents.pitchZ;
+				int activeCount = MarchingCubeClassifier::classifyRow(rows, extents.x, SURFACE_VALUE, cubeIndices, activeCubes);
+
+				for (int i = 0; i < activeCount; i++)
+				{
+					int ix = activeCubes[i];
+					float4 cubeCorners[8];
+					for (int c = 0; c < 8; c++)
+					{
+						int ox = (int)MarchingCubeData::vertexOffset[c][0];
+						int oy = (int)MarchingCubeData::vertexOffset[c][1];
+						int oz = (int)MarchingCubeData::vertexOffset[c][2];
+						cubeCorners[c] = float4((ix + ox) * extents.inverseX, (iy + oy) * extents.inverseY, (iz + oz) * extents.inverseZ, (float)rows[oy + oz * 2][ix + ox]);
+					}
+
+					const MarchingCubeData::CubeCase& cubeCase = MarchingCubeData::cubeCases[cubeIndices[ix]];
+					for (int p = 0; p < cubeCase.triangleCount * 3; p++)
+					{
+						int corners = cubeCase.cornerPairs[p];
+						float3 point = MarchingCubeData::pointLerp(cubeCorners[corners & 15], cubeCorners[corners >> 4], SURFACE_VALUE);
+						checksum += point.x + point.y + point.z;
+					}
+					for (int e = 0; e < cubeCase.edgeCount; e++)
+					{
+						for (int end = 0; end < 2; end++)
+						{
+							int corner = MarchingCubeData::edgeConnection[cubeCase.edges[e]][end];
+							int cx = ix + (int)MarchingCubeData::vertexOffset[corner][0];
+							int cy = iy + (int)MarchingCubeData::vertexOffset[corner][1];
+							int cz = iz + (int)MarchingCubeData::vertexOffset[corner][2];
+							checksum += gradientLength(extents, origin + cx + cy * extents.pitchY + cz * extents.pitchZ);
+						}
+					}
+				}
+			}
+		}
+		return checksum;
+	}
+
+	template<typename Extents>
+	double run(const Extents& extents, const ChunkWindows& windows, double& checksum)
+	{
+		std::vector<unsigned char> cubeIndices(windows.chunkSize + MarchingCubeClassifier::ROW_PADDING);
+		std::vector<int> activeCubes(windows.chunkSize);
+		double best = 1e30;
+		for (int r = 0; r < REPEATS; r++)
+		{
+			checksum = 0;
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int chunk = 0; chunk < windows.chunkCount; chunk++)
+				checksum += marchChunk(extents, windows.origin(chunk), cubeIndices.data(), activeCubes.data());
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = min(best, elapsed.count());
+		}
+		return best;
+	}
+
+	template<int SIZE>
+	void compare(const std::vector<unsigned char>& field, int size)
+	{
+		ChunkWindows windows = makeWindows(field, size, SIZE);
+		double fixedChecksum, runtimeChecksum;
+		double fixedTime = run(FixedExtents<SIZE>(), windows, fixedChecksum);
+		double runtimeTime = run(RuntimeExtents(SIZE, SIZE, SIZE), windows, runtimeChecksum);
+		printf("%2d^3 chunks  %5d chunks  fixed %8.2f ms  runtime %8.2f ms  %5.2fx   (checksums %s)\n", SIZE, windows.chunkCount,
+			fixedTime, runtimeTime, runtimeTime / fixedTime, fixedChecksum == runtimeChecksum ? "match" : "DIFFER");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int size = argc > 1 ? atoi(argv[1]) : 128;
+	size -= size % 32;
+	if (size <= 0)
+		size = 32;
+
+	// rolling hills and overhangs with a little noise
+	std::vector<unsigned char> field((size_t)size * size * size);
+	std::mt19937 random(42);
+	std::uniform_int_distribution<int> noise(-4, 4);
+	for (int z = 0; z < size; z++)
+		for (int y = 0; y < size; y++)
+			for (int x = 0; x < size; x++)
+			{
+				float value = 126 + 60 * sinf(x * 0.11f) * cosf(y * 0.09f) + 50 * sinf(z * 0.07f + y * 0.03f);
+				field[x + (size_t)y * size + (size_t)z * size * size] = (unsigned char)Clamp((int)value + noise(random), 0, 255);
+			}
+
+	printf("%d^3 field, best of %d runs\n\n", size, REPEATS);
+	compare<4>(field, size);
+	compare<8>(field, size);
+	compare<16>(field, size);
+	compare<32>(field, size);
+	return 0;
+}
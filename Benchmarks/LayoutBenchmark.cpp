@@ -0,0 +1,351 @@
+/*
+Compares the two storages of the terrain data, the dense x-y-z layout of DenseVolume and the 8^3 bricks of BrickVolume, on a cave, 256^3 by default.
+Most kernels read the neighbourhoods the terrain code reads: the 8 corners of a marching cube, the 6 neighbours
+of getDataFieldFlow and smoothTerrain and the 26 neighbours of isOnEdge. columnWalk reads every column of cells along z,
+like a scan or a line of sight along that axis, where consecutive cells of the dense layout are a whole layer apart.
+It also runs on a volume of random cells, where every brick is dense, to tell the layout's gain from the uniform bricks'.
+Cache misses are counted with the hardware counters on Linux. Without them (other platforms, VMs without a PMU,
+perf_event_paranoid too high) only the times are reported, and the benchmark says so once instead of per kernel.
+Every time is given relative to the dense layout.
+
+Results so far: the bricks are as fast as dense in marchRows and slower in every other neighbourhood kernel, 1.1-3.5x, at 256^3 and at 512^3.
+The one win is columnWalk once the volume is larger than the caches hold well: at 512^3 it takes 0.33-0.45x the dense time on the cave
+and 0.35-0.5x with every brick dense, so the gain is the layout's. At 256^3 it varies from run to run, 0.5-1.3x. A Morton order of the cells inside a brick was tried against the
+x fastest order and made no measurable difference in any kernel, so bricks keep the x fastest order that row reads want.
+Uniform bricks store a single value, so the 256^3 cave takes 2.8 MB instead of 16 MB.
+
+Build and run from the repository root:
+	g++ -std=c++17 -O2 -IBenchmarks -ITerrain Benchmarks/LayoutBenchmark.cpp Terrain/BrickVolume.cpp Terrain/DenseVolume.cpp -o layoutBenchmark
+	./layoutBenchmark [size]
+*/
+#include "pch.h"
+#include "BrickVolume.h"
+#include "DenseVolume.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	typedef VoxelUInt8::Type Cell;
+	typedef DenseVolume<VoxelUInt8> DenseByteVolume;
+	typedef BrickVolume<VoxelUInt8> ByteVolume;
+
+	// Last level cache misses of this thread, -1 when the counters aren't available
+	class CacheMissCounter
+	{
+	private:
+		int m_fd = -1;
+	public:
+		CacheMissCounter()
+		{
+#if defined(__linux__)
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			m_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+		}
+		~CacheMissCounter()
+		{
+#if defined(__linux__)
+			if (m_fd >= 0)
+				close(m_fd);
+#endif
+		}
+		void start()
+		{
+#if defined(__linux__)
+			if (m_fd >= 0)
+			{
+				ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+				ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+		}
+		long long stop()
+		{
+			long long count = -1;
+#if defined(__linux__)
+			if (m_fd >= 0)
+			{
+				ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+				if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+					count = -1;
+			}
+#endif
+			return count;
+		}
+	};
+
+	// Open air tunnels carved through solid rock by random walks of spheres, like CaveCarver
+	std::vector<Cell> makeCave(int size)
+	{
+		std::vector<Cell> data((size_t)size * size * size, 0);
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		for (int tunnel = 0; tunnel < size / 8; tunnel++)
+		{
+			float px = unit(rng) * size, py = unit(rng) * size, pz = unit(rng) * size;
+			float dx = unit(rng) - 0.5f, dy = (unit(rng) - 0.5f) * 0.3f, dz = unit(rng) - 0.5f;
+			for (int step = 0; step < size; step++)
+			{
+				float radius = 3.f + unit(rng) * 5.f;
+				int r = (int)radius + 2;
+				for (int z = max((int)pz - r, 0); z <= min((int)pz + r, size - 1); z++)
+				{
+					for (int y = max((int)py - r, 0); y <= min((int)py + r, size - 1); y++)
+					{
+						for (int x = max((int)px - r, 0); x <= min((int)px + r, size - 1); x++)
+						{
+							float distance = sqrtf((x - px) * (x - px) + (y - py) * (y - py) + (z - pz) * (z - pz));
+							float value = Clamp((radius - distance) * 64.f + 126.f, 0.f, 255.f);
+							Cell& cell = data[x + (size_t)y * size + (size_t)z * size * size];
+							cell = max(cell, (Cell)value);
+						}
+					}
+				}
+				dx += (unit(rng) - 0.5f) * 0.4f;
+				dy += (unit(rng) - 0.5f) * 0.1f;
+				dz += (unit(rng) - 0.5f) * 0.4f;
+				float length = sqrtf(dx * dx + dy * dy + dz * dz) + 0.0001f;
+				px += dx / length * 2.f;
+				py += dy / length * 2.f;
+				pz += dz / length * 2.f;
+				if (px < 0 || px >= size || py < 0 || py >= size || pz < 0 || pz >= size)
+					break;
+			}
+		}
+		return data;
+	}
+
+	struct Position
+	{
+		int x, y, z;
+	};
+
+	// Queries and edits happen at the surface, so sample cells next to it. Kept away from the border by one cell
+	std::vector<Position> makeSurfacePositions(const std::vector<Cell>& data, int size, int count)
+	{
+		std::vector<Position> surface;
+		for (int z = 1; z < size - 2; z++)
+			for (int y = 1; y < size - 2; y++)
+				for (int x = 1; x < size - 2; x++)
+				{
+					size_t i = x + (size_t)y * size + (size_t)z * size * size;
+					if ((data[i] < 126) != (data[i + 1] < 126))
+						surface.push_back({ x, y, z });
+				}
+		std::mt19937 rng(11);
+		std::vector<Position> positions(count);
+		for (int i = 0; i < count; i++)
+			positions[i] = surface[rng() % surface.size()];
+		return positions;
+	}
+
+	template<typename Volume>
+	long long marchCorners(const Volume& volume, int size)
+	{
+		long long sum = 0;
+		for (int z = 0; z < size - 1; z++)
+			for (int y = 0; y < size - 1; y++)
+				for (int x = 0; x < size - 1; x++)
+				{
+					int cubeIndex = 0;
+					if (volume.get(x, y, z) < 126) cubeIndex |= 1;
+					if (volume.get(x + 1, y, z) < 126) cubeIndex |= 2;
+					if (volume.get(x + 1, y + 1, z) < 126) cubeIndex |= 4;
+					if (volume.get(x, y + 1, z) < 126) cubeIndex |= 8;
+					if (volume.get(x, y, z + 1) < 126) cubeIndex |= 16;
+					if (volume.get(x + 1, y, z + 1) < 126) cubeIndex |= 32;
+					if (volume.get(x + 1, y + 1, z + 1) < 126) cubeIndex |= 64;
+					if (volume.get(x, y + 1, z + 1) < 126) cubeIndex |= 128;
+					sum += cubeIndex;
+				}
+		return sum;
+	}
+
+	// Same access as MarchingCube, four rows of cells are copied and then classified
+	template<typename Volume>
+	long long marchRows(const Volume& volume, int size)
+	{
+		long long sum = 0;
+		std::vector<Cell> rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i].resize(size);
+		for (int z = 0; z < size - 1; z++)
+			for (int y = 0; y < size - 1; y++)
+			{
+				for (int i = 0; i < 4; i++)
+					volume.readRow(0, y + (i & 1), z + (i >> 1), size, rows[i].data());
+				for (int x = 0; x < size - 1; x++)
+				{
+					int cubeIndex = 0;
+					if (rows[0][x] < 126) cubeIndex |= 1;
+					if (rows[0][x + 1] < 126) cubeIndex |= 2;
+					if (rows[1][x + 1] < 126) cubeIndex |= 4;
+					if (rows[1][x] < 126) cubeIndex |= 8;
+					if (rows[2][x] < 126) cubeIndex |= 16;
+					if (rows[2][x + 1] < 126) cubeIndex |= 32;
+					if (rows[3][x + 1] < 126) cubeIndex |= 64;
+					if (rows[3][x] < 126) cubeIndex |= 128;
+					sum += cubeIndex;
+				}
+			}
+		return sum;
+	}
+
+	template<typename Volume>
+	long long centralDifference(const Volume& volume, const std::vector<Position>& positions)
+	{
+		long long sum = 0;
+		for (const Position& p : positions)
+		{
+			sum += (int)volume.get(p.x + 1, p.y, p.z) - volume.get(p.x - 1, p.y, p.z);
+			sum += (int)volume.get(p.x, p.y + 1, p.z) - volume.get(p.x, p.y - 1, p.z);
+			sum += (int)volume.get(p.x, p.y, p.z + 1) - volume.get(p.x, p.y, p.z - 1);
+		}
+		return sum;
+	}
+
+	template<typename Volume>
+	long long adjacent26(const Volume& volume, const std::vector<Position>& positions)
+	{
+		long long sum = 0;
+		for (const Position& p : positions)
+			for (int iz = -1; iz <= 1; iz++)
+				for (int iy = -1; iy <= 1; iy++)
+					for (int ix = -1; ix <= 1; ix++)
+						sum += volume.get(p.x + ix, p.y + iy, p.z + iz) < 126;
+		return sum;
+	}
+
+	long long adjacent26_block(const ByteVolume& volume, const std::vector<Position>& positions)
+	{
+		long long sum = 0;
+		Cell block[27];
+		for (const Position& p : positions)
+		{
+			volume.readBlock(p.x - 1, p.y - 1, p.z - 1, 3, 3, 3, block, 255);
+			for (int i = 0; i < 27; i++)
+				sum += block[i] < 126;
+		}
+		return sum;
+	}
+
+	template<typename Volume>
+	long long sphereAverage(const Volume& volume, const std::vector<Position>& centers, int radius, int size)
+	{
+		long long sum = 0;
+		for (const Position& c : centers)
+			for (int z = max(c.z - radius, 1); z < min(c.z + radius, size - 1); z++)
+				for (int y = max(c.y - radius, 1); y < min(c.y + radius, size - 1); y++)
+					for (int x = max(c.x - radius, 1); x < min(c.x + radius, size - 1); x++)
+					{
+						int avg = volume.get(x, y, z) + volume.get(x - 1, y, z) + volume.get(x + 1, y, z) +
+							volume.get(x, y - 1, z) + volume.get(x, y + 1, z) + volume.get(x, y, z - 1) + volume.get(x, y, z + 1);
+						sum += avg / 7;
+					}
+		return sum;
+	}
+
+	// Reads every column of cells along z, the axis the dense layout strides furthest
+	template<typename Volume>
+	long long columnWalk(const Volume& volume, int size)
+	{
+		long long sum = 0;
+		for (int y = 0; y < size; y++)
+			for (int x = 0; x < size; x++)
+				for (int z = 0; z < size; z++)
+					sum += volume.get(x, y, z) < 126;
+		return sum;
+	}
+
+	float g_denseMilliseconds = 0;	// of the kernel that ran last on the dense layout
+
+	// Runs the kernel once, the dense layout first so the others are given relative to it. Layouts named dense... are the baseline
+	template<typename Kernel>
+	void run(const char* kernel, const char* layout, Kernel function)
+	{
+		CacheMissCounter counter;
+		auto start = std::chrono::high_resolution_clock::now();
+		counter.start();
+		long long checksum = function();
+		long long misses = counter.stop();
+		float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		if (strncmp(layout, "dense", 5) == 0)
+			g_denseMilliseconds = milliseconds;
+		printf("%-18s %-14s %10.2f ms %6.2fx dense", kernel, layout, milliseconds, milliseconds / g_denseMilliseconds);
+		if (misses >= 0)
+			printf(" %14lld misses", misses);
+		printf("   (checksum %lld)\n", checksum);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int size = argc > 1 ? atoi(argv[1]) : 256;
+	std::vector<Cell> data = makeCave(size);
+	std::vector<Position> positions = makeSurfacePositions(data, size, 1 << 20);
+	std::vector<Position> centers(positions.begin(), positions.begin() + 256);
+
+	DenseByteVolume dense;
+	dense.init(size, size, size);
+	dense.load(data.data());
+	ByteVolume bricks;
+	bricks.init(size, size, size);
+	bricks.load(data.data());
+
+	printf("%d^3 cave, dense %.1f MB, bricks %.1f MB (%d of %d bricks dense)\n\n", size,
+		dense.getMemorySize() / (1024.f * 1024.f), bricks.getMemorySize() / (1024.f * 1024.f), (int)bricks.getDenseBrickCount(), (int)bricks.getBrickCount());
+	{
+		CacheMissCounter counter;
+		counter.start();
+		if (counter.stop() < 0)
+			printf("No hardware cache miss counters here, only times are reported\n\n");
+	}
+
+	run("marchCorners", "dense", [&] { return marchCorners(dense, size); });
+	run("marchCorners", "bricks", [&] { return marchCorners(bricks, size); });
+	printf("\n");
+	run("marchRows", "dense", [&] { return marchRows(dense, size); });
+	run("marchRows", "bricks", [&] { return marchRows(bricks, size); });
+	printf("\n");
+	run("centralDifference", "dense", [&] { return centralDifference(dense, positions); });
+	run("centralDifference", "bricks", [&] { return centralDifference(bricks, positions); });
+	printf("\n");
+	run("adjacent26", "dense", [&] { return adjacent26(dense, positions); });
+	run("adjacent26", "bricks", [&] { return adjacent26(bricks, positions); });
+	run("adjacent26", "brick blocks", [&] { return adjacent26_block(bricks, positions); });
+	printf("\n");
+	run("sphereAverage", "dense", [&] { return sphereAverage(dense, centers, 8, size); });
+	run("sphereAverage", "bricks", [&] { return sphereAverage(bricks, centers, 8, size); });
+	printf("\n");
+	run("columnWalk", "dense", [&] { return columnWalk(dense, size); });
+	run("columnWalk", "bricks", [&] { return columnWalk(bricks, size); });
+
+	// random cells leave no brick uniform, what is left of the difference is the layout's
+	std::mt19937 rng(3);
+	for (Cell& cell : data)
+		cell = (Cell)(rng() & 255);
+	DenseByteVolume randomDense;
+	randomDense.init(size, size, size);
+	randomDense.load(data.data());
+	ByteVolume randomBricks;
+	randomBricks.init(size, size, size);
+	randomBricks.load(data.data());
+	run("columnWalk", "dense random", [&] { return columnWalk(randomDense, size); });
+	run("columnWalk", "bricks random", [&] { return columnWalk(randomBricks, size); });
+	return 0;
+}
@@ -0,0 +1,521 @@
+/*
+Benchmarks the terrain core the way the game uses it, on a cave made by generateData_testCave from a fixed seed.
+	generateData_testCave	the cave generation itself, fill, carving and the smoothing passes
+	runAllMarchingCubes		meshing every chunk, as triangle lists and indexed
+	remesh chunk			marching single chunks again, one chunk per op, and again with octrees instead of BVHs for raycasts
+	damageSphere, damageCylinder, destroySphere at several radii, each timed together with the runQueuedMarchingCubes that follows, as a frame pays for both
+	smoothTerrain			a smoothing pass and the remesh of what it changed
+	long/shortRaycast		random rays from random positions inside the terrain, through the BVHs and the octrees
+	densityRaycast			the long rays again against the density field, then its time and how far its hits are from longRaycast's
+	raycastBatch			the long rays again in batches of 256, and sight lines, 256 rays from one eye, single and batched
+	findDecorPlacements		the terrain side of MarchingCubeHandler::placeDecor
+Every case reports ns per op, triangles meshed per second where it meshes, and the bytes and allocations per op, counted by
+replacing the global operator new. The terrain is regenerated from the seed before every edit case so runs stay comparable.
+The terrain data is stored densely, --bricks stores it in bricks instead, see MarchingCubeTerrain::init.
+With --json the results are also written to a file, to compare builds against each other.
+The memory of the generated terrain is printed by category, --memory writes it per chunk as well, see TerrainMemoryReport.
+
+Build with CMake (see the root CMakeLists.txt), or from the repository root:
+	g++ -std=c++17 -O2 -mavx2 -IBenchmarks -ITerrain/Headless -ITerrain -ITerrain/TerrainGeneration Benchmarks/TerrainBenchmark.cpp Terrain/BrickVolume.cpp Terrain/DenseVolume.cpp
+		Terrain/VoxelVolume.cpp Terrain/MarchingCubeData.cpp Terrain/MarchingCubeClassifier.cpp Terrain/MarchingCubeMesh.cpp Terrain/MarchingCubeTerrain.cpp Terrain/TerrainBvh.cpp Terrain/TerrainMemoryReport.cpp Terrain/TerrainQueryView.cpp
+		Terrain/TerrainRaycastStats.cpp Terrain/TerrainRecorder.cpp Terrain/TerrainTrace.cpp Terrain/TerrainGeneration/L_System.cpp Terrain/TerrainGeneration/CaveCarver.cpp -o terrainBenchmark
+	./terrainBenchmark [size 16-512] [seed] [--bricks] [--json file] [--memory file]
+*/
+#include "pch.h"
+#include "MarchingCubeTerrain.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <random>
+
+namespace
+{
+	std::atomic<size_t> g_bytesAllocated(0);
+	std::atomic<size_t> g_allocations(0);
+
+	void* countedAllocation(size_t size)
+	{
+		g_bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		void* memory = malloc(size ? size : 1);
+		if (!memory)
+			throw std::bad_alloc();
+		return memory;
+	}
+}
+
+void* operator new(size_t size) { return countedAllocation(size); }
+void* operator new[](size_t size) { return countedAllocation(size); }
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+
+namespace
+{
+	const int RAY_BATCH = 256;
+	const int RAYS = RAY_BATCH * 80;	// whole batches, so the batched cases cast the same rays as the single ones
+	const int REPEATS = 5;
+	const int EDITS = 50;
+	const int DECOR_COLLECTIONS = 5;
+
+	// Gives the benchmark the chunk table, which the game only reaches through the hooks
+	class BenchmarkTerrain : public MarchingCubeTerrain
+	{
+	public:
+		using MarchingCubeTerrain::s_defaultNrCubes;
+
+		size_t getTriangleCount() const
+		{
+			size_t triangles = 0;
+			for (const std::unique_ptr<MarchingCubeMesh>& cube : m_cubes)
+			{
+				if (cube)
+					triangles += cube->getTriangleCount();
+			}
+			return triangles;
+		}
+		std::vector<MarchingCubeMesh*> getAllocatedCubes() const
+		{
+			std::vector<MarchingCubeMesh*> cubes;
+			for (const std::unique_ptr<MarchingCubeMesh>& cube : m_cubes)
+			{
+				if (cube)
+					cubes.push_back(cube.get());
+			}
+			return cubes;
+		}
+		// runQueuedMarchingCubes, returns the triangles of the remeshed chunks
+		size_t remeshQueued()
+		{
+			m_remeshed.assign(m_marchingCubeQueue.begin(), m_marchingCubeQueue.end());	// reserved, so it doesn't count as the remesh's allocation
+			runQueuedMarchingCubes();
+			size_t triangles = 0;
+			for (const int3& id : m_remeshed)
+			{
+				MarchingCubeMesh* cube = getCube(id);
+				if (cube)
+					triangles += cube->getTriangleCount();
+			}
+			return triangles;
+		}
+		void reserveRemeshList()
+		{
+			m_remeshed.reserve(m_cubes.size());
+		}
+	private:
+		std::vector<int3> m_remeshed;
+	};
+
+	struct Result
+	{
+		const char* group;
+		std::string name;
+		int ops;
+		double nanoseconds;		// all ops
+		double bestNanoseconds;	// fastest op
+		size_t triangles;		// meshed by all ops
+		size_t bytes;			// allocated by all ops
+		size_t allocations;
+		size_t hits;			// rays that hit, placements found
+	};
+
+	std::vector<Result> g_results;
+
+	/*
+	Runs op 'ops' times and records it. op(i) returns the triangles it meshed, setup(i) runs before every op without being timed or counted.
+	*/
+	template<typename Setup, typename Op>
+	Result& measure(const char* group, const std::string& name, int ops, Setup setup, Op op)
+	{
+		Result result = { group, name, ops, 0, 1e30, 0, 0, 0, 0 };
+		for (int i = 0; i < ops; i++)
+		{
+			setup(i);
+			size_t bytes = g_bytesAllocated.load(std::memory_order_relaxed);
+			size_t allocations = g_allocations.load(std::memory_order_relaxed);
+			auto start = std::chrono::steady_clock::now();
+			result.triangles += op(i);
+			double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			result.bytes += g_bytesAllocated.load(std::memory_order_relaxed) - bytes;
+			result.allocations += g_allocations.load(std::memory_order_relaxed) - allocations;
+			result.nanoseconds += elapsed;
+			result.bestNanoseconds = min(result.bestNanoseconds, elapsed);
+		}
+		g_results.push_back(result);
+		return g_results.back();
+	}
+
+	template<typename Op>
+	Result& measure(const char* group, const std::string& name, int ops, Op op)
+	{
+		return measure(group, name, ops, [](int) {}, op);
+	}
+
+	void generate(BenchmarkTerrain& terrain, unsigned int seed)
+	{
+		terrain.generateData_testCave(2, seed);
+		terrain.runAllMarchingCubes();
+	}
+
+	// Spots on the walls of the cave, in data space, where the game's edits land
+	std::vector<float3> makeEditPositions(BenchmarkTerrain& terrain, unsigned int seed)
+	{
+		std::vector<float3> positions;
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		int3 size = terrain.getDataSize();
+		float3 dataSize((float)size.x, (float)size.y, (float)size.z);
+		for (int attempt = 0; attempt < EDITS * 100 && (int)positions.size() < EDITS; attempt++)
+		{
+			float3 origin(unit(random) * 0.8f + 0.1f, unit(random) * 0.8f + 0.1f, unit(random) * 0.8f + 0.1f);
+			float3 direction = Normalize(float3(unit(random) * 2 - 1, unit(random) * 2 - 1, unit(random) * 2 - 1));
+			float distance = 1.f;
+			float3 position, normal;
+			if (terrain.raycast_localSpace(origin, direction, distance, position, normal))
+				positions.push_back(position * dataSize);
+		}
+		return positions;
+	}
+
+	void runEdits(BenchmarkTerrain& terrain, unsigned int seed, const char* name, float radius, void (*edit)(BenchmarkTerrain&, float3, float))
+	{
+		generate(terrain, seed);
+		std::vector<float3> positions = makeEditPositions(terrain, seed);
+		char caseName[64];
+		snprintf(caseName, sizeof(caseName), "%s r=%g", name, radius);
+		measure("edit", caseName, (int)positions.size(), [&](int i)
+		{
+			edit(terrain, positions[i], radius);
+			return terrain.remeshQueued();
+		});
+	}
+
+	// Casts the same random rays for every raycast, returns the ns per ray
+	double runRays(BenchmarkTerrain& terrain, unsigned int seed, const char* name, float length, bool (MarchingCubeTerrain::*raycast)(float3, float3, float&, float3&, float3&))
+	{
+		std::vector<float3> origins(RAYS), directions(RAYS);
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		for (int i = 0; i < RAYS; i++)
+		{
+			origins[i] = float3(unit(random), unit(random), unit(random));
+			directions[i] = Normalize(float3(unit(random) * 2 - 1, unit(random) * 2 - 1, unit(random) * 2 - 1));
+		}
+		size_t hits = 0;
+		Result& result = measure("raycast", name, RAYS, [&](int i)
+		{
+			float distance = length;
+			float3 position, normal;
+			hits += (terrain.*raycast)(origins[i], directions[i], distance, position, normal) ? 1 : 0;
+			return (size_t)0;
+		});
+		result.hits = hits;
+		return result.nanoseconds / result.ops;
+	}
+
+	// How far densityRaycast_localSpace is from longRaycast_localSpace on the rays of runRays, see its tolerance
+	struct DensityAgreement
+	{
+		size_t rays = 0;
+		size_t missMatches = 0;		// rays one of them hit and the other didn't
+		size_t bothHit = 0;
+		float meanCells = 0;		// distance between the hits, in data cells
+		float p99Cells = 0;
+		bool withinTolerance() const { return missMatches * 200 <= rays && p99Cells <= 1.f; }
+	};
+
+	DensityAgreement compareDensityRays(BenchmarkTerrain& terrain, unsigned int seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		DensityAgreement agreement;
+		std::vector<float> cells;
+		float dataSize = (float)terrain.getDataSize().x;
+		for (int i = 0; i < RAYS; i++)
+		{
+			float3 origin(unit(random), unit(random), unit(random));
+			float3 direction = Normalize(float3(unit(random) * 2 - 1, unit(random) * 2 - 1, unit(random) * 2 - 1));
+			float meshDistance = 1.f, densityDistance = 1.f;
+			float3 position, normal;
+			bool meshHit = terrain.longRaycast_localSpace(origin, direction, meshDistance, position, normal);
+			bool densityHit = terrain.densityRaycast_localSpace(origin, direction, densityDistance, position, normal);
+			agreement.rays++;
+			if (meshHit != densityHit)
+				agreement.missMatches++;
+			else if (meshHit)
+				cells.push_back(fabsf(meshDistance - densityDistance) * dataSize);
+		}
+		agreement.bothHit = cells.size();
+		if (!cells.empty())
+		{
+			std::sort(cells.begin(), cells.end());
+			double sum = 0;
+			for (float cell : cells)
+				sum += cell;
+			agreement.meanCells = (float)(sum / cells.size());
+			agreement.p99Cells = cells[(cells.size() - 1) * 99 / 100];
+		}
+		return agreement;
+	}
+
+	// Counts the batches of a case as the rays in them, so the case compares with the single ray cases
+	void countRays(Result& result)
+	{
+		result.ops *= RAY_BATCH;
+		result.bestNanoseconds /= RAY_BATCH;
+	}
+
+	void runRayBatches(BenchmarkTerrain& terrain, unsigned int seed)
+	{
+		// the rays of runRays
+		std::vector<float3> origins(RAYS), directions(RAYS);
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		for (int i = 0; i < RAYS; i++)
+		{
+			origins[i] = float3(unit(random), unit(random), unit(random));
+			directions[i] = Normalize(float3(unit(random) * 2 - 1, unit(random) * 2 - 1, unit(random) * 2 - 1));
+		}
+		std::vector<float> distances(RAY_BATCH, 1.f);
+		std::vector<MarchingCubeTerrain::RayHit> rayHits(RAY_BATCH);
+		size_t hits = 0;
+		Result& batch = measure("raycast", "raycastBatch_localSpace", RAYS / RAY_BATCH, [&](int i)
+		{
+			terrain.raycastBatch_localSpace(RAY_BATCH, &origins[i * RAY_BATCH], &directions[i * RAY_BATCH], distances.data(), rayHits.data());
+			for (const MarchingCubeTerrain::RayHit& hit : rayHits)
+				hits += hit.hit ? 1 : 0;
+			return (size_t)0;
+		});
+		batch.hits = hits;
+		countRays(batch);
+
+		// Sight lines, RAY_BATCH rays from each eye, one at a time and as a batch. The eyes are in the open, a little off the cave's walls
+		std::vector<float3> eyes;
+		for (int attempt = 0; attempt < RAYS && (int)eyes.size() < RAYS / RAY_BATCH; attempt++)
+		{
+			float3 origin(unit(random), unit(random), unit(random));
+			float3 direction = Normalize(float3(unit(random) * 2 - 1, unit(random) * 2 - 1, unit(random) * 2 - 1));
+			float distance = 1.f;
+			float3 position, normal;
+			if (terrain.longRaycast_localSpace(origin, direction, distance, position, normal))
+				eyes.push_back(position + normal * 0.01f);
+		}
+		int sightRays = (int)eyes.size() * RAY_BATCH;
+		for (int i = 0; i < sightRays; i++)
+		{
+			origins[i] = eyes[i / RAY_BATCH];
+			directions[i] = Normalize(float3(unit(random) * 2 - 1, unit(random) * 2 - 1, unit(random) * 2 - 1));
+		}
+		hits = 0;
+		Result& single = measure("raycast", "sight lines longRaycast", sightRays, [&](int i)
+		{
+			float distance = 1.f;
+			float3 position, normal;
+			hits += terrain.longRaycast_localSpace(origins[i], directions[i], distance, position, normal) ? 1 : 0;
+			return (size_t)0;
+		});
+		single.hits = hits;
+		hits = 0;
+		Result& sight = measure("raycast", "sight lines raycastBatch", (int)eyes.size(), [&](int i)
+		{
+			terrain.raycastBatch_localSpace(RAY_BATCH, &origins[i * RAY_BATCH], &directions[i * RAY_BATCH], distances.data(), rayHits.data());
+			for (const MarchingCubeTerrain::RayHit& hit : rayHits)
+				hits += hit.hit ? 1 : 0;
+			return (size_t)0;
+		});
+		sight.hits = hits;
+		countRays(sight);
+	}
+
+	void print(const Result& result)
+	{
+		double seconds = result.nanoseconds * 1e-9;
+		printf("%-32s %6d ops %14.0f ns/op %14.0f best", result.name.c_str(), result.ops, result.nanoseconds / result.ops, result.bestNanoseconds);
+		if (result.triangles > 0)
+			printf(" %8.2f Mtris/s", result.triangles / seconds * 1e-6);
+		else
+			printf("                ");
+		printf(" %12.0f B/op %9.1f allocs/op", (double)result.bytes / result.ops, (double)result.allocations / result.ops);
+		if (result.hits > 0)
+			printf(" %7zu hits", result.hits);
+		printf("\n");
+	}
+
+	bool writeJson(const char* path, int size, unsigned int seed, VoxelFormat format, VoxelStorage storage, size_t triangles)
+	{
+		FILE* file = fopen(path, "w");
+		if (!file)
+			return false;
+		fprintf(file, "{\n\t\"size\": %d,\n\t\"seed\": %u,\n\t\"voxelFormat\": \"%s\",\n\t\"voxelStorage\": \"%s\",\n\t\"triangles\": %zu,\n\t\"cases\": [\n",
+			size, seed, getVoxelFormatName(format), getVoxelStorageName(storage), triangles);
+		for (size_t i = 0; i < g_results.size(); i++)
+		{
+			const Result& result = g_results[i];
+			double seconds = result.nanoseconds * 1e-9;
+			fprintf(file, "\t\t{ \"group\": \"%s\", \"name\": \"%s\", \"ops\": %d, \"nsPerOp\": %.1f, \"bestNs\": %.1f, \"trianglesPerSecond\": %.1f, \"bytesPerOp\": %.1f, \"allocationsPerOp\": %.2f, \"hits\": %zu }%s\n",
+				result.group, result.name.c_str(), result.ops, result.nanoseconds / result.ops, result.bestNanoseconds, result.triangles / seconds,
+				(double)result.bytes / result.ops, (double)result.allocations / result.ops, result.hits, i + 1 < g_results.size() ? "," : "");
+		}
+		fprintf(file, "\t]\n}\n");
+		fclose(file);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int size = 128;
+	unsigned int seed = 1234;
+	const char* jsonPath = nullptr;
+	const char* memoryPath = nullptr;
+	VoxelStorage storage = Storage_Dense;
+	int position = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		char* end = nullptr;
+		bool valid = true;
+		if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+			memoryPath = argv[++i];
+		else if (strcmp(argv[i], "--bricks") == 0)
+			storage = Storage_Bricks;
+		else if (argv[i][0] == '-')
+			valid = false;
+		else if (position == 0)
+		{
+			long value = strtol(argv[i], &end, 10);
+			valid = *end == '\0' && value >= 16 && value <= 512;
+			size = (int)value;
+			position++;
+		}
+		else if (position == 1)
+		{
+			unsigned long value = strtoul(argv[i], &end, 10);
+			valid = *end == '\0';
+			seed = (unsigned int)value;
+			position++;
+		}
+		else
+			valid = false;
+		if (!valid)
+		{
+			fprintf(stderr, "Usage: %s [size 16-512] [seed] [--bricks] [--json file] [--memory file]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// about as many data cells per world unit as the game's default terrain
+	BenchmarkTerrain terrain;
+	terrain.init(size, size, size, size / 6.f, BenchmarkTerrain::s_defaultNrCubes, Voxel_UInt8, storage);
+	terrain.setRemeshBudget(0);
+	terrain.reserveRemeshList();
+	printf("%d^3 terrain, seed %u, %d cells per chunk, %s storage\n\n", size, seed, size / 16, getVoxelStorageName(storage));
+
+	measure("generate", "generateData_testCave", 3, [&](int) { terrain.generateData_testCave(2, seed); return (size_t)0; });
+
+	measure("mesh", "runAllMarchingCubes", REPEATS, [&](int)
+	{
+		terrain.runAllMarchingCubes();
+		return terrain.getTriangleCount();
+	});
+	terrain.setMeshMode(MarchingCubeMesh::Mesh_Indexed);
+	measure("mesh", "runAllMarchingCubes indexed", REPEATS, [&](int)
+	{
+		terrain.runAllMarchingCubes();
+		return terrain.getTriangleCount();
+	});
+	terrain.setMeshMode(MarchingCubeMesh::Mesh_TriangleList);
+	terrain.runAllMarchingCubes();
+
+	std::vector<MarchingCubeMesh*> cubes = terrain.getAllocatedCubes();
+	measure("mesh", "remesh chunk", (int)cubes.size(),
+		[&](int i) { cubes[i]->markAllDirty(); },
+		[&](int i)
+		{
+			cubes[i]->buildMesh();
+			cubes[i]->releaseUploadedData();
+			return (size_t)cubes[i]->getTriangleCount();
+		});
+
+	size_t triangles = terrain.getTriangleCount();
+	TerrainMemoryReport memory = terrain.getMemoryReport();
+	double longRayTime = runRays(terrain, seed, "longRaycast_localSpace", 1.f, &MarchingCubeTerrain::longRaycast_localSpace);
+	runRays(terrain, seed, "shortRaycast_localSpace", 0.05f, &MarchingCubeTerrain::shortRaycast_localSpace);
+	double densityRayTime = runRays(terrain, seed, "densityRaycast_localSpace", 1.f, &MarchingCubeTerrain::densityRaycast_localSpace);
+	runRayBatches(terrain, seed);
+	DensityAgreement agreement = compareDensityRays(terrain, seed);
+
+	// the chunks' raycast trees as octrees again, to compare with the BVHs
+	terrain.setRaycastTree(MarchingCubeMesh::Raycast_Octree);
+	terrain.runAllMarchingCubes();
+	cubes = terrain.getAllocatedCubes();
+	measure("mesh", "remesh chunk octree", (int)cubes.size(),
+		[&](int i) { cubes[i]->markAllDirty(); },
+		[&](int i)
+		{
+			cubes[i]->buildMesh();
+			cubes[i]->releaseUploadedData();
+			return (size_t)cubes[i]->getTriangleCount();
+		});
+	size_t octreeBytes = terrain.getMemoryReport().getTotal(TerrainMemoryReport::Memory_TriangleOctree);
+	runRays(terrain, seed, "longRaycast_localSpace octree", 1.f, &MarchingCubeTerrain::longRaycast_localSpace);
+	runRays(terrain, seed, "shortRaycast_localSpace octree", 0.05f, &MarchingCubeTerrain::shortRaycast_localSpace);
+	terrain.setRaycastTree(MarchingCubeMesh::Raycast_Bvh);
+	terrain.runAllMarchingCubes();
+
+	srand(seed);
+	size_t placements = 0;
+	Result& decor = measure("decor", "findDecorPlacements", 3, [&](int)
+	{
+		placements += terrain.findDecorPlacements(DECOR_COLLECTIONS).size();
+		return (size_t)0;
+	});
+	decor.hits = placements;
+
+	const float radii[] = { 2.f, 4.f, 8.f };
+	for (float radius : radii)
+		runEdits(terrain, seed, "damageSphere", radius, [](BenchmarkTerrain& t, float3 pos, float r) { t.damageSphere_dataSpace(pos, r); });
+	for (float radius : radii)
+		runEdits(terrain, seed, "destroySphere", radius, [](BenchmarkTerrain& t, float3 pos, float r) { t.destroySphere_dataSpace(pos, r); });
+	for (float radius : radii)
+		runEdits(terrain, seed, "damageCylinder", radius, [](BenchmarkTerrain& t, float3 pos, float r) { t.damageCylinder_dataSpace(pos, r, r * 2); });
+
+	generate(terrain, seed);
+	measure("edit", "smoothTerrain", 3, [&](int)
+	{
+		terrain.smoothTerrain();
+		return terrain.remeshQueued();
+	});
+
+	for (const Result& result : g_results)
+		print(result);
+	printf("\n%zu triangles in the generated terrain\n", triangles);
+	printf("densityRaycast against longRaycast: %.2f of its time per ray, %zu of %zu rays differ on hit or miss, hits %.2f cells apart on average, p99 %.2f cells, %s tolerance\n",
+		densityRayTime / longRayTime, agreement.missMatches, agreement.rays, agreement.meanCells, agreement.p99Cells, agreement.withinTolerance() ? "within" : "OUTSIDE");
+	printf("raycast trees: %.0f KB as BVHs, %.0f KB as octrees\n\n", memory.getTotal(TerrainMemoryReport::Memory_TriangleOctree) / 1024.f, octreeBytes / 1024.f);
+	memory.print(stdout);
+	printf("\n");
+
+	if (jsonPath)
+	{
+		if (!writeJson(jsonPath, size, seed, terrain.getVoxelFormat(), terrain.getVoxelStorage(), triangles))
+		{
+			fprintf(stderr, "Could not write %s\n", jsonPath);
+			return 1;
+		}
+		printf("Results written to %s\n", jsonPath);
+	}
+	if (memoryPath)
+	{
+		if (!memory.write(memoryPath))
+		{
+			fprintf(stderr, "Could not write %s\n", memoryPath);
+			return 1;
+		}
+		printf("Memory report written to %s\n", memoryPath);
+	}
+	return 0;
+}
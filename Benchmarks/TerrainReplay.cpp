@@ -0,0 +1,275 @@
+/*
+Replays a session recorded by MarchingCubeHandler::startRecording on the terrain core, without the game, and reports what the terrain cost per frame.
+Frames are the time between two frame events of the recording, the cost of a frame is the time its terrain calls take here.
+By default the events run back to back, with --realtime every event waits for its time in the recording, so the caches see the pauses of the game.
+Remeshes run on this thread with the recorded frame budget, the asynchronous remeshes of the game are replayed the same way.
+Rays are checked against whether they hit in the game, a mismatch means the replayed terrain differs from the recorded one.
+
+With --trace the replay is also written as a Chrome trace, see TerrainTrace.
+
+Build with CMake (see the root CMakeLists.txt) and run from anywhere:
+	./TerrainReplay recording [--realtime] [--json file] [--trace file]
+*/
+#include "pch.h"
+#include "MarchingCubeTerrain.h"
+#include "TerrainRecorder.h"
+#include "TerrainTrace.h"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	typedef TerrainRecorder::Event Event;
+
+	struct EventStats
+	{
+		size_t count = 0;
+		double milliseconds = 0;
+	};
+
+	struct Replay
+	{
+		std::vector<double> frameMilliseconds;
+		EventStats events[TerrainRecorder::Event_TypeCount];
+		size_t rays = 0;
+		size_t rayMismatches = 0;
+		double milliseconds = 0;		// all events
+		double recordedSeconds = 0;		// length of the session
+		std::vector<std::pair<std::string, TerrainRaycastStats::Summary>> raycasts;	// per caller
+	};
+
+	// Returns true if the event was a ray that hit
+	bool runEvent(MarchingCubeTerrain& terrain, const Event& event)
+	{
+		float distance = event.sizes[0];
+		float3 position, normal;
+		switch (event.type)
+		{
+		case TerrainRecorder::Event_Init:
+			terrain.init((int)event.position.x, (int)event.position.y, (int)event.position.z, event.sizes[0], (int)event.values[0], (VoxelFormat)event.values[1]);
+			break;
+		case TerrainRecorder::Event_Generate:
+			terrain.generateData_testCave((int)event.values[1], event.values[0]);
+			break;
+		case TerrainRecorder::Event_Densities:
+		{
+			std::shared_ptr<unsigned char[]> densities(new unsigned char[event.densities->size()]);
+			std::copy(event.densities->begin(), event.densities->end(), densities.get());
+			terrain.setTerrainData((int)event.position.x, (int)event.position.y, (int)event.position.z, densities);
+			break;
+		}
+		case TerrainRecorder::Event_DestroySphere:
+			terrain.destroySphere_dataSpace(event.position, event.sizes[0]);
+			break;
+		case TerrainRecorder::Event_DamageSphere:
+			terrain.damageSphere_dataSpace(event.position, event.sizes[0], event.sizes[1]);
+			break;
+		case TerrainRecorder::Event_DamageCylinder:
+			terrain.damageCylinder_dataSpace(event.position, event.sizes[0], event.sizes[1], event.sizes[2]);
+			break;
+		case TerrainRecorder::Event_RemeshAll:
+			terrain.runAllMarchingCubes();
+			break;
+		case TerrainRecorder::Event_RemeshQueued:
+			terrain.setRemeshBudget(event.sizes[0]);
+			terrain.runQueuedMarchingCubes();
+			break;
+		case TerrainRecorder::Event_LongRaycast:
+			return terrain.longRaycast_localSpace(event.position, event.direction, distance, position, normal);
+		case TerrainRecorder::Event_ShortRaycast:
+			return terrain.shortRaycast_localSpace(event.position, event.direction, distance, position, normal);
+		case TerrainRecorder::Event_Raycast:
+			return terrain.raycast_localSpace(event.position, event.direction, distance, position, normal);
+		case TerrainRecorder::Event_DensityRaycast:
+			return terrain.densityRaycast_localSpace(event.position, event.direction, distance, position, normal);
+		case TerrainRecorder::Event_FindDecor:
+			terrain.findDecorPlacements((int)event.values[0]);
+			break;
+		default:
+			break;
+		}
+		return false;
+	}
+
+	bool isRay(TerrainRecorder::EventType type)
+	{
+		return type == TerrainRecorder::Event_LongRaycast || type == TerrainRecorder::Event_ShortRaycast || type == TerrainRecorder::Event_Raycast
+			|| type == TerrainRecorder::Event_DensityRaycast;
+	}
+
+	Replay replay(const std::vector<Event>& events, bool realtime)
+	{
+		Replay result;
+		MarchingCubeTerrain terrain;
+		terrain.getRaycastStats().setEnabled(true);	// for the raycasts per caller
+		srand(0);	// the decor placement draws random numbers, the game's sequence isn't recorded
+		double frame = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (const Event& event : events)
+		{
+			if (realtime)
+				std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(event.time)));
+			if (event.type == TerrainRecorder::Event_Frame)
+			{
+				terrain.getRaycastStats().endFrame();
+				result.frameMilliseconds.push_back(frame);
+				frame = 0;
+				continue;
+			}
+			auto eventStart = std::chrono::steady_clock::now();
+			bool hit = runEvent(terrain, event);
+			double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - eventStart).count();
+
+			EventStats& stats = result.events[event.type];
+			stats.count++;
+			stats.milliseconds += milliseconds;
+			frame += milliseconds;
+			result.milliseconds += milliseconds;
+			if (isRay(event.type))
+			{
+				result.rays++;
+				if (hit != (event.values[0] != 0))
+					result.rayMismatches++;
+			}
+		}
+		if (frame > 0)
+			result.frameMilliseconds.push_back(frame); // calls after the last frame event
+		terrain.getRaycastStats().endFrame();
+		for (int tag = 0; tag < TerrainRaycastStats::getTagCount(); tag++)
+		{
+			TerrainRaycastStats::Summary summary = terrain.getRaycastStats().getSummary(tag);
+			if (summary.rays > 0)
+				result.raycasts.push_back(std::make_pair(std::string(TerrainRaycastStats::getTagName(tag)), summary));
+		}
+		result.recordedSeconds = events.empty() ? 0 : events.back().time;
+		return result;
+	}
+
+	// Nearest rank percentile of sorted values
+	double percentile(const std::vector<double>& sorted, double p)
+	{
+		if (sorted.empty())
+			return 0;
+		size_t rank = (size_t)ceil(p / 100 * sorted.size());
+		return sorted[Clamp(rank, (size_t)1, sorted.size()) - 1];
+	}
+
+	const double s_percentiles[] = { 50, 90, 99, 99.9, 100 };
+
+	void print(const Replay& result, const std::vector<double>& sorted)
+	{
+		printf("%zu frames, %.1f s recorded, %.1f ms of terrain work\n\n", sorted.size(), result.recordedSeconds, result.milliseconds);
+		printf("frame cost ");
+		for (double p : s_percentiles)
+			printf("  p%g %.3f ms", p, percentile(sorted, p));
+		printf("\n\n");
+		for (int type = 0; type < TerrainRecorder::Event_TypeCount; type++)
+		{
+			const EventStats& stats = result.events[type];
+			if (stats.count == 0 || type == TerrainRecorder::Event_Frame)
+				continue;
+			printf("%-16s %8zu calls %12.3f ms %12.0f ns/call\n", TerrainRecorder::getEventName((TerrainRecorder::EventType)type), stats.count, stats.milliseconds, stats.milliseconds * 1e6 / stats.count);
+		}
+		if (result.rays > 0)
+			printf("\n%zu of %zu rays hit differently than in the game\n", result.rayMismatches, result.rays);
+		if (!result.raycasts.empty())
+			printf("\n%-16s %8s %8s %12s %12s %12s %12s %12s\n", "raycasts by", "rays", "hits", "triangles", "p50 us", "p99 us", "p50 ms/frame", "p99 ms/frame");
+		for (const auto& caller : result.raycasts)
+		{
+			const TerrainRaycastStats::Summary& summary = caller.second;
+			printf("%-16s %8zu %8zu %12.1f %12.2f %12.2f %12.3f %12.3f\n", caller.first.c_str(), summary.rays, summary.hits, summary.trianglesPerRay,
+				summary.rayMicroseconds[0], summary.rayMicroseconds[1], summary.frameMilliseconds[0], summary.frameMilliseconds[1]);
+		}
+	}
+
+	bool writeJson(const char* path, const char* recording, bool realtime, const Replay& result, const std::vector<double>& sorted)
+	{
+		FILE* file = fopen(path, "w");
+		if (!file)
+			return false;
+		fprintf(file, "{\n\t\"recording\": \"%s\",\n\t\"realtime\": %s,\n\t\"frames\": %zu,\n\t\"recordedSeconds\": %.3f,\n\t\"milliseconds\": %.3f,\n",
+			recording, realtime ? "true" : "false", sorted.size(), result.recordedSeconds, result.milliseconds);
+		fprintf(file, "\t\"frameMilliseconds\": {");
+		for (size_t i = 0; i < sizeof(s_percentiles) / sizeof(s_percentiles[0]); i++)
+			fprintf(file, "%s \"p%g\": %.4f", i > 0 ? "," : "", s_percentiles[i], percentile(sorted, s_percentiles[i]));
+		fprintf(file, " },\n\t\"rays\": %zu,\n\t\"rayMismatches\": %zu,\n\t\"events\": [\n", result.rays, result.rayMismatches);
+		bool first = true;
+		for (int type = 0; type < TerrainRecorder::Event_TypeCount; type++)
+		{
+			const EventStats& stats = result.events[type];
+			if (stats.count == 0)
+				continue;
+			fprintf(file, "%s\t\t{ \"name\": \"%s\", \"calls\": %zu, \"milliseconds\": %.4f }", first ? "" : ",\n",
+				TerrainRecorder::getEventName((TerrainRecorder::EventType)type), stats.count, stats.milliseconds);
+			first = false;
+		}
+		fprintf(file, "\n\t]\n}\n");
+		fclose(file);
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* recording = nullptr;
+	const char* jsonPath = nullptr;
+	const char* tracePath = nullptr;
+	bool realtime = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--realtime") == 0)
+			realtime = true;
+		else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			tracePath = argv[++i];
+		else
+			recording = argv[i];
+	}
+	if (!recording)
+	{
+		fprintf(stderr, "Usage: %s recording [--realtime] [--json file] [--trace file]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<Event> events;
+	if (!TerrainRecorder::load(recording, events))
+	{
+		fprintf(stderr, "Could not read %s\n", recording);
+		return 1;
+	}
+	if (events.empty() || events[0].type != TerrainRecorder::Event_Init)
+	{
+		fprintf(stderr, "%s doesn't start with the terrain's size\n", recording);
+		return 1;
+	}
+
+	if (tracePath)
+		TerrainTrace::start();
+	Replay result = replay(events, realtime);
+	TerrainTrace::stop();
+	std::vector<double> sorted = result.frameMilliseconds;
+	std::sort(sorted.begin(), sorted.end());
+	print(result, sorted);
+
+	if (jsonPath)
+	{
+		if (!writeJson(jsonPath, recording, realtime, result, sorted))
+		{
+			fprintf(stderr, "Could not write %s\n", jsonPath);
+			return 1;
+		}
+		printf("Results written to %s\n", jsonPath);
+	}
+	if (tracePath)
+	{
+		if (!TerrainTrace::write(tracePath))
+		{
+			fprintf(stderr, "Could not write %s\n", tracePath);
+			return 1;
+		}
+		printf("%zu trace events written to %s\n", TerrainTrace::getEventCount(), tracePath);
+	}
+	return 0;
+}
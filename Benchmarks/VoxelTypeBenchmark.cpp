@@ -0,0 +1,241 @@
+/*
+Runs the same load, edit and meshing work on the terrain data in every voxel format and reports time and memory side by side.
+	load	a 128^3 cave with smooth walls, the densities converted with the format's fromDensity
+	edit	sphere carves with a soft edge like MarchingCubeHandler::damageSphere, then the row smoothing of smoothTerrain
+	mesh	the marching kernel of MarchingCube on the voxel window of every 16^3 chunk, read and converted like copyVoxelWindow
+The triangle count shows how much of the carving the 8 bit grid loses, memory is what the brick pool and table take.
+
+Build and run from the repository root:
+	g++ -std=c++17 -O2 -IBenchmarks -ITerrain Benchmarks/VoxelTypeBenchmark.cpp Terrain/BrickVolume.cpp Terrain/MarchingCubeData.cpp Terrain/MarchingCubeClassifier.cpp -o voxelTypeBenchmark
+	./voxelTypeBenchmark [size]
+*/
+#include "pch.h"
+#include "BrickVolume.h"
+#include "ChunkExtents.h"
+#include "MarchingCubeData.h"
+#include "MarchingCubeClassifier.h"
+
+namespace
+{
+	const float SURFACE_VALUE = 126;
+	const int CHUNK_SIZE = 16;
+	const int CARVES = 200;
+	const int REPEATS = 5;
+
+	// Densities of a cave, solid rock below 126 with tunnels of air running through it
+	std::vector<float> makeCave(int size)
+	{
+		std::vector<float> densities((size_t)size * size * size);
+		for (int z = 0; z < size; z++)
+			for (int y = 0; y < size; y++)
+				for (int x = 0; x < size; x++)
+				{
+					float tunnel = 60 * sinf(x * 0.07f + z * 0.02f) * cosf(y * 0.05f) + 50 * sinf(z * 0.06f - y * 0.04f);
+					float ground = (y - size * 0.75f) * 4;	// open sky above three quarters of the height
+					densities[x + (size_t)y * size + (size_t)z * size * size] = Clamp(70 + max(tunnel, ground), 0.f, 255.f);
+				}
+		return densities;
+	}
+
+	struct Carve
+	{
+		float x, y, z;
+		float radius;
+	};
+
+	std::vector<Carve> makeCarves(int size)
+	{
+		std::vector<Carve> carves(CARVES);
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> position(4.f, size - 4.f);
+		std::uniform_real_distribution<float> radius(2.f, 6.f);
+		for (Carve& carve : carves)
+			carve = { position(random), position(random), position(random), radius(random) };
+		return carves;
+	}
+
+	template<typename Voxel>
+	void carveSphere(BrickVolume<Voxel>& volume, const Carve& carve)
+	{
+		int size = volume.getSizeX();
+		const float smoothing = 2.f;
+		for (int iz = max(0, (int)floorf(carve.z - carve.radius)); iz < min((int)ceilf(carve.z + carve.radius), size - 1); iz++)
+			for (int iy = max(0, (int)floorf(carve.y - carve.radius)); iy < min((int)ceilf(carve.y + carve.radius), size - 1); iy++)
+				for (int ix = max(0, (int)floorf(carve.x - carve.radius)); ix < min((int)ceilf(carve.x + carve.radius), size - 1); ix++)
+				{
+					float dx = carve.x - ix, dy = carve.y - iy, dz = carve.z - iz;
+					float length = sqrtf(dx * dx + dy * dy + dz * dz);
+					if (length >= carve.radius)
+						continue;
+					float fade = Clamp((carve.radius - length) / smoothing, 0.f, 1.f);
+					float mass = 1.f - Voxel::toDensity(volume.get(ix, iy, iz)) / 255.f;
+					float newMass = Clamp(mass - fade, 0.f, 1.f);
+					volume.set(ix, iy, iz, Voxel::fromDensity((1 - newMass) * 255.f));
+				}
+	}
+
+	// The averaging of smoothTerrain without the tilt test, over the rows of the lower half
+	template<typename Voxel>
+	void smoothRows(BrickVolume<Voxel>& volume)
+	{
+		typedef typename Voxel::Type Type;
+		int size = volume.getSizeX();
+		std::vector<Type> row(size + 2), rowYNeg(size), rowYPos(size), rowZNeg(size), rowZPos(size);
+		Type outside = Voxel::fromDensity(100);
+		for (int iz = 0; iz < size; iz++)
+			for (int iy = 0; iy < size / 2; iy++)
+			{
+				volume.readBlock(-1, iy, iz, size + 2, 1, 1, row.data(), outside);
+				volume.readBlock(0, iy - 1, iz, size, 1, 1, rowYNeg.data(), outside);
+				volume.readBlock(0, iy + 1, iz, size, 1, 1, rowYPos.data(), outside);
+				volume.readBlock(0, iy, iz - 1, size, 1, 1, rowZNeg.data(), outside);
+				volume.readBlock(0, iy, iz + 1, size, 1, 1, rowZPos.data(), outside);
+				for (int ix = 0; ix < size; ix++)
+				{
+					Type* cell = &row[ix + 1];
+					float sum = Voxel::toDensity(cell[0]) + Voxel::toDensity(cell[1]) + Voxel::toDensity(cell[-1]) +
+						Voxel::toDensity(rowYPos[ix]) + Voxel::toDensity(rowYNeg[ix]) + Voxel::toDensity(rowZPos[ix]) + Voxel::toDensity(rowZNeg[ix]);
+					Type average = Voxel::fromDensity(sum / 7);
+					if (average != *cell)
+					{
+						volume.set(ix, iy, iz, average);
+						*cell = average;
+					}
+				}
+			}
+	}
+
+	// Voxel window of a chunk like MarchingCube::VoxelWindow, edge cells repeated past the volume
+	template<typename Voxel>
+	void copyWindow(const BrickVolume<Voxel>& volume, int startX, int startY, int startZ, std::vector<typename Voxel::Type>& cellRow, typename Voxel::Sample* window)
+	{
+		typedef FixedExtents<CHUNK_SIZE> Extents;
+		int size = volume.getSizeX();
+		int firstX = startX - 1;
+		int countX = CHUNK_SIZE + 3;
+		int insideX = max(firstX, 0);
+		int endX = min(firstX + countX, size);
+		for (int iz = -1; iz <= CHUNK_SIZE + 1; iz++)
+		{
+			int z = Clamp(iz + startZ, 0, size - 1);
+			for (int iy = -1; iy <= CHUNK_SIZE + 1; iy++)
+			{
+				int y = Clamp(iy + startY, 0, size - 1);
+				typename Voxel::Sample* out = window + (iy + 1) * Extents::pitchY + (iz + 1) * Extents::pitchZ;
+				typename Voxel::Sample* inside = out + (insideX - firstX);
+				volume.readRow(insideX, y, z, endX - insideX, cellRow.data());
+				for (int i = 0; i < endX - insideX; i++)
+					inside[i] = Voxel::toSample(cellRow[i]);
+				std::fill(out, inside, inside[0]);
+				std::fill(out + (endX - firstX), out + countX, out[endX - firstX - 1]);
+			}
+		}
+	}
+
+	template<typename Voxel>
+	double marchVolume(const BrickVolume<Voxel>& volume, size_t& triangles)
+	{
+		typedef FixedExtents<CHUNK_SIZE> Extents;
+		typedef typename Voxel::Sample Sample;
+		std::vector<Sample> window(Extents::pitchZ * (CHUNK_SIZE + 3) + MarchingCubeClassifier::ROW_PADDING);
+		std::vector<typename Voxel::Type> cellRow(CHUNK_SIZE + 3);
+		unsigned char cubeIndices[CHUNK_SIZE + MarchingCubeClassifier::ROW_PADDING];
+		int activeCubes[CHUNK_SIZE];
+		float surfaceSample = SURFACE_VALUE * Voxel::scale;
+		float toDensity = 1.f / Voxel::scale;
+		int chunks = volume.getSizeX() / CHUNK_SIZE;
+		double checksum = 0;
+		triangles = 0;
+
+		for (int chunk = 0; chunk < chunks * chunks * chunks; chunk++)
+		{
+			copyWindow(volume, chunk % chunks * CHUNK_SIZE, chunk / chunks % chunks * CHUNK_SIZE, chunk / chunks / chunks * CHUNK_SIZE, cellRow, window.data());
+			const Sample* origin = window.data() + 1 + Extents::pitchY + Extents::pitchZ;
+			for (int iz = 0; iz < Extents::z; iz++)
+				for (int iy = 0; iy < Extents::y; iy++)
+				{
+					const Sample* rows[4];
+					for (int i = 0; i < 4; i++)
+						rows[i] = origin + (iy + (i & 1)) * Extents::pitchY + (iz + (i >> 1)) * Extents::pitchZ;
+					int activeCount = MarchingCubeClassifier::classifyRow(rows, Extents::x, surfaceSample, cubeIndices, activeCubes);
+					for (int i = 0; i < activeCount; i++)
+					{
+						int ix = activeCubes[i];
+						float4 cubeCorners[8];
+						for (int c = 0; c < 8; c++)
+						{
+							int ox = (int)MarchingCubeData::vertexOffset[c][0];
+							int oy = (int)MarchingCubeData::vertexOffset[c][1];
+							int oz = (int)MarchingCubeData::vertexOffset[c][2];
+							cubeCorners[c] = float4((ix + ox) * Extents::inverseX, (iy + oy) * Extents::inverseY, (iz + oz) * Extents::inverseZ, rows[oy + oz * 2][ix + ox] * toDensity);
+						}
+						const MarchingCubeData::CubeCase& cubeCase = MarchingCubeData::cubeCases[cubeIndices[ix]];
+						for (int p = 0; p < cubeCase.triangleCount * 3; p++)
+						{
+							int corners = cubeCase.cornerPairs[p];
+							float3 point = MarchingCubeData::pointLerp(cubeCorners[corners & 15], cubeCorners[corners >> 4], SURFACE_VALUE);
+							checksum += point.x + point.y + point.z;
+						}
+						triangles += cubeCase.triangleCount;
+					}
+				}
+		}
+		return checksum;
+	}
+
+	double milliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+		return elapsed.count();
+	}
+
+	template<typename Voxel>
+	void run(const std::vector<float>& densities, const std::vector<Carve>& carves, int size)
+	{
+		double loadTime = 1e30, editTime = 1e30, meshTime = 1e30;
+		size_t memory = 0, denseBricks = 0, triangles = 0;
+		double checksum = 0;
+		for (int r = 0; r < REPEATS; r++)
+		{
+			BrickVolume<Voxel> volume;
+			auto start = std::chrono::high_resolution_clock::now();
+			std::vector<typename Voxel::Type> cells(densities.size());
+			for (size_t i = 0; i < densities.size(); i++)
+				cells[i] = Voxel::fromDensity(densities[i]);
+			volume.init(size, size, size);
+			volume.load(cells.data());
+			loadTime = min(loadTime, milliseconds(start));
+
+			start = std::chrono::high_resolution_clock::now();
+			for (const Carve& carve : carves)
+				carveSphere(volume, carve);
+			smoothRows(volume);
+			volume.compact();
+			editTime = min(editTime, milliseconds(start));
+
+			start = std::chrono::high_resolution_clock::now();
+			checksum = marchVolume(volume, triangles);
+			meshTime = min(meshTime, milliseconds(start));
+
+			memory = volume.getMemorySize();
+			denseBricks = volume.getDenseBrickCount();
+		}
+		printf("%-7s %2d bits   load %8.2f ms   edit %8.2f ms   mesh %8.2f ms   %7zu triangles   %8.2f MB  %6zu dense bricks   (checksum %.0f)\n",
+			Voxel::getName(), (int)sizeof(typename Voxel::Type) * 8, loadTime, editTime, meshTime, triangles, memory / (1024.0 * 1024.0), denseBricks, checksum);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int size = argc > 1 ? atoi(argv[1]) : 128;
+	size -= size % CHUNK_SIZE;
+	if (size <= 0)
+		size = CHUNK_SIZE;
+
+	std::vector<float> densities = makeCave(size);
+	std::vector<Carve> carves = makeCarves(size);
+	printf("%d^3 cave, %d carves and a smoothing pass, %d^3 chunks, best of %d runs\n\n", size, CARVES, CHUNK_SIZE, REPEATS);
+	for (int format = 0; format < Voxel_FormatCount; format++)
+		dispatchVoxelFormat((VoxelFormat)format, [&](auto voxel) { run<decltype(voxel)>(densities, carves, size); });
+	return 0;
+}
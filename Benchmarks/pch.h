@@ -0,0 +1,3 @@
+#pragma once
+// The benchmarks build the engine independent terrain files on their own, with the terrain core's stand-in for the engine's precompiled header
+#include "Headless/pch.h"
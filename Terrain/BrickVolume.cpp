@@ -0,0 +1,330 @@
+#include "pch.h"
+#include "BrickVolume.h"
+
+template<typename VoxelTraits>
+unsigned int BrickVolume<VoxelTraits>::allocateSlot()
+{
+	if (!m_freeSlots.empty())
+	{
+		unsigned int slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		return slot;
+	}
+	if (m_usedSlots % PAGE_BRICKS == 0)
+		m_pages.push_back(std::unique_ptr<Cell[]>(new Cell[(size_t)PAGE_BRICKS * BRICK_CELLS]));
+	return m_usedSlots++;
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::markEdited(size_t brick)
+{
+	if (!m_brickEdited[brick])
+	{
+		m_brickEdited[brick] = 1;
+		m_editedBricks.push_back((unsigned int)brick);
+	}
+}
+
+template<typename VoxelTraits>
+bool BrickVolume<VoxelTraits>::isBrickUniform(size_t brick, const Cell* cells, Type& value) const
+{
+	int bx = (int)(brick % m_bricksX);
+	int by = (int)((brick / m_bricksX) % m_bricksY);
+	int bz = (int)(brick / ((size_t)m_bricksX * m_bricksY));
+	int countX = min(m_sizeX - bx * BRICK_SIZE, BRICK_SIZE);
+	int countY = min(m_sizeY - by * BRICK_SIZE, BRICK_SIZE);
+	int countZ = min(m_sizeZ - bz * BRICK_SIZE, BRICK_SIZE);
+
+	value = cells[0].load(std::memory_order_relaxed);
+	for (int z = 0; z < countZ; z++)
+	{
+		for (int y = 0; y < countY; y++)
+		{
+			const Cell* row = cells + getCellIndex(0, y, z);
+			for (int x = 0; x < countX; x++)
+			{
+				if (row[x].load(std::memory_order_relaxed) != value)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::init(int sizeX, int sizeY, int sizeZ, Type value)
+{
+	m_sizeX = sizeX;
+	m_sizeY = sizeY;
+	m_sizeZ = sizeZ;
+	m_bricksX = (sizeX + BRICK_MASK) >> BRICK_SHIFT;
+	m_bricksY = (sizeY + BRICK_MASK) >> BRICK_SHIFT;
+	m_bricksZ = (sizeZ + BRICK_MASK) >> BRICK_SHIFT;
+	m_brickTotal = (size_t)m_bricksX * m_bricksY * m_bricksZ;
+
+	m_cells.reset(new std::atomic<Cell*>[m_brickTotal]);
+	m_uniformValues.reset(new Cell[m_brickTotal]);
+	m_pages.clear();
+	m_pages.shrink_to_fit();
+	m_pages.reserve((m_brickTotal + PAGE_BRICKS - 1) / PAGE_BRICKS);
+	fill(value);
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::fill(Type value)
+{
+	for (size_t i = 0; i < m_brickTotal; i++)
+	{
+		m_cells[i].store(nullptr, std::memory_order_relaxed);
+		m_uniformValues[i].store(value, std::memory_order_relaxed);
+	}
+	m_slots.assign(m_brickTotal, NO_SLOT);
+	m_pages.clear(); // capacity stays reserved
+	m_freeSlots.clear();
+	m_freeSlots.shrink_to_fit();
+	m_retiredSlots.clear();
+	m_retiredSlots.shrink_to_fit();
+	m_usedSlots = 0;
+	m_editedBricks.clear();
+	m_brickEdited.assign(m_brickTotal, 0);
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::load(const Type* data)
+{
+	fill(0);
+	for (int bz = 0; bz < m_bricksZ; bz++)
+	{
+		for (int by = 0; by < m_bricksY; by++)
+		{
+			for (int bx = 0; bx < m_bricksX; bx++)
+			{
+				size_t brick = bx + (size_t)by * m_bricksX + (size_t)bz * m_bricksX * m_bricksY;
+				// gather the brick into a pool slot, it is kept if the brick isn't uniform
+				unsigned int slot = allocateSlot();
+				Cell* cells = getSlotCells(slot);
+
+				// cells outside the volume repeat the last cell inside so they never break a uniform brick
+				for (int z = 0; z < BRICK_SIZE; z++)
+				{
+					int dz = min(bz * BRICK_SIZE + z, m_sizeZ - 1);
+					for (int y = 0; y < BRICK_SIZE; y++)
+					{
+						int dy = min(by * BRICK_SIZE + y, m_sizeY - 1);
+						const Type* row = data + (size_t)dy * m_sizeX + (size_t)dz * m_sizeX * m_sizeY;
+						for (int x = 0; x < BRICK_SIZE; x++)
+							cells[getCellIndex(x, y, z)].store(row[min(bx * BRICK_SIZE + x, m_sizeX - 1)], std::memory_order_relaxed);
+					}
+				}
+
+				Type value;
+				if (isBrickUniform(brick, cells, value))
+				{
+					m_uniformValues[brick].store(value, std::memory_order_relaxed);
+					m_freeSlots.push_back(slot);
+				}
+				else
+				{
+					m_slots[brick] = slot;
+					m_cells[brick].store(cells, std::memory_order_release);
+				}
+			}
+		}
+	}
+}
+
+template<typename VoxelTraits>
+bool BrickVolume<VoxelTraits>::set(int x, int y, int z, Type value)
+{
+	size_t brick = getBrickIndex(x, y, z);
+	int local = getCellIndex(x, y, z);
+	Cell* cells = m_cells[brick].load(std::memory_order_relaxed);
+	if (!cells)
+	{
+		Type uniformValue = m_uniformValues[brick].load(std::memory_order_relaxed);
+		if (uniformValue == value)
+			return false;
+
+		// Fill the new cells before publishing them, readers see either the uniform value or the filled brick
+		unsigned int slot = allocateSlot();
+		cells = getSlotCells(slot);
+		for (int i = 0; i < BRICK_CELLS; i++)
+			cells[i].store(uniformValue, std::memory_order_relaxed);
+		cells[local].store(value, std::memory_order_relaxed);
+		m_slots[brick] = slot;
+		m_cells[brick].store(cells, std::memory_order_release);
+		markEdited(brick);
+		return true;
+	}
+
+	if (cells[local].load(std::memory_order_relaxed) == value)
+		return false;
+	cells[local].store(value, std::memory_order_relaxed);
+	markEdited(brick);
+	return true;
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::readRow(int x, int y, int z, int count, Type* out) const
+{
+	int rowOffset = getCellIndex(0, y, z);
+	size_t brick = getBrickIndex(x, y, z);
+	while (count > 0)
+	{
+		int localX = x & BRICK_MASK;
+		int n = min(BRICK_SIZE - localX, count);
+		const Cell* cells = m_cells[brick].load(std::memory_order_acquire);
+		if (!cells)
+			std::fill(out, out + n, m_uniformValues[brick].load(std::memory_order_relaxed));
+		else
+		{
+			const Cell* row = cells + rowOffset + localX;
+			for (int i = 0; i < n; i++)
+				out[i] = row[i].load(std::memory_order_relaxed);
+		}
+		out += n;
+		x += n;
+		count -= n;
+		brick++;
+	}
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::readBlock(int x, int y, int z, int sizeX, int sizeY, int sizeZ, Type* out, Type outside) const
+{
+	// part of every row that is inside the volume
+	int startX = max(x, 0);
+	int endX = min(x + sizeX, m_sizeX);
+	for (int iz = z; iz < z + sizeZ; iz++)
+	{
+		for (int iy = y; iy < y + sizeY; iy++)
+		{
+			if (startX >= endX || iy < 0 || iy >= m_sizeY || iz < 0 || iz >= m_sizeZ)
+				std::fill(out, out + sizeX, outside);
+			else
+			{
+				std::fill(out, out + (startX - x), outside);
+				readRow(startX, iy, iz, endX - startX, out + (startX - x));
+				std::fill(out + (endX - x), out + sizeX, outside);
+			}
+			out += sizeX;
+		}
+	}
+}
+
+template<typename VoxelTraits>
+bool BrickVolume<VoxelTraits>::getUniformValue(int x, int y, int z, Type& value) const
+{
+	size_t brick = getBrickIndex(x, y, z);
+	if (m_cells[brick].load(std::memory_order_acquire))
+		return false;
+	value = m_uniformValues[brick].load(std::memory_order_relaxed);
+	return true;
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::compact()
+{
+	for (size_t i = 0; i < m_editedBricks.size(); i++)
+	{
+		size_t brick = m_editedBricks[i];
+		m_brickEdited[brick] = 0;
+		Cell* cells = m_cells[brick].load(std::memory_order_relaxed);
+		Type value;
+		if (!cells || !isBrickUniform(brick, cells, value))
+			continue;
+		m_uniformValues[brick].store(value, std::memory_order_relaxed);
+		m_cells[brick].store(nullptr, std::memory_order_release);
+		(m_retireFreedBricks ? m_retiredSlots : m_freeSlots).push_back(m_slots[brick]);
+		m_slots[brick] = NO_SLOT;
+	}
+	m_editedBricks.clear();
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::releaseRetiredBricks()
+{
+	m_freeSlots.insert(m_freeSlots.end(), m_retiredSlots.begin(), m_retiredSlots.end());
+	m_retiredSlots.clear();
+}
+
+template<typename VoxelTraits>
+size_t BrickVolume<VoxelTraits>::getRetiredBrickCount() const
+{
+	return m_retiredSlots.size();
+}
+
+template<typename VoxelTraits>
+size_t BrickVolume<VoxelTraits>::getBrickCount() const
+{
+	return m_brickTotal;
+}
+
+template<typename VoxelTraits>
+size_t BrickVolume<VoxelTraits>::getDenseBrickCount() const
+{
+	return m_usedSlots - m_freeSlots.size() - m_retiredSlots.size();
+}
+
+template<typename VoxelTraits>
+size_t BrickVolume<VoxelTraits>::getMemorySize() const
+{
+	size_t size = m_brickTotal * (sizeof(std::atomic<Cell*>) + sizeof(unsigned int) + sizeof(Cell) + sizeof(unsigned char));
+	size += m_pages.size() * PAGE_BRICKS * BRICK_CELLS * sizeof(Cell);
+	size += m_pages.capacity() * sizeof(std::unique_ptr<Cell[]>);
+	size += (m_freeSlots.capacity() + m_retiredSlots.capacity() + m_editedBricks.capacity()) * sizeof(unsigned int);
+	return size;
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::fillDensity(float density)
+{
+	fill(VoxelTraits::fromDensity(density));
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::loadDensities(const unsigned char* data)
+{
+	// 8 bit densities are the cells already
+	if constexpr (std::is_same<Type, unsigned char>::value && VoxelTraits::scale == 1.f)
+		load(data);
+	else
+	{
+		std::vector<Type> converted((size_t)m_sizeX * m_sizeY * m_sizeZ);
+		for (size_t i = 0; i < converted.size(); i++)
+			converted[i] = VoxelTraits::fromDensity(data[i]);
+		load(converted.data());
+	}
+}
+
+template<typename VoxelTraits>
+void BrickVolume<VoxelTraits>::saveDensities(unsigned char* data) const
+{
+	std::vector<Type> row(m_sizeX);
+	for (int z = 0; z < m_sizeZ; z++)
+	{
+		for (int y = 0; y < m_sizeY; y++)
+		{
+			readRow(0, y, z, m_sizeX, row.data());
+			for (int x = 0; x < m_sizeX; x++)
+				*data++ = (unsigned char)Clamp((int)roundf(VoxelTraits::toDensity(row[x])), 0, 255);
+		}
+	}
+}
+
+template<typename VoxelTraits>
+float BrickVolume<VoxelTraits>::getDensity(int x, int y, int z) const
+{
+	return VoxelTraits::toDensity(get(x, y, z));
+}
+
+template<typename VoxelTraits>
+bool BrickVolume<VoxelTraits>::setDensity(int x, int y, int z, float density)
+{
+	return set(x, y, z, VoxelTraits::fromDensity(density));
+}
+
+template class BrickVolume<VoxelUInt8>;
+template class BrickVolume<VoxelUInt16>;
+template class BrickVolume<VoxelHalf>;
+template class BrickVolume<VoxelFloat>;
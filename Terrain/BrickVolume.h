@@ -0,0 +1,163 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "VoxelVolume.h"
+
+/*
+Sparse storage of the terrain data, split into bricks of 8x8x8 cells.
+A brick where every cell has the same value, like solid rock or open air, is stored as that value alone.
+Only bricks the surface passes through get cells of their own, taken from a pool of pages.
+Pages never move and the cells are atomics, read and written relaxed, so query views on other threads can keep reading
+while the main thread edits. A reader sees every cell either before or after an edit, not the edit as a whole.
+Neighbouring cells are at most a brick apart in memory instead of a whole row or layer of the volume. The cells of a brick are x fastest,
+so a row of a brick is contiguous for the mesher's row reads.
+The cells are of the voxel traits' Type, see VoxelTraits.h. The formats are instantiated in BrickVolume.cpp.
+The terrain stores its data this way when init is given Storage_Bricks, DenseVolume is the default.
+*/
+template<typename VoxelTraits>
+class BrickVolume : public VoxelVolume
+{
+public:
+	typedef VoxelTraits Voxel;
+	typedef typename VoxelTraits::Type Type;
+
+	static const int BRICK_SIZE = 8;
+	static const int BRICK_CELLS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+
+private:
+	static const int BRICK_SHIFT = 3;
+	static const int BRICK_MASK = BRICK_SIZE - 1;
+	static const int PAGE_BRICKS = 64;					// dense bricks per pool page
+	static constexpr unsigned int NO_SLOT = 0xFFFFFFFFu;	// pool slot of a brick stored as a single value
+
+	// Relaxed atomics compile to plain loads and stores, they only keep the compiler from tearing or caching a cell
+	typedef std::atomic<Type> Cell;
+	static_assert(sizeof(Cell) == sizeof(Type) && Cell::is_always_lock_free, "cells are meant to be plain values");
+
+	int m_bricksX = 0;
+	int m_bricksY = 0;
+	int m_bricksZ = 0;
+	size_t m_brickTotal = 0;
+
+	std::unique_ptr<std::atomic<Cell*>[]> m_cells;	// cells of every brick, null for a brick stored as a single value
+	std::vector<unsigned int> m_slots;				// pool slot of every brick, only used by the editing thread
+	std::unique_ptr<Cell[]> m_uniformValues;		// value of every uniform brick
+	std::vector<std::unique_ptr<Cell[]>> m_pages;	// reserved up front and never reallocated
+	std::vector<unsigned int> m_freeSlots;
+	std::vector<unsigned int> m_retiredSlots;		// freed by compact, reused after releaseRetiredBricks
+	unsigned int m_usedSlots = 0;					// slots handed out from the pages so far
+
+	// Dense bricks edited since the last compact, they might have become uniform
+	std::vector<unsigned int> m_editedBricks;
+	std::vector<unsigned char> m_brickEdited;
+
+	size_t getBrickIndex(int x, int y, int z) const;
+	int getCellIndex(int x, int y, int z) const;
+	Cell* getSlotCells(unsigned int slot) const;
+	unsigned int allocateSlot();
+	void markEdited(size_t brick);
+	// Checks the cells of the brick that are inside the volume
+	bool isBrickUniform(size_t brick, const Cell* cells, Type& value) const;
+
+public:
+	BrickVolume() : VoxelVolume(VoxelTraits::format, Storage_Bricks) {}
+	BrickVolume(const BrickVolume&) = delete;
+	BrickVolume& operator=(const BrickVolume&) = delete;
+
+	// Resizes the volume and sets every cell to value. Frees all dense bricks
+	void init(int sizeX, int sizeY, int sizeZ, Type value = 0);
+	// Sets every cell to value. Frees all dense bricks
+	void fill(Type value);
+	// Copies a dense x-fastest array of the volume's size, only bricks with differing values are stored densely
+	void load(const Type* data);
+
+	// Positions must be inside the volume
+	Type get(int x, int y, int z) const;
+	// Returns true if the value changed. Positions must be inside the volume
+	bool set(int x, int y, int z, Type value);
+	// Copies cells [x, x + count[ of row (y, z) to out. The cells must be inside the volume
+	void readRow(int x, int y, int z, int count, Type* out) const;
+	/*
+	Copies the block of cells starting at (x, y, z) to out, x fastest, with one brick lookup per brick and row instead of one per cell.
+	Cells outside the volume are set to 'outside'. Used by kernels that look at the neighbours of a cell.
+	*/
+	void readBlock(int x, int y, int z, int sizeX, int sizeY, int sizeZ, Type* out, Type outside) const;
+	// Copies the 8 cells at the corners of the cube starting at (x, y, z) to out, in the order of readBlock. The cube must be inside the volume
+	void readCube(int x, int y, int z, Type out[8]) const;
+	// Returns true and the value if the brick containing the cell is stored as a single value
+	bool getUniformValue(int x, int y, int z, Type& value) const;
+
+	/*
+	Stores edited bricks that have become uniform as a single value again and returns their cells to the pool.
+	A freed brick can be handed to another brick by the next edit, so this must not run while another thread reads,
+	unless freed bricks are retired: their cells then keep their values until releaseRetiredBricks.
+	*/
+	void compact() override;
+	void releaseRetiredBricks() override;
+	size_t getRetiredBrickCount() const override;
+
+	size_t getBrickCount() const override;
+	size_t getDenseBrickCount() const override;
+	size_t getMemorySize() const override;
+
+	void fillDensity(float density) override;
+	void loadDensities(const unsigned char* data) override;
+	void saveDensities(unsigned char* data) const override;
+	float getDensity(int x, int y, int z) const override;
+	bool setDensity(int x, int y, int z, float density) override;
+};
+
+template<typename VoxelTraits>
+inline size_t BrickVolume<VoxelTraits>::getBrickIndex(int x, int y, int z) const
+{
+	return (size_t)(x >> BRICK_SHIFT) + (size_t)(y >> BRICK_SHIFT) * m_bricksX + (size_t)(z >> BRICK_SHIFT) * m_bricksX * m_bricksY;
+}
+
+template<typename VoxelTraits>
+inline int BrickVolume<VoxelTraits>::getCellIndex(int x, int y, int z) const
+{
+	return (x & BRICK_MASK) + ((y & BRICK_MASK) << BRICK_SHIFT) + ((z & BRICK_MASK) << (BRICK_SHIFT * 2));
+}
+
+template<typename VoxelTraits>
+inline typename BrickVolume<VoxelTraits>::Cell* BrickVolume<VoxelTraits>::getSlotCells(unsigned int slot) const
+{
+	return m_pages[slot / PAGE_BRICKS].get() + (size_t)(slot % PAGE_BRICKS) * BRICK_CELLS;
+}
+
+template<typename VoxelTraits>
+inline typename BrickVolume<VoxelTraits>::Type BrickVolume<VoxelTraits>::get(int x, int y, int z) const
+{
+	size_t brick = getBrickIndex(x, y, z);
+	const Cell* cells = m_cells[brick].load(std::memory_order_acquire);
+	if (!cells)
+		return m_uniformValues[brick].load(std::memory_order_relaxed);
+	return cells[getCellIndex(x, y, z)].load(std::memory_order_relaxed);
+}
+
+template<typename VoxelTraits>
+inline void BrickVolume<VoxelTraits>::readCube(int x, int y, int z, Type out[8]) const
+{
+	// a cube on the last cell of a brick along any axis reaches into the next bricks
+	if ((x & BRICK_MASK) == BRICK_MASK || (y & BRICK_MASK) == BRICK_MASK || (z & BRICK_MASK) == BRICK_MASK)
+	{
+		for (int i = 0; i < 8; i++)
+			out[i] = get(x + (i & 1), y + ((i >> 1) & 1), z + (i >> 2));
+		return;
+	}
+	size_t brick = getBrickIndex(x, y, z);
+	const Cell* cells = m_cells[brick].load(std::memory_order_acquire);
+	if (!cells)
+	{
+		std::fill(out, out + 8, m_uniformValues[brick].load(std::memory_order_relaxed));
+		return;
+	}
+	const Cell* cube = cells + getCellIndex(x, y, z);
+	const int offsets[4] = { 0, BRICK_SIZE, BRICK_SIZE * BRICK_SIZE, BRICK_SIZE * BRICK_SIZE + BRICK_SIZE };
+	for (int i = 0; i < 4; i++)
+	{
+		out[i * 2] = cube[offsets[i]].load(std::memory_order_relaxed);
+		out[i * 2 + 1] = cube[offsets[i] + 1].load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+Extents of a marching cube chunk in data cells, and the strides of its voxel window, see MarchingCube::VoxelWindow.
+The window holds the chunk's cells with a one cell halo on every side, plus the cell after it the cubes at the far edge read.
+The mesher is a template on the extents. FixedExtents makes the loop bounds, strides and scale compile time constants
+for the chunk sizes maps use, RuntimeExtents is the fallback for every other size.
+*/
+template<int SIZE>
+struct FixedExtents
+{
+	static constexpr int x = SIZE;
+	static constexpr int y = SIZE;
+	static constexpr int z = SIZE;
+	static constexpr float inverseX = 1.f / SIZE;	// length of a cube when the chunk is unit length
+	static constexpr float inverseY = 1.f / SIZE;
+	static constexpr float inverseZ = 1.f / SIZE;
+	static constexpr int pitchY = SIZE + 3;
+	static constexpr int pitchZ = (SIZE + 3) * (SIZE + 3);
+};
+
+struct RuntimeExtents
+{
+	int x;
+	int y;
+	int z;
+	float inverseX;
+	float inverseY;
+	float inverseZ;
+	int pitchY;
+	int pitchZ;
+
+	RuntimeExtents(int sizeX, int sizeY, int sizeZ)
+	{
+		x = sizeX;
+		y = sizeY;
+		z = sizeZ;
+		inverseX = 1 / (float)sizeX;
+		inverseY = 1 / (float)sizeY;
+		inverseZ = 1 / (float)sizeZ;
+		pitchY = sizeX + 3;
+		pitchZ = pitchY * (sizeY + 3);
+	}
+};
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "DenseVolume.h"
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::init(int sizeX, int sizeY, int sizeZ, Type value)
+{
+	m_sizeX = sizeX;
+	m_sizeY = sizeY;
+	m_sizeZ = sizeZ;
+	m_cellTotal = (size_t)sizeX * sizeY * sizeZ;
+	m_cells.reset(new Cell[m_cellTotal]);
+	fill(value);
+}
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::fill(Type value)
+{
+	for (size_t i = 0; i < m_cellTotal; i++)
+		m_cells[i].store(value, std::memory_order_relaxed);
+}
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::load(const Type* data)
+{
+	for (size_t i = 0; i < m_cellTotal; i++)
+		m_cells[i].store(data[i], std::memory_order_relaxed);
+}
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::readBlock(int x, int y, int z, int sizeX, int sizeY, int sizeZ, Type* out, Type outside) const
+{
+	// part of every row that is inside the volume
+	int startX = max(x, 0);
+	int endX = min(x + sizeX, m_sizeX);
+	for (int iz = z; iz < z + sizeZ; iz++)
+	{
+		for (int iy = y; iy < y + sizeY; iy++)
+		{
+			if (startX >= endX || iy < 0 || iy >= m_sizeY || iz < 0 || iz >= m_sizeZ)
+				std::fill(out, out + sizeX, outside);
+			else
+			{
+				std::fill(out, out + (startX - x), outside);
+				readRow(startX, iy, iz, endX - startX, out + (startX - x));
+				std::fill(out + (endX - x), out + sizeX, outside);
+			}
+			out += sizeX;
+		}
+	}
+}
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::compact()
+{
+}
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::releaseRetiredBricks()
+{
+}
+
+template<typename VoxelTraits>
+size_t DenseVolume<VoxelTraits>::getRetiredBrickCount() const
+{
+	return 0;
+}
+
+template<typename VoxelTraits>
+size_t DenseVolume<VoxelTraits>::getBrickCount() const
+{
+	return 0;
+}
+
+template<typename VoxelTraits>
+size_t DenseVolume<VoxelTraits>::getDenseBrickCount() const
+{
+	return 0;
+}
+
+template<typename VoxelTraits>
+size_t DenseVolume<VoxelTraits>::getMemorySize() const
+{
+	return m_cellTotal * sizeof(Cell);
+}
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::fillDensity(float density)
+{
+	fill(VoxelTraits::fromDensity(density));
+}
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::loadDensities(const unsigned char* data)
+{
+	for (size_t i = 0; i < m_cellTotal; i++)
+		m_cells[i].store(VoxelTraits::fromDensity(data[i]), std::memory_order_relaxed);
+}
+
+template<typename VoxelTraits>
+void DenseVolume<VoxelTraits>::saveDensities(unsigned char* data) const
+{
+	for (size_t i = 0; i < m_cellTotal; i++)
+		data[i] = (unsigned char)Clamp((int)roundf(VoxelTraits::toDensity(m_cells[i].load(std::memory_order_relaxed))), 0, 255);
+}
+
+template<typename VoxelTraits>
+float DenseVolume<VoxelTraits>::getDensity(int x, int y, int z) const
+{
+	return VoxelTraits::toDensity(get(x, y, z));
+}
+
+template<typename VoxelTraits>
+bool DenseVolume<VoxelTraits>::setDensity(int x, int y, int z, float density)
+{
+	return set(x, y, z, VoxelTraits::fromDensity(density));
+}
+
+template class DenseVolume<VoxelUInt8>;
+template class DenseVolume<VoxelUInt16>;
+template class DenseVolume<VoxelHalf>;
+template class DenseVolume<VoxelFloat>;
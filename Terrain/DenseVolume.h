@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include "VoxelVolume.h"
+
+/*
+The terrain data as one array of every cell, x fastest, then y, then z. The terrain's default storage.
+Takes a cell per position whatever the terrain holds, but reads a cell in one step, without looking up its brick first.
+The cells are atomics, read and written relaxed, and never move until the volume is resized, so query views on other threads
+can keep reading while the main thread edits. A reader sees every cell either before or after an edit, not the edit as a whole.
+Has the interface of BrickVolume, so code can be written once for both, see visitVoxelVolume. It has no bricks:
+getUniformValue never finds a uniform brick and compact has nothing to merge.
+The formats are instantiated in DenseVolume.cpp.
+*/
+template<typename VoxelTraits>
+class DenseVolume : public VoxelVolume
+{
+public:
+	typedef VoxelTraits Voxel;
+	typedef typename VoxelTraits::Type Type;
+
+private:
+	// Relaxed atomics compile to plain loads and stores, they only keep the compiler from tearing or caching a cell
+	typedef std::atomic<Type> Cell;
+	static_assert(sizeof(Cell) == sizeof(Type) && Cell::is_always_lock_free, "cells are meant to be plain values");
+
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_cellTotal = 0;
+
+	size_t getIndex(int x, int y, int z) const;
+
+public:
+	DenseVolume() : VoxelVolume(VoxelTraits::format, Storage_Dense) {}
+	DenseVolume(const DenseVolume&) = delete;
+	DenseVolume& operator=(const DenseVolume&) = delete;
+
+	// Resizes the volume and sets every cell to value
+	void init(int sizeX, int sizeY, int sizeZ, Type value = 0);
+	void fill(Type value);
+	// Copies a dense x-fastest array of the volume's size
+	void load(const Type* data);
+
+	// Positions must be inside the volume
+	Type get(int x, int y, int z) const;
+	// Returns true if the value changed. Positions must be inside the volume
+	bool set(int x, int y, int z, Type value);
+	// Copies cells [x, x + count[ of row (y, z) to out. The cells must be inside the volume
+	void readRow(int x, int y, int z, int count, Type* out) const;
+	// Copies the block of cells starting at (x, y, z) to out, x fastest. Cells outside the volume are set to 'outside'
+	void readBlock(int x, int y, int z, int sizeX, int sizeY, int sizeZ, Type* out, Type outside) const;
+	// Copies the 8 cells at the corners of the cube starting at (x, y, z) to out, in the order of readBlock. The cube must be inside the volume
+	void readCube(int x, int y, int z, Type out[8]) const;
+	// Always false, there are no uniform bricks
+	bool getUniformValue(int x, int y, int z, Type& value) const;
+
+	void compact() override;
+	void releaseRetiredBricks() override;
+	size_t getRetiredBrickCount() const override;
+
+	size_t getBrickCount() const override;
+	size_t getDenseBrickCount() const override;
+	size_t getMemorySize() const override;
+
+	void fillDensity(float density) override;
+	void loadDensities(const unsigned char* data) override;
+	void saveDensities(unsigned char* data) const override;
+	float getDensity(int x, int y, int z) const override;
+	bool setDensity(int x, int y, int z, float density) override;
+};
+
+template<typename VoxelTraits>
+inline size_t DenseVolume<VoxelTraits>::getIndex(int x, int y, int z) const
+{
+	return (size_t)x + (size_t)y * m_sizeX + (size_t)z * m_sizeX * m_sizeY;
+}
+
+template<typename VoxelTraits>
+inline typename DenseVolume<VoxelTraits>::Type DenseVolume<VoxelTraits>::get(int x, int y, int z) const
+{
+	return m_cells[getIndex(x, y, z)].load(std::memory_order_relaxed);
+}
+
+template<typename VoxelTraits>
+inline bool DenseVolume<VoxelTraits>::set(int x, int y, int z, Type value)
+{
+	Cell& cell = m_cells[getIndex(x, y, z)];
+	if (cell.load(std::memory_order_relaxed) == value)
+		return false;
+	cell.store(value, std::memory_order_relaxed);
+	return true;
+}
+
+template<typename VoxelTraits>
+inline void DenseVolume<VoxelTraits>::readRow(int x, int y, int z, int count, Type* out) const
+{
+	const Cell* row = m_cells.get() + getIndex(x, y, z);
+	for (int i = 0; i < count; i++)
+		out[i] = row[i].load(std::memory_order_relaxed);
+}
+
+template<typename VoxelTraits>
+inline void DenseVolume<VoxelTraits>::readCube(int x, int y, int z, Type out[8]) const
+{
+	const Cell* cube = m_cells.get() + getIndex(x, y, z);
+	size_t layer = (size_t)m_sizeX * m_sizeY;
+	const Cell* rows[4] = { cube, cube + m_sizeX, cube + layer, cube + layer + m_sizeX };
+	for (int i = 0; i < 4; i++)
+	{
+		out[i * 2] = rows[i][0].load(std::memory_order_relaxed);
+		out[i * 2 + 1] = rows[i][1].load(std::memory_order_relaxed);
+	}
+}
+
+template<typename VoxelTraits>
+inline bool DenseVolume<VoxelTraits>::getUniformValue(int, int, int, Type&) const
+{
+	return false;
+}
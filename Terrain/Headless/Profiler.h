@@ -0,0 +1,7 @@
+#pragma once
+// Stand-in for the engine's profiler when the terrain core is built on its own, the scopes cost nothing
+namespace Profiler
+{
+	inline void start(const char*) {}
+	inline void stop() {}
+}
@@ -0,0 +1,197 @@
+#pragma once
+/*
+Stand-in for the engine's precompiled header, used when the terrain core is built on its own (see CMakeLists.txt).
+Holds the parts of SimpleMath and the engine helpers the core uses, with the same names and behaviour,
+so the core files build unchanged for the game and for tools, benchmarks or a dedicated server on Linux.
+*/
+#include <memory>
+#include <vector>
+#include <list>
+#include <string>
+#include <bitset>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <random>
+#include <fstream>
+
+#ifndef min
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef max
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+namespace DirectX
+{
+	constexpr float XM_PI = 3.141592654f;
+	constexpr float XM_2PI = 6.283185307f;
+
+	namespace SimpleMath
+	{
+		struct Vector2
+		{
+			float x, y;
+			Vector2() : x(0), y(0) {}
+			Vector2(float x, float y) : x(x), y(y) {}
+			float Length() const { return sqrtf(x * x + y * y); }
+			float Dot(const Vector2& v) const { return x * v.x + y * v.y; }
+			void Normalize()
+			{
+				float length = Length();
+				if (length > 0)
+				{
+					x /= length;
+					y /= length;
+				}
+			}
+		};
+
+		struct Vector3
+		{
+			float x, y, z;
+			Vector3() : x(0), y(0), z(0) {}
+			explicit Vector3(float v) : x(v), y(v), z(v) {}
+			Vector3(float x, float y, float z) : x(x), y(y), z(z) {}
+
+			Vector3 operator+(const Vector3& v) const { return Vector3(x + v.x, y + v.y, z + v.z); }
+			Vector3 operator-(const Vector3& v) const { return Vector3(x - v.x, y - v.y, z - v.z); }
+			Vector3 operator*(const Vector3& v) const { return Vector3(x * v.x, y * v.y, z * v.z); }
+			Vector3 operator/(const Vector3& v) const { return Vector3(x / v.x, y / v.y, z / v.z); }
+			Vector3 operator*(float s) const { return Vector3(x * s, y * s, z * s); }
+			Vector3 operator/(float s) const { return Vector3(x / s, y / s, z / s); }
+			Vector3 operator-() const { return Vector3(-x, -y, -z); }
+			Vector3& operator+=(const Vector3& v) { x += v.x; y += v.y; z += v.z; return *this; }
+			Vector3& operator-=(const Vector3& v) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+			Vector3& operator*=(const Vector3& v) { x *= v.x; y *= v.y; z *= v.z; return *this; }
+			Vector3& operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+			Vector3& operator/=(float s) { x /= s; y /= s; z /= s; return *this; }
+			bool operator==(const Vector3& v) const { return x == v.x && y == v.y && z == v.z; }
+			bool operator!=(const Vector3& v) const { return !(*this == v); }
+
+			float Length() const { return sqrtf(x * x + y * y + z * z); }
+			float LengthSquared() const { return x * x + y * y + z * z; }
+			float Dot(const Vector3& v) const { return x * v.x + y * v.y + z * v.z; }
+			Vector3 Cross(const Vector3& v) const { return Vector3(y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x); }
+			void Normalize()
+			{
+				float length = Length();
+				if (length > 0)
+					*this *= 1.f / length;
+			}
+			static float Distance(const Vector3& a, const Vector3& b) { return (a - b).Length(); }
+
+			static const Vector3 Zero;
+			static const Vector3 One;
+			static const Vector3 Up;
+			static const Vector3 Forward;	// right handed, like SimpleMath
+		};
+		inline const Vector3 Vector3::Zero(0, 0, 0);
+		inline const Vector3 Vector3::One(1, 1, 1);
+		inline const Vector3 Vector3::Up(0, 1, 0);
+		inline const Vector3 Vector3::Forward(0, 0, -1);
+		inline Vector3 operator*(float s, const Vector3& v) { return v * s; }
+
+		struct Vector4
+		{
+			float x, y, z, w;
+			Vector4() : x(0), y(0), z(0), w(0) {}
+			Vector4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+			Vector4 operator+(const Vector4& v) const { return Vector4(x + v.x, y + v.y, z + v.z, w + v.w); }
+			Vector4 operator-(const Vector4& v) const { return Vector4(x - v.x, y - v.y, z - v.z, w - v.w); }
+			Vector4 operator*(const Vector4& v) const { return Vector4(x * v.x, y * v.y, z * v.z, w * v.w); }
+			Vector4 operator*(float s) const { return Vector4(x * s, y * s, z * s, w * s); }
+		};
+		inline Vector4 operator*(float s, const Vector4& v) { return v * s; }
+	}
+}
+
+typedef DirectX::SimpleMath::Vector2 float2;
+typedef DirectX::SimpleMath::Vector3 float3;
+typedef DirectX::SimpleMath::Vector4 float4;
+
+struct int3
+{
+	int x, y, z;
+	int3() : x(0), y(0), z(0) {}
+	int3(int x, int y, int z) : x(x), y(y), z(z) {}
+	int3 operator+(const int3& v) const { return int3(x + v.x, y + v.y, z + v.z); }
+	int3 operator-(const int3& v) const { return int3(x - v.x, y - v.y, z - v.z); }
+	int3 operator*(const int3& v) const { return int3(x * v.x, y * v.y, z * v.z); }
+	int3 operator/(const int3& v) const { return int3(x / v.x, y / v.y, z / v.z); }
+	int3 operator*(int s) const { return int3(x * s, y * s, z * s); }
+	int3 operator/(int s) const { return int3(x / s, y / s, z / s); }
+	bool operator==(const int3& v) const { return x == v.x && y == v.y && z == v.z; }
+	bool operator!=(const int3& v) const { return !(*this == v); }
+	int minimum() const { return min(x, min(y, z)); }
+	int maximum() const { return max(x, max(y, z)); }
+};
+
+template<typename T>
+inline T Clamp(T value, T low, T high)
+{
+	return value < low ? low : (value > high ? high : value);
+}
+
+template<typename T>
+inline T Lerp(T a, T b, float t)
+{
+	return a + (b - a) * t;
+}
+
+// Maps value from [fromLow, fromHigh] to [toLow, toHigh], not clamped
+inline float Map(float value, float fromLow, float fromHigh, float toLow, float toHigh)
+{
+	return toLow + (value - fromLow) * (toHigh - toLow) / (fromHigh - fromLow);
+}
+
+// Uniform in [low, high], drawn from rand so srand seeds it
+inline float RandomFloat(float low, float high)
+{
+	return low + (high - low) * ((float)rand() / RAND_MAX);
+}
+
+inline float3 Normalize(float3 v)
+{
+	v.Normalize();
+	return v;
+}
+
+/*
+The part of the engine's Transformation the cave carver's turtle uses, a position and a heading.
+Rotations are about world axes, the heading starts along Forward.
+*/
+class Transformation
+{
+private:
+	float3 m_position;
+	float3 m_forward = float3::Forward;
+
+public:
+	void setPosition(float3 position) { m_position = position; }
+	float3 getPosition() const { return m_position; }
+	void move(float3 offset) { m_position += offset; }
+	float3 getForward() const { return m_forward; }
+	void lookTo(float3 direction)
+	{
+		if (direction.LengthSquared() > 0)
+			m_forward = Normalize(direction);
+	}
+	// Rodrigues' rotation of the heading
+	void rotateByAxis(float3 axis, float angle)
+	{
+		axis.Normalize();
+		float c = cosf(angle);
+		float s = sinf(angle);
+		m_forward = m_forward * c + axis.Cross(m_forward) * s + axis * (axis.Dot(m_forward) * (1 - c));
+	}
+};
@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "MarchingCubeClassifier.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	inline int lowestBit(unsigned int mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (int)index;
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+}
+
+int MarchingCubeClassifier::classifyRow(const unsigned char* const rows[4], int count, float surfaceValue, unsigned char* cubeIndices, int* activeCubes)
+{
+	// A byte value is inside when value < surfaceValue, which is the same as value <= insideMax
+	int insideMax = (int)ceilf(surfaceValue) - 1;
+	if (insideMax < 0 || insideMax > 254)
+		return classifyRange(rows, 0, count, surfaceValue, cubeIndices, activeCubes, 0); // nothing or everything is inside
+
+	int activeCount = 0;
+	int x = 0;
+#if defined(__AVX2__)
+	// 32 cubes per iteration. Each corner gives a compare mask (0xFF inside, 0x00 outside) that is masked down to its bit in the cube index.
+	const __m256i threshold = _mm256_set1_epi8((char)insideMax);
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i full = _mm256_set1_epi8((char)0xFF);
+	const __m256i bits[8] = {
+		_mm256_set1_epi8(1), _mm256_set1_epi8(2), _mm256_set1_epi8(4), _mm256_set1_epi8(8),
+		_mm256_set1_epi8(16), _mm256_set1_epi8(32), _mm256_set1_epi8(64), _mm256_set1_epi8((char)128)
+	};
+	// corner i is read from row cornerRow[i] at x + cornerOffset[i]
+	static const int cornerRow[8] = { 0, 0, 1, 1, 2, 2, 3, 3 };
+	static const int cornerOffset[8] = { 0, 1, 1, 0, 0, 1, 1, 0 };
+
+	for (; x < count; x += 32)
+	{
+		__m256i cubeIndex = zero;
+		for (int i = 0; i < 8; i++)
+		{
+			__m256i values = _mm256_loadu_si256((const __m256i*)(rows[cornerRow[i]] + x + cornerOffset[i]));
+			__m256i inside = _mm256_cmpeq_epi8(_mm256_min_epu8(values, threshold), values);
+			cubeIndex = _mm256_or_si256(cubeIndex, _mm256_and_si256(inside, bits[i]));
+		}
+		_mm256_storeu_si256((__m256i*)(cubeIndices + x), cubeIndex);
+
+		// cubes with index 0 or 255 do not produce triangles
+		__m256i trivial = _mm256_or_si256(_mm256_cmpeq_epi8(cubeIndex, zero), _mm256_cmpeq_epi8(cubeIndex, full));
+		unsigned int activeMask = ~(unsigned int)_mm256_movemask_epi8(trivial);
+		if (count - x < 32)
+			activeMask &= (1u << (count - x)) - 1; // ignore padding at the end of the row
+		while (activeMask != 0)
+		{
+			activeCubes[activeCount++] = x + lowestBit(activeMask);
+			activeMask &= activeMask - 1;
+		}
+	}
+#endif
+	if (x < count)
+		activeCount = classifyRange(rows, x, count, surfaceValue, cubeIndices, activeCubes, activeCount);
+	return activeCount;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+Classifies a whole row of marching cubes at once.
+A row of cubes is made from four rows of data cells, their corners (y, z), (y + 1, z), (y, z + 1) and (y + 1, z + 1).
+The resulting cube index has the same bit layout as MarchingCube::singleMarchCube, bit i is set when corner i is below the surface value.
+*/
+class MarchingCubeClassifier
+{
+public:
+	// Extra readable elements required after the last value of every data row, and after the last cube index.
+	static const int ROW_PADDING = 32;
+
+	/*
+	Writes the cube index of 'count' cubes to cubeIndices and the x position of every cube that is neither
+	fully inside nor fully outside the surface (index 0 or 255) to activeCubes.
+	rows[i] must hold count + 1 values followed by ROW_PADDING elements. Returns the amount of active cubes.
+	*/
+	static int classifyRow(const unsigned char* const rows[4], int count, float surfaceValue, unsigned char* cubeIndices, int* activeCubes);
+
+	// Scalar version for other data types.
+	template<typename T>
+	static int classifyRow(const T* const rows[4], int count, float surfaceValue, unsigned char* cubeIndices, int* activeCubes)
+	{
+		return classifyRange(rows, 0, count, surfaceValue, cubeIndices, activeCubes, 0);
+	}
+
+private:
+	// Classifies cubes [start, count[ one at a time and appends active cubes after activeCount. Returns the new active count.
+	template<typename T>
+	static int classifyRange(const T* const rows[4], int start, int count, float surfaceValue, unsigned char* cubeIndices, int* activeCubes, int activeCount);
+};
+
+template<typename T>
+inline int MarchingCubeClassifier::classifyRange(const T* const rows[4], int start, int count, float surfaceValue, unsigned char* cubeIndices, int* activeCubes, int activeCount)
+{
+	for (int x = start; x < count; x++)
+	{
+		int cubeIndex = 0;
+		if (rows[0][x] < surfaceValue) cubeIndex |= 1;
+		if (rows[0][x + 1] < surfaceValue) cubeIndex |= 2;
+		if (rows[1][x + 1] < surfaceValue) cubeIndex |= 4;
+		if (rows[1][x] < surfaceValue) cubeIndex |= 8;
+		if (rows[2][x] < surfaceValue) cubeIndex |= 16;
+		if (rows[2][x + 1] < surfaceValue) cubeIndex |= 32;
+		if (rows[3][x + 1] < surfaceValue) cubeIndex |= 64;
+		if (rows[3][x] < surfaceValue) cubeIndex |= 128;
+		cubeIndices[x] = (unsigned char)cubeIndex;
+		if (cubeIndex != 0 && cubeIndex != 255)
+			activeCubes[activeCount++] = x;
+	}
+	return activeCount;
+}
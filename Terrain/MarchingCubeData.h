@@ -1,32 +1,51 @@
-#pragma once
-/**
- * baserad frn http://paulbourke.net/geometry/polygonise/
- * Original frfattare: manitoo  Qt/C++ Coding
- *
- */
-class MarchingCubeData
-{
-public:
-	/**
-	 * Some help functions
-	 */
-
-	 // Gets the correct verticepoint along the edge to better represent the surface
-	static float getOffset(float value1, float value2, float surfaceValue);
-
-	// Interpolates to a point between the input points based on surfacevlue and the inputpoints "height" value in their w.
-	static float3 pointLerp(float4 v1, float4 v2, float surfaceValue);
-
-	// Get a triangle's normal from its vertices.
-	static float3 getNormal(float3 v1, float3 v2, float3 v3);
-
-	// The data tables
-
-	// vertexOffset lists the positions, relative to vertex0, of each of the 8 vertices of a cube
-	static const float vertexOffset[8][3];
-
-	//edgeConnection lists the index of the endpoint vertices for each of the 12 edges of the cube
-	static const int edgeConnection[12][2];
-
-	static const int triangleConnectionTable[256][16];
-};
+#pragma once
+#include <array>
+/**
+ * baserad frn http://paulbourke.net/geometry/polygonise/
+ * Original frfattare: manitoo  Qt/C++ Coding
+ *
+ */
+class MarchingCubeData
+{
+public:
+	/**
+	 * Some help functions
+	 */
+
+	 // Gets the correct verticepoint along the edge to better represent the surface
+	static float getOffset(float value1, float value2, float surfaceValue);
+
+	// Interpolates to a point between the input points based on surfacevlue and the inputpoints "height" value in their w.
+	static float3 pointLerp(float4 v1, float4 v2, float surfaceValue);
+
+	// Get a triangle's normal from its vertices.
+	static float3 getNormal(float3 v1, float3 v2, float3 v3);
+
+	// What a cube index creates, derived from the data tables at compile time so the mesher loops over counts instead of walking to a -1
+	struct CubeCase
+	{
+		unsigned char triangleCount;
+		unsigned char edgeCount;			// edges crossed by the surface
+		unsigned short edgeMask;			// bit i is set if edge i is crossed
+		unsigned char edges[12];			// the crossed edges in increasing order, edgeCount of them
+		unsigned char triangleEdges[15];	// edge of every triangle point, three per triangle in the winding the mesh uses
+		unsigned char cornerPairs[15];		// the two corners of those edges, first corner in the low four bits
+	};
+
+	// The data tables
+
+	// vertexOffset lists the positions, relative to vertex0, of each of the 8 vertices of a cube
+	static const float vertexOffset[8][3];
+
+	//edgeConnection lists the index of the endpoint vertices for each of the 12 edges of the cube
+	static const int edgeConnection[12][2];
+
+	// edgeOwner lists, for each of the 12 edges, the offset of the cube corner the edge starts from and the axis it runs along (0 = x, 1 = y, 2 = z).
+	// Neighbouring cubes that share an edge get the same owner corner and axis, which is used to share vertices between cubes.
+	static const int edgeOwner[12][4];
+
+	static const int triangleConnectionTable[256][16];
+
+	// Indexed by cube index
+	static const std::array<CubeCase, 256> cubeCases;
+};
@@ -1,226 +1,277 @@
-#pragma once
-#include "MarchingCube.h"
-#include "CullingTrees.h"
-#include "DrawableOctree.h"
-#include "CaveCarver.h"
-#include "GameObject.h"
-#include "Graphics.h"
-
-// forward decarations
-class Physics;
-class PathfindingManager;
-
-// Creates and handles the marching cubes and the terrain data
-class MarchingCubeHandler : public GameObject
-{
-private:
-	friend PathfindingManager;
-public:
-	struct CubeRayCastInfo {
-		size_t totalCubes;
-		size_t culledCubes;
-		size_t rayIntersectedCubes;
-		size_t loopIterations;
-		size_t totalTriangles;
-		size_t culledTriangles;
-	};
-private:
-	static const int s_nrCubes = 16;
-	static const int s_totalCubes = s_nrCubes * s_nrCubes * s_nrCubes;
-	MarchingCube m_mcs[s_nrCubes][s_nrCubes][s_nrCubes];
-
-	struct DecorCollection {
-		std::string m_name;
-		struct DecorInstance {
-			float4x4 matrix;
-			float3 color;
-		};
-		std::vector<DecorInstance> m_instances;
-		DecorCollection(std::string name) : m_name(name) {}
-	};
-	std::vector<DecorCollection> m_decor;
-
-
-	std::bitset<s_totalCubes> m_marchingCubeQueueLookup; // quick way of checking if cube data is updated. Used together with queue.
-	std::vector<int3> m_marchingCubeQueue;
-	std::list<int3> m_oldIDs;	// last frame's active IDs
-
-	std::shared_ptr<DrawableOctree<MarchingCube*>> m_octree = std::make_shared<DrawableOctree<MarchingCube*>>(); // contains references to marching cube chunks
-	CubeRayCastInfo m_rayInfo = { 0 };
-
-	std::shared_ptr<TERRAINDATATYPE[]> m_terrainData;	// Basicly a 3D texture
-	int m_sizeX;
-	int m_sizeY;
-	int m_sizeZ;
-	int m_totalSize;
-
-	float m_surfaceValue; // is right now hardcoded both here and in MarchingCube
-	float m_destroyValue; // is right now hardcoded both here and in MarchingCube
-
-	// Colors
-	ConstantBuffer<TerrainColor> m_cbuffer_terrainColor;
-	TerrainColor m_terrainColorData;
-
-	// Scanner
-	enum ScannerState {
-		Scan_Inactive,
-		Scan_Active,
-		Scan_Fade
-	} m_scanningState = Scan_Inactive;
-
-	ConstantBuffer<ScanningProperties>& m_cbuffer_scannerProperties;
-	const float m_scannerBaseMaxDistance = 7.0f;
-	const float m_scannerPowerupMaxDistance = 10.f;
-	float m_scannerMaxCooldown = 4.0f;
-	float m_scannerCooldown = 0;
-	bool m_waitForCooldown = false;
-	float m_scannerAlphaTimer = 0; // keeps track of alpha fade animation
-	float m_scannerActivationTimer = 0;
-	const float m_scannerAlphaFadeTime = 0.5f; // time length of fade
-	const float m_scannerMinimumActivationTime = 1.f; // time until alpha starts to fade
-	float m_scannerAnimationTimer = 0; // keeps track of animation
-	const float m_scannerAnimationLength = 1.5f; // how long the animation takes (in seconds)
-	const float m_scannerForwardFalloffDistance = 0.25f; // additional distance to fade hologram edge
-	float m_scannerMaxDistance = m_scannerBaseMaxDistance; // scanner range
-	const float m_scannerAnimationPower = 4; // scanner speed
-	bool m_scannerUnlimitedCooldown = false;
-
-	std::vector<CaveCarver::StructurePoint> m_structurePoints;		// Structure points used in carving algorithm
-	std::vector<float3> m_playerSpawnPositions;						// The generated player spawn positions
-
-	unsigned int m_latestSeed = 0;
-	struct ImGuiEditInfo {
-		int seed = 0;
-		int size = 60;
-		float scale = 10.f;
-	} editInfo;
-
-private:
-
-	void initDataTexture(int sizeX, int sizeY, int sizeZ);
-	void setTerrainPixel(int x, int y, int z, TERRAINDATATYPE value);
-	TERRAINDATATYPE getTerrainPixel(int x, int y, int z) const;
-	TERRAINDATATYPE getTerrainPixel(float3 pos) const;
-
-	float3 translateWorldToDataSpace(float3 worldPos) const;
-	float3 translateWorldToLocalSpace(float3 worldPos) const;
-
-	// Adds cube index to update queue.
-	// Returns true if added to queue.
-	bool queueMarchingCube(int3 cubeIdx);
-	// Adds pixel's cube index to update queue and aand adjacent cubes the pixel is edgeing.
-	// Returns true if added to queue.
-	bool queueMarchingCube_pixelIndex(int3 pixelIdx);
-
-	// override Drawable
-	void _draw(const float4x4& matrix) override;
-	void _update(double dt) override;
-
-	void read_sceneNode_internal(std::ifstream& file) override;
-	void write_sceneNode_internal(std::ofstream& file) override;
-
-	float3 getTerrainColorFromLocalPosition(float3 localPosition, float3 normal);
-
-	void eraseDecor_sphere(float3 worldPos, float radius);
-
-public:
-	MarchingCubeHandler();
-	~MarchingCubeHandler();
-
-	void imgui_edit() override;
-
-	void init(int sizeX, int sizeY, int sizeZ, float scale);
-	void initTerrainColorData();
-
-	float3 getDataFieldFlow(float3 worldPos, float localGridStepSize = 1.f); // gets normal based on neighboring data cells, based on central difference
-	float3 getDataFieldFlow(int3 pixelIdx, float localGridStepSize = 1.f); // gets normal based on neighboring data cells, based on central difference
-	void visualizeDataField();
-
-	// Octree
-	void initOctree();
-	/*
-	Raycast against terrain mesh (good for long distance, use short raycast for short distances).
-	Returns true if ray collided with any triangles.
-	Parameter 'distance' defines the ray length and will also be overwritten by the rays collision distance.
-	Parameters 'intersectionPosition' and 'intersectionNormal' will be overwritten by the rays intersection point and normal of collision surface.
-	*/
-	bool raycast(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
-	bool longRaycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
-	/*
-	Raycast against terrain mesh (Optimized for short distances).
-	Returns true if ray collided with any triangles.
-	Parameter 'distance' defines the ray length and will also be overwritten by the rays collision distance.
-	Parameters 'intersectionPosition' and 'intersectionNormal' will be overwritten by the rays intersection point and normal of collision surface.
-	*/
-	bool shortRaycast(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
-	bool shortRaycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
-
-	bool raycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal) override;
-
-	/* Returns information on latest raycast call */
-	CubeRayCastInfo getRayCastInfo() const;
-	/* Returns the distance between two points that is obstructed by the terrain */
-	float measureWallThickness(float3 point1, float3 point2);
-
-	// MC handling
-	void initCubes();
-
-	// Mech creating
-	void runAllMarchingCubes(Physics& physics);
-	void runQueuedMarchingCubes(Physics& physics);
-	// without physics
-	void runAllMarchingCubes();
-	void runQueuedMarchingCubes();
-
-	// data reading
-	void setTerrainData(int sizeX, int sizeY, int sizeZ, TERRAINDATATYPE arr[]);
-	void setTerrainData(int sizeX, int sizeY, int sizeZ, std::shared_ptr<TERRAINDATATYPE[]> sp);
-
-	const std::vector<CaveCarver::StructurePoint>& getStructurePoints() const;
-	const std::vector<float3>& getPlayerSpawnPositions() const;
-
-	void drawStructurePoints();
-
-	// Generates data. 
-	void generateData_sphere();
-	void generateData_cheese();
-	void generateData_fill();
-
-	void generateData_testCave(int nrOfPlayers = 2, unsigned int seed = rand());
-
-	void placeDecor();
-
-	// Destroy terrain in a sphere. Radius unit is in data cells
-	void destroySphere(float3 worldPos, float worldRadius);
-	void damageSphere(float3 worldPos, float worldRadius, float smoothingDataRange = 1.f);
-	void damageCylinder(float3 worldPos, float radius = 0.5f, float height = 0.5f, TERRAINDATATYPE strength = 180);
-	void smoothTerrain();
-
-	// check terrain (maybe used for terrain interactions)
-	float getTerrainValue(float3 worldPos) const;
-	bool isInGround(float3 worldPos);
-	bool isOnEdge(int3 nodeIndex) const;
-	bool isOnEdge(float3 worldPos) const;
-
-	float getTriangleMeshSize();
-	float getTerrainDataSize();
-
-	// Sets the physics of cubes near bombs active. 
-	void updateCubesPhysicsActive();
-
-	// Override Drawable
-	virtual DirectX::BoundingBox getLocalBoundingBox() const { return DirectX::BoundingBox(); };
-
-	/*
-	Get scanners cooldown between [0, 1]. 0 = ready to use.
-	Returns -1 if scanner is active.
-	*/
-	float getScannerCooldown() const;
-	bool isScannerActive() const;
-	bool isWaitingForScannerCooldown() const;
-	void setScannerPowerupState(bool state);
-
-	float3 getTerrainColor() const;
-	void relayColorToGraphics();
-};
-
+#pragma once
+#include <atomic>
+#include "MarchingCube.h"
+#include "MarchingCubeTerrain.h"
+#include "TerrainRecorder.h"
+#include "CullingTrees.h"
+#include "DrawableOctree.h"
+#include "GameObject.h"
+#include "Graphics.h"
+
+// forward decarations
+class Physics;
+class PathfindingManager;
+
+/*
+The terrain in the game. MarchingCubeTerrain holds the terrain data and meshes, this draws the chunks, gives them colliders,
+remeshes them on the thread pool and adds decor and the scanner. GameObject is the first base, the scene sees a GameObject.
+*/
+class MarchingCubeHandler : public GameObject, public MarchingCubeTerrain
+{
+public:
+	/*
+	A TerrainQueryView in world space, for AI, audio and gameplay jobs on other threads. Takes the handler's matrix
+	when made on the main thread, see getWorldQueryView, so moving the terrain later doesn't move the view.
+	Its queries are not recorded by startRecording.
+	*/
+	class WorldQueryView
+	{
+	private:
+		std::shared_ptr<const TerrainQueryView> m_view;
+		float4x4 m_world;
+		float4x4 m_invWorld;
+		float4x4 m_invTraWorld;
+		float4x4 m_worldToData;
+	public:
+		WorldQueryView() = default;
+		WorldQueryView(std::shared_ptr<const TerrainQueryView> view, const float4x4& world, const float4x4& worldToData);
+
+		// False before the terrain has published a view
+		bool isValid() const;
+		unsigned long long getEpoch() const;
+		// Parameters as MarchingCubeHandler::raycast
+		bool raycast(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal) const;
+		float getTerrainValue(float3 worldPos) const;
+		bool isInGround(float3 worldPos) const;
+		float3 getDataFieldFlow(float3 worldPos, float localGridStepSize = 1.f) const;
+	};
+
+private:
+	friend PathfindingManager;
+
+	struct DecorCollection {
+		std::string m_name;
+		struct DecorInstance {
+			float4x4 matrix;
+			float3 color;
+		};
+		std::vector<DecorInstance> m_instances;
+		DecorCollection(std::string name) : m_name(name) {}
+	};
+	std::vector<DecorCollection> m_decor;
+
+	// Asynchronous remeshing. A queued chunk is built into a back chunk on the thread pool and swapped in by a later call
+	struct AsyncRemesh {
+		int3 id;
+		std::unique_ptr<MarchingCube> back;
+		float milliseconds = 0;	// worker time of the remesh
+		std::atomic<bool> finished;
+	};
+	std::vector<std::unique_ptr<AsyncRemesh>> m_asyncRemeshes;	// remeshes in flight
+	std::vector<std::unique_ptr<MarchingCube>> m_backCubes;		// unused back chunks
+	std::vector<bool> m_asyncRemeshLookup;						// chunks with a remesh in flight
+	Physics* m_physics = nullptr;	// latest physics given to a mesh run, used when colliders are removed outside of one
+	Physics* m_runPhysics = nullptr;	// physics of the mesh run in progress, null for runs without physics
+
+	std::unique_ptr<TerrainRecorder> m_recorder;	// only while a session is recorded, see startRecording
+
+	// Records the terrain data as it is, read back from the volume
+	void recordDensities();
+
+	// Remesh scheduling. Queued chunks are remeshed visible first, then nearest to the camera
+	float m_remeshCostEstimate = 0.5f;			// average worker milliseconds per chunk, decides how many async remeshes to start
+	std::vector<bool> m_visibleCubes;			// chunks in the view frustum when last drawn
+	std::list<int3> m_oldIDs;	// last frame's active IDs
+
+	std::shared_ptr<DrawableOctree<MarchingCube*>> m_octree = std::make_shared<DrawableOctree<MarchingCube*>>(); // contains references to marching cube chunks
+
+	// Colors
+	ConstantBuffer<TerrainColor> m_cbuffer_terrainColor;
+	TerrainColor m_terrainColorData;
+
+	// Scanner
+	enum ScannerState {
+		Scan_Inactive,
+		Scan_Active,
+		Scan_Fade
+	} m_scanningState = Scan_Inactive;
+
+	ConstantBuffer<ScanningProperties>& m_cbuffer_scannerProperties;
+	const float m_scannerBaseMaxDistance = 7.0f;
+	const float m_scannerPowerupMaxDistance = 10.f;
+	float m_scannerMaxCooldown = 4.0f;
+	float m_scannerCooldown = 0;
+	bool m_waitForCooldown = false;
+	float m_scannerAlphaTimer = 0; // keeps track of alpha fade animation
+	float m_scannerActivationTimer = 0;
+	const float m_scannerAlphaFadeTime = 0.5f; // time length of fade
+	const float m_scannerMinimumActivationTime = 1.f; // time until alpha starts to fade
+	float m_scannerAnimationTimer = 0; // keeps track of animation
+	const float m_scannerAnimationLength = 1.5f; // how long the animation takes (in seconds)
+	const float m_scannerForwardFalloffDistance = 0.25f; // additional distance to fade hologram edge
+	float m_scannerMaxDistance = m_scannerBaseMaxDistance; // scanner range
+	const float m_scannerAnimationPower = 4; // scanner speed
+	bool m_scannerUnlimitedCooldown = false;
+
+	struct ImGuiEditInfo {
+		int seed = 0;
+		int size = 60;
+		float scale = 10.f;
+		int voxelFormat = Voxel_UInt8;
+		bool brickStorage = false;
+	} editInfo;
+
+private:
+
+	// Orders the queue by visibility and distance to the active camera
+	void sortMarchingCubeQueue() override;
+	// Swaps in the finished async remeshes. Returns true if any chunk changed
+	bool swapFinishedRemeshes(Physics& physics);
+	// Waits for every async remesh and swaps them in, used before the chunks or terrain data are changed on the main thread
+	void finishAsyncRemeshes() override;
+	size_t getRemeshesInFlight() const override;
+	// The terrain scale is the scale of the handler
+	void setTerrainScale(float3 scale) override;
+	// Adds decor, the drawable octree and the async remesh chunks
+	void addMemoryUsage(TerrainMemoryReport& report) const override;
+
+	float3 translateWorldToDataSpace(float3 worldPos) const;
+	float3 translateWorldToLocalSpace(float3 worldPos) const;
+
+	// Chunk table, every chunk is a MarchingCube
+	MarchingCube* getCube(int3 cubeIdx) const;
+	MarchingCube& createCube(int3 cubeIdx);
+	std::unique_ptr<MarchingCubeMesh> createCubeMesh(int3 cubeIdx) override;
+	// Removes the chunk's collider and frees it
+	void releaseCube(int3 cubeIdx) override;
+	// Remeshes the chunks on the thread pool, with colliders when the run has physics
+	void remeshCubes(const std::vector<MarchingCubeMesh*>& cubes) override;
+	// Runs the jobs on the thread pool and the calling thread, waits for them without waiting for the async remeshes
+	void runRaycastJobs(size_t jobCount, const std::function<void(size_t job)>& job) override;
+
+	// override Drawable
+	void _draw(const float4x4& matrix) override;
+	void _update(double dt) override;
+
+	void read_sceneNode_internal(std::ifstream& file) override;
+	void write_sceneNode_internal(std::ofstream& file) override;
+
+	float3 getTerrainColorFromLocalPosition(float3 localPosition, float3 normal);
+
+	void eraseDecor_sphere(float3 worldPos, float radius);
+
+public:
+	MarchingCubeHandler();
+	~MarchingCubeHandler();
+
+	void imgui_edit() override;
+
+	using MarchingCubeTerrain::getDataFieldFlow;
+	using MarchingCubeTerrain::isOnEdge;
+
+	/*
+	Records the session's terrain calls to 'path', to replay them with TerrainReplay. The recording starts with the current size
+	and densities, so the terrain replays as it was when recording started. Returns false if the file can't be created.
+	*/
+	bool startRecording(const std::string& path);
+	void stopRecording();
+	bool isRecording() const;
+
+	// As MarchingCubeTerrain::setTerrainData, recorded while a session is
+	void setTerrainData(int sizeX, int sizeY, int sizeZ, unsigned char arr[]);
+	void setTerrainData(int sizeX, int sizeY, int sizeZ, std::shared_ptr<unsigned char[]> sp);
+
+	// nrCubes is the amount of marching cube chunks along each axis, format is how the terrain data stores its cells
+	void init(int sizeX, int sizeY, int sizeZ, float scale, int nrCubes = s_defaultNrCubes, VoxelFormat format = Voxel_UInt8, VoxelStorage storage = Storage_Dense);
+	void initTerrainColorData();
+	float3 getTerrainScale() const override;
+	void generateData_testCave(int nrOfPlayers = 2, unsigned int seed = rand());
+
+	float3 getDataFieldFlow(float3 worldPos, float localGridStepSize = 1.f); // gets normal based on neighboring data cells, based on central difference
+	void visualizeDataField();
+
+	// Octree
+	void initOctree() override;
+	/*
+	Raycast against terrain mesh (good for long distance, use short raycast for short distances).
+	Returns true if ray collided with any triangles.
+	Parameter 'distance' defines the ray length and will also be overwritten by the rays collision distance.
+	Parameters 'intersectionPosition' and 'intersectionNormal' will be overwritten by the rays intersection point and normal of collision surface.
+	*/
+	bool raycast(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
+	/*
+	Raycast against terrain mesh (Optimized for short distances).
+	Returns true if ray collided with any triangles.
+	Parameter 'distance' defines the ray length and will also be overwritten by the rays collision distance.
+	Parameters 'intersectionPosition' and 'intersectionNormal' will be overwritten by the rays intersection point and normal of collision surface.
+	*/
+	bool shortRaycast(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
+	/*
+	Raycast against the density field instead of the meshes, sees edits before their chunks are remeshed (good for line of sight).
+	Hits within a data cell of the mesh raycasts but for rays grazing the surface, and is faster than longRaycast on terrains up to 256^3,
+	see densityRaycast_localSpace. Parameters as raycast.
+	*/
+	bool densityRaycast(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
+
+	bool raycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal) override;
+	/*
+	Raycasts 'count' rays against the terrain mesh at once, parameters as raycast, see raycastBatch_localSpace.
+	Faster than one raycast per ray for many rays, most of all for rays that start near each other.
+	*/
+	void raycastBatch(size_t count, const float3* rayPositions, const float3* rayDirections, const float* distances, RayHit* hits);
+	void raycastBatch_localSpace(size_t count, const float3* rayPositions, const float3* rayDirections, const float* distances, RayHit* hits) override;
+
+	// The latest query view with the handler's current matrix. Call on the main thread, then hand it to any thread
+	WorldQueryView getWorldQueryView() const;
+
+	/* Returns the distance between two points that is obstructed by the terrain */
+	float measureWallThickness(float3 point1, float3 point2);
+
+	// MC handling
+	void initCubes() override;
+
+	// Mech creating
+	void runAllMarchingCubes();
+	void runAllMarchingCubes(Physics& physics);
+	void runQueuedMarchingCubes();
+	void runQueuedMarchingCubes(Physics& physics);
+	/*
+	Pipelined version of runQueuedMarchingCubes, call once per frame. Never waits for the thread pool.
+	Swaps in chunks finished since the last call, then starts remeshing the queued chunks in the background.
+	Chunks keep rendering and colliding with their old mesh until the new one is swapped in.
+	*/
+	void runQueuedMarchingCubes_async(Physics& physics);
+
+	void drawStructurePoints();
+
+	void placeDecor();
+
+	// Edits in world space, see MarchingCubeTerrain for the data space versions. Removes decor in the sphere
+	void destroySphere(float3 worldPos, float worldRadius);
+	void damageSphere(float3 worldPos, float worldRadius, float smoothingDataRange = 1.f);
+	void damageCylinder(float3 worldPos, float radius = 0.5f, float height = 0.5f, float strength = 180);
+
+	// check terrain (maybe used for terrain interactions)
+	float getTerrainValue(float3 worldPos) const;
+	bool isInGround(float3 worldPos);
+	bool isOnEdge(float3 worldPos) const;
+
+	// Sets the physics of cubes near bombs active. 
+	void updateCubesPhysicsActive();
+
+	// Override Drawable
+	virtual DirectX::BoundingBox getLocalBoundingBox() const { return DirectX::BoundingBox(); };
+
+	/*
+	Get scanners cooldown between [0, 1]. 0 = ready to use.
+	Returns -1 if scanner is active.
+	*/
+	float getScannerCooldown() const;
+	bool isScannerActive() const;
+	bool isWaitingForScannerCooldown() const;
+	void setScannerPowerupState(bool state);
+
+	float3 getTerrainColor() const;
+	void relayColorToGraphics();
+};
+
@@ -0,0 +1,1113 @@
+#include "pch.h"
+#include "MarchingCubeMesh.h"
+#include "MarchingCubeData.h"
+#include "MarchingCubeClassifier.h"
+#include "ChunkExtents.h"
+#include "TerrainTrace.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+// init statics 
+int MarchingCubeMesh::s_nrCubes = 10;
+MarchingCubeMesh::MeshMode MarchingCubeMesh::s_meshMode = MarchingCubeMesh::Mesh_TriangleList;
+MarchingCubeMesh::RaycastTree MarchingCubeMesh::s_raycastTree = MarchingCubeMesh::Raycast_Bvh;
+std::shared_ptr<VoxelVolume> MarchingCubeMesh::s_terrainData = nullptr;
+
+struct MarchingCubeMesh::EdgeCache
+{
+	static constexpr unsigned int EMPTY = 0xFFFFFFFF;
+	// [0] is the layer at the cubes' bottom z, [1] at their top z. Each layer holds 3 edges (x, y, z) per data cell.
+	std::vector<unsigned int> layers[2];
+
+	void init(int sizeX, int sizeY)
+	{
+		size_t layerSize = (size_t)(sizeX + 1) * (sizeY + 1) * 3;
+		for (int i = 0; i < 2; i++)
+			layers[i].assign(layerSize, EMPTY);
+	}
+	// Move one step in z. The top layer becomes the bottom and the new top is emptied
+	void nextLayer()
+	{
+		layers[0].swap(layers[1]);
+		std::fill(layers[1].begin(), layers[1].end(), EMPTY);
+	}
+	template<typename Extents>
+	unsigned int& get(const Extents& extents, int x, int y, int layer, int axis)
+	{
+		return layers[layer][(x + y * (extents.x + 1)) * 3 + axis];
+	}
+};
+
+struct MarchingCubeMesh::VoxelSnapshot
+{
+	VoxelFormat format;
+
+	VoxelSnapshot(VoxelFormat format) : format(format) {}
+	virtual ~VoxelSnapshot() {}
+};
+
+template<typename Voxel>
+struct MarchingCubeMesh::VoxelWindow : VoxelSnapshot
+{
+	typedef typename Voxel::Sample Sample;
+	std::vector<Sample> cells;	// one allocation, cell (-1, -1, -1) starts on a cache line
+	Sample* origin = nullptr;	// cell (0, 0, 0)
+	int pitchY = 0;
+	int pitchZ = 0;
+
+	VoxelWindow() : VoxelSnapshot(Voxel::format) {}
+
+	void init(int sizeX, int sizeY, int sizeZ)
+	{
+		pitchY = sizeX + 3;
+		pitchZ = pitchY * (sizeY + 3);
+		// the classifier may read ROW_PADDING elements past the last row
+		size_t count = (size_t)pitchZ * (sizeZ + 3) + MarchingCubeClassifier::ROW_PADDING;
+		const size_t alignment = 64;
+		cells.resize(count + alignment / sizeof(Sample));
+		size_t misalignment = (size_t)cells.data() % alignment;
+		Sample* first = cells.data() + (misalignment ? (alignment - misalignment) / sizeof(Sample) : 0);
+		std::fill(first + (size_t)pitchZ * (sizeZ + 3), first + count, (Sample)0);
+		origin = first + 1 + pitchY + pitchZ;
+	}
+	Sample* row(int y, int z) const
+	{
+		return origin + y * pitchY + z * pitchZ;
+	}
+	// Same as row with the strides of the extents the window was made for, constants for fixed extents
+	template<typename Extents>
+	const Sample* cell(const Extents& extents, int x, int y, int z) const
+	{
+		return origin + x + y * extents.pitchY + z * extents.pitchZ;
+	}
+};
+
+// Per thread buffers holding the classification of a whole chunk between the count and the fill pass
+struct MarchScratch
+{
+	std::vector<unsigned char> cubeIndices;	// every cube of the chunk, one row of cubes after the other
+	std::vector<int> activeCubes;			// x of the active cubes, one row of cubes after the other
+	std::vector<int> rowActiveStart;		// first element in activeCubes of every row, plus the total count
+
+	void init(int sizeX, int sizeY, int sizeZ)
+	{
+		size_t cubeCount = (size_t)sizeX * sizeY * sizeZ;
+		cubeIndices.resize(cubeCount + MarchingCubeClassifier::ROW_PADDING);
+		activeCubes.resize(cubeCount);
+		rowActiveStart.resize((size_t)sizeY * sizeZ + 1);
+	}
+};
+
+// Edges a cube creates the vertices for in the indexed mesh, the edges owned by its own corner.
+// Cubes at the far side of the chunk in x, y and/or z (bit 0, 1 and 2 of the index) also own the edges on that side.
+struct OwnedEdgeMasks
+{
+	int masks[8];
+
+	OwnedEdgeMasks()
+	{
+		for (int side = 0; side < 8; side++)
+		{
+			masks[side] = 0;
+			for (int e = 0; e < 12; e++)
+			{
+				const int* owner = MarchingCubeData::edgeOwner[e];
+				if ((owner[0] == 0 || (side & 1)) && (owner[1] == 0 || (side & 2)) && (owner[2] == 0 || (side & 4)))
+					masks[side] |= 1 << e;
+			}
+		}
+	}
+};
+
+// Gives a vector exactly the capacity of 'count' elements, so a chunk never holds on to the storage of a larger mesh
+template<typename T>
+static void reserveExact(std::vector<T>& buffer, size_t count)
+{
+	buffer.clear();
+	if (buffer.capacity() != count)
+	{
+		buffer.shrink_to_fit();
+		buffer.reserve(count);
+	}
+}
+
+template<typename Voxel>
+void MarchingCubeMesh::copyVoxelWindow(VoxelWindow<Voxel>& window) const
+{
+	typedef typename Voxel::Type Type;
+	typedef typename Voxel::Sample Sample;
+	static thread_local std::vector<Type> cellRow;	// formats read as another type are converted a row at a time
+	int3 totalSizes(m_sizeX * s_nrCubes, m_sizeY * s_nrCubes, m_sizeZ * s_nrCubes);
+	window.init(m_sizeX, m_sizeY, m_sizeZ);
+
+	// part of every row that is inside the data, the rest repeats the edge cell
+	int firstX = m_startDataPos.x - 1;
+	int countX = m_sizeX + 3;
+	int startX = max(firstX, 0);
+	int endX = min(firstX + countX, totalSizes.x);
+	visitVoxelStorage<Voxel>(*s_terrainData, [&](const auto& volume)
+	{
+		for (int iz = -1; iz <= m_sizeZ + 1; iz++)
+		{
+			// Positions outside the data are clamped to the closest edge cell, so the chunks at the border never read a wrapped row
+			int z = Clamp(iz + m_startDataPos.z, 0, totalSizes.z - 1);
+			for (int iy = -1; iy <= m_sizeY + 1; iy++)
+			{
+				int y = Clamp(iy + m_startDataPos.y, 0, totalSizes.y - 1);
+				Sample* out = window.row(iy, iz) - 1;
+				Sample* inside = out + (startX - firstX);
+				if constexpr (std::is_same<Type, Sample>::value)
+					volume.readRow(startX, y, z, endX - startX, inside);
+				else
+				{
+					cellRow.resize(endX - startX);
+					volume.readRow(startX, y, z, endX - startX, cellRow.data());
+					for (int i = 0; i < endX - startX; i++)
+						inside[i] = Voxel::toSample(cellRow[i]);
+				}
+				std::fill(out, out + (startX - firstX), out[startX - firstX]);
+				std::fill(out + (endX - firstX), out + countX, out[endX - firstX - 1]);
+			}
+		}
+	});
+}
+
+template<typename Voxel, typename Extents>
+void MarchingCubeMesh::singleMarchCube(const Extents& extents, int x, int y, int z, int cubeIndex, const typename Voxel::Sample* const rows[4])
+{
+	float4 cubeCorners[8];	// corner with position in xyz and density value in w.
+	getCubeCorners<Voxel>(extents, x, y, z, rows, cubeCorners);
+
+	float3 points[15];
+	float3 normals[5];
+	int triangleCount = getCubeTriangles(cubeIndex, cubeCorners, points, normals);
+
+	VertexData vertexData;
+	for (int i = 0; i < triangleCount; i++)
+	{
+		for (int ip = 0; ip < 3; ip++)
+		{
+			vertexData.position = points[i * 3 + ip];
+			vertexData.normal = normals[i];
+
+			m_buildVertices.push_back(vertexData);
+		}
+	}
+}
+
+int MarchingCubeMesh::getCubeTriangles(int cubeIndex, const float4 cubeCorners[8], float3 points[15], float3 normals[5]) const
+{
+	int triangleCount = 0;
+
+	// Create the triangels. 
+	// The cube case holds the corners of the edge every triangle point lies on, already in the mesh's winding
+	const MarchingCubeData::CubeCase& cubeCase = MarchingCubeData::cubeCases[cubeIndex];
+	for (int i = 0; i < cubeCase.triangleCount; i++)
+	{
+		float3 tri[3];
+		for (int ip = 0; ip < 3; ip++)
+		{
+			int corners = cubeCase.cornerPairs[i * 3 + ip];
+			tri[ip] = MarchingCubeData::pointLerp(cubeCorners[corners & 15], cubeCorners[corners >> 4], m_surfaceValue);
+		}
+
+		float3 norm = MarchingCubeData::getNormal(tri[0], tri[1], tri[2]);
+
+		// if all points are in the same position (happens when middle point equals the surface value)
+		if (norm == float3(0, 0, 0))
+			continue;
+
+		for (int ip = 0; ip < 3; ip++)
+			points[triangleCount * 3 + ip] = tri[ip];
+		normals[triangleCount] = norm;
+		triangleCount++;
+	}
+	return triangleCount;
+}
+
+template<typename Voxel>
+bool MarchingCubeMesh::hasCornerOnSurface(int x, const typename Voxel::Sample* const rows[4]) const
+{
+	float surfaceSample = m_surfaceValue * Voxel::scale;
+	for (int i = 0; i < 4; i++)
+	{
+		if (rows[i][x] == surfaceSample || rows[i][x + 1] == surfaceSample)
+			return true;
+	}
+	return false;
+}
+
+template<typename Voxel, typename Extents>
+void MarchingCubeMesh::getCubeCorners(const Extents& extents, int x, int y, int z, const typename Voxel::Sample* const rows[4], float4 cubeCorners[8]) const
+{
+	for (int i = 0; i < 8; i++)
+	{
+		int ox = (int)MarchingCubeData::vertexOffset[i][0];
+		int oy = (int)MarchingCubeData::vertexOffset[i][1];
+		int oz = (int)MarchingCubeData::vertexOffset[i][2];
+		float density = (float)rows[oy + oz * 2][x + ox] * (1.f / Voxel::scale);
+
+		// Positions are scaled to make the whole marching cube unit length.
+		cubeCorners[i] = float4((x + ox) * extents.inverseX, (y + oy) * extents.inverseY, (z + oz) * extents.inverseZ, density);
+	}
+}
+
+template<typename Voxel, typename Extents>
+void MarchingCubeMesh::singleMarchCube_indexed(const Extents& extents, int x, int y, int z, int cubeIndex, const typename Voxel::Sample* const rows[4], const VoxelWindow<Voxel>& window, EdgeCache& cache)
+{
+	float4 cubeCorners[8];	// corner with position in xyz and density value in w.
+	getCubeCorners<Voxel>(extents, x, y, z, rows, cubeCorners);
+
+	// Same triangle order as singleMarchCube, but each edge point is looked up in the edge cache
+	const MarchingCubeData::CubeCase& cubeCase = MarchingCubeData::cubeCases[cubeIndex];
+	for (int i = 0; i < cubeCase.triangleCount; i++)
+	{
+		const unsigned char* edges = &cubeCase.triangleEdges[i * 3];
+		float3 tri[3];
+		for (int ip = 0; ip < 3; ip++)
+			tri[ip] = getEdgePosition(extents, x, y, edges[ip], cubeCorners, cache);
+
+		// skip triangles without area (happens when a corner equals the surface value), before any vertex is created for them
+		if ((tri[1] - tri[0]).Cross(tri[2] - tri[0]) == float3(0, 0, 0))
+			continue;
+
+		for (int ip = 0; ip < 3; ip++)
+			m_indices.push_back(getEdgeVertex(extents, x, y, z, edges[ip], tri[ip], cubeCorners, window, cache));
+	}
+}
+
+template<typename Extents>
+float3 MarchingCubeMesh::getEdgePosition(const Extents& extents, int x, int y, int edgeIndex, const float4 cubeCorners[8], EdgeCache& cache)
+{
+	const int* owner = MarchingCubeData::edgeOwner[edgeIndex];
+	unsigned int cached = cache.get(extents, x + owner[0], y + owner[1], owner[2], owner[3]);
+	if (cached != EdgeCache::EMPTY)
+		return m_buildVertices[cached].position;
+	return MarchingCubeData::pointLerp(cubeCorners[MarchingCubeData::edgeConnection[edgeIndex][0]], cubeCorners[MarchingCubeData::edgeConnection[edgeIndex][1]], m_surfaceValue);
+}
+
+template<typename Voxel, typename Extents>
+unsigned int MarchingCubeMesh::getEdgeVertex(const Extents& extents, int x, int y, int z, int edgeIndex, const float3& position, const float4 cubeCorners[8], const VoxelWindow<Voxel>& window, EdgeCache& cache)
+{
+	const int* owner = MarchingCubeData::edgeOwner[edgeIndex];
+	unsigned int& cached = cache.get(extents, x + owner[0], y + owner[1], owner[2], owner[3]);
+	if (cached != EdgeCache::EMPTY)
+		return cached;
+
+	int a = MarchingCubeData::edgeConnection[edgeIndex][0];
+	int b = MarchingCubeData::edgeConnection[edgeIndex][1];
+	const float4& ca = cubeCorners[a];
+	const float4& cb = cubeCorners[b];
+	float t = (m_surfaceValue - ca.w) / (cb.w - ca.w);
+
+	// Smooth normal from the interpolated density gradient of the two corners
+	int3 ia(x + (int)MarchingCubeData::vertexOffset[a][0], y + (int)MarchingCubeData::vertexOffset[a][1], z + (int)MarchingCubeData::vertexOffset[a][2]);
+	int3 ib(x + (int)MarchingCubeData::vertexOffset[b][0], y + (int)MarchingCubeData::vertexOffset[b][1], z + (int)MarchingCubeData::vertexOffset[b][2]);
+	float3 ga = getCornerGradient(extents, window, ia.x, ia.y, ia.z);
+	float3 gb = getCornerGradient(extents, window, ib.x, ib.y, ib.z);
+	float3 normal = ga + (gb - ga) * t;
+	if (normal.LengthSquared() < 0.00001f) // flat gradient, fall back to the edge direction towards air
+		normal = (ca.w < cb.w) ? float3((float)(ib.x - ia.x), (float)(ib.y - ia.y), (float)(ib.z - ia.z)) : float3((float)(ia.x - ib.x), (float)(ia.y - ib.y), (float)(ia.z - ib.z));
+	normal.Normalize();
+
+	VertexData vertexData;
+	vertexData.position = position;
+	vertexData.normal = normal;
+	cached = (unsigned int)m_buildVertices.size();
+	m_buildVertices.push_back(vertexData);
+	return cached;
+}
+
+template<typename Voxel, typename Extents>
+float3 MarchingCubeMesh::getCornerGradient(const Extents& extents, const VoxelWindow<Voxel>& window, int x, int y, int z) const
+{
+	const typename Voxel::Sample* cell = window.cell(extents, x, y, z);
+	float3 gradient(
+		(float)cell[1] - (float)cell[-1],
+		(float)cell[extents.pitchY] - (float)cell[-extents.pitchY],
+		(float)cell[extents.pitchZ] - (float)cell[-extents.pitchZ]);
+	return gradient * (1.f / Voxel::scale);
+}
+
+void MarchingCubeMesh::marchCubes()
+{
+	dispatchVoxelFormat(s_terrainData->getFormat(), [&](auto voxel)
+	{
+		typedef decltype(voxel) Voxel;
+		// The chunk sizes maps use, anything else takes the runtime sized version
+		if (m_sizeX == m_sizeY && m_sizeY == m_sizeZ)
+		{
+			switch (m_sizeX)
+			{
+			case 4:
+				marchCubes<Voxel>(FixedExtents<4>());
+				return;
+			case 8:
+				marchCubes<Voxel>(FixedExtents<8>());
+				return;
+			case 16:
+				marchCubes<Voxel>(FixedExtents<16>());
+				return;
+			case 32:
+				marchCubes<Voxel>(FixedExtents<32>());
+				return;
+			}
+		}
+		marchCubes<Voxel>(RuntimeExtents(m_sizeX, m_sizeY, m_sizeZ));
+	});
+}
+
+template<typename Voxel, typename Extents>
+void MarchingCubeMesh::marchCubes(const Extents& extents)
+{
+	typedef typename Voxel::Sample Sample;
+	static thread_local EdgeCache cache;
+	static thread_local MarchScratch scratch;
+	static thread_local VoxelWindow<Voxel> localWindow;
+	static thread_local std::vector<unsigned int> keptRowStart;
+	static const OwnedEdgeMasks ownedEdges;
+	int rowCount = extents.y * extents.z;
+
+	// Rows outside the dirty region can be kept if the current mesh is a triangle list with known rows.
+	// They are copied from its vertices, which stay unchanged until buildMesh replaces them
+	bool wasIndexed = m_indexed;
+	m_indexed = (s_meshMode == Mesh_Indexed);
+	bool keepRows = !m_dirtyAll && !m_indexed && !wasIndexed && m_vertices && (int)m_rowVertexStart.size() == rowCount + 1 && m_vertices->size() == m_rowVertexStart[rowCount];
+	if (keepRows)
+		keptRowStart.swap(m_rowVertexStart);
+	m_rowVertexStart.resize(m_indexed ? 0 : rowCount + 1);
+
+	if (m_indexed)
+		cache.init(extents.x, extents.y);
+	scratch.init(extents.x, extents.y, extents.z);
+	// Both passes read the same snapshot, so the counts of the first pass hold for the second even while the data is edited.
+	// Builds on a worker got theirs from snapshotTerrainData on the main thread
+	bool useSnapshot = m_snapshotTaken && m_snapshot->format == Voxel::format;
+	m_snapshotTaken = false;
+	if (!useSnapshot)
+		copyVoxelWindow(localWindow);
+	const VoxelWindow<Voxel>& window = useSnapshot ? static_cast<const VoxelWindow<Voxel>&>(*m_snapshot) : localWindow;
+	const Sample* rows[4];
+	float surfaceSample = m_surfaceValue * Voxel::scale;
+
+	// First pass, classify every row and count what the chunk creates so the mesh storage is allocated once
+	size_t triangleCount = 0;
+	size_t edgeCount = 0;
+	int activeTotal = 0;
+	for (int iz = 0; iz < extents.z; iz++)
+	{
+		for (int iy = 0; iy < extents.y; iy++)
+		{
+			int row = iy + iz * extents.y;
+			scratch.rowActiveStart[row] = activeTotal;
+			if (!m_indexed)
+				m_rowVertexStart[row] = (unsigned int)triangleCount * 3;
+			if (keepRows && !isRowDirty(iy, iz))
+			{
+				triangleCount += (keptRowStart[row + 1] - keptRowStart[row]) / 3;
+				continue;
+			}
+
+			for (int i = 0; i < 4; i++)
+				rows[i] = window.cell(extents, 0, iy + (i & 1), iz + (i >> 1));
+			unsigned char* cubeIndices = &scratch.cubeIndices[(size_t)row * extents.x];
+			int* activeCubes = &scratch.activeCubes[activeTotal];
+			int activeCount = MarchingCubeClassifier::classifyRow(rows, extents.x, surfaceSample, cubeIndices, activeCubes);
+
+			activeTotal += activeCount;
+			for (int i = 0; i < activeCount; i++)
+			{
+				int cubeIndex = cubeIndices[activeCubes[i]];
+				if (!m_indexed && hasCornerOnSurface<Voxel>(activeCubes[i], rows))
+				{
+					// some triangles may lack area and are left out, build them to get the exact count
+					float4 cubeCorners[8];
+					float3 points[15];
+					float3 normals[5];
+					getCubeCorners<Voxel>(extents, activeCubes[i], iy, iz, rows, cubeCorners);
+					triangleCount += getCubeTriangles(cubeIndex, cubeCorners, points, normals);
+				}
+				else
+					triangleCount += MarchingCubeData::cubeCases[cubeIndex].triangleCount;
+				if (m_indexed)
+				{
+					int side = (activeCubes[i] == extents.x - 1) | ((iy == extents.y - 1) << 1) | ((iz == extents.z - 1) << 2);
+					edgeCount += std::bitset<12>(MarchingCubeData::cubeCases[cubeIndex].edgeMask & ownedEdges.masks[side]).count();
+				}
+			}
+		}
+	}
+	scratch.rowActiveStart[rowCount] = activeTotal;
+	if (!m_indexed)
+		m_rowVertexStart[rowCount] = (unsigned int)triangleCount * 3;
+
+	// The triangle list count is exact. Indexed counts are upper bounds, exact unless a corner equals the surface value
+	if (m_indexed)
+	{
+		reserveExact(m_buildVertices, edgeCount);
+		m_indices.reserve(triangleCount * 3);
+	}
+	else
+		reserveExact(m_buildVertices, triangleCount * 3);
+
+	// Second pass, march the active cubes. Rows without any are not read again
+	for (int iz = 0; iz < extents.z; iz++)
+	{
+		for (int iy = 0; iy < extents.y; iy++)
+		{
+			int row = iy + iz * extents.y;
+			if (keepRows && !isRowDirty(iy, iz))
+			{
+				m_buildVertices.insert(m_buildVertices.end(), m_vertices->begin() + keptRowStart[row], m_vertices->begin() + keptRowStart[row + 1]);
+				continue;
+			}
+			int begin = scratch.rowActiveStart[row];
+			int end = scratch.rowActiveStart[row + 1];
+			if (begin == end)
+				continue;
+			for (int i = 0; i < 4; i++)
+				rows[i] = window.cell(extents, 0, iy + (i & 1), iz + (i >> 1));
+			const unsigned char* cubeIndices = &scratch.cubeIndices[(size_t)row * extents.x];
+
+			for (int i = begin; i < end; i++)
+			{
+				int ix = scratch.activeCubes[i];
+				if (m_indexed)
+					singleMarchCube_indexed<Voxel>(extents, ix, iy, iz, cubeIndices[ix], rows, window, cache);
+				else
+					singleMarchCube<Voxel>(extents, ix, iy, iz, cubeIndices[ix], rows);
+			}
+		}
+		if (m_indexed)
+			cache.nextLayer();
+	}
+}
+
+void MarchingCubeMesh::buildRaycastTree()
+{
+	// a new one every time, query views may still hold the previous one
+	size_t triangleCount = m_indexed ? m_indices.size() / 3 : m_vertexCount / 3;
+	if (triangleCount == 0)
+	{
+		m_raycastMesh.reset();
+		return;
+	}
+	std::shared_ptr<RaycastMesh> raycastMesh = std::make_shared<RaycastMesh>();
+	float3 boxMax;
+	getTerrainBounds(raycastMesh->m_boxMin, boxMax);
+	raycastMesh->m_toLocal = (float)s_nrCubes;
+	raycastMesh->m_triangleCount = triangleCount;
+	if (s_raycastTree == Raycast_Bvh)
+	{
+		TerrainTrace::Scope scope("bvh build", getChunkId());
+		buildBvh(*raycastMesh);
+	}
+	else
+	{
+		TerrainTrace::Scope scope("octree fill", getChunkId());
+		fillOctree(*raycastMesh);
+	}
+	m_raycastMesh = std::move(raycastMesh);
+}
+
+void MarchingCubeMesh::buildBvh(RaycastMesh& raycastMesh) const
+{
+	// the raycast mesh shares the vertices, indexed ones stay after the chunk releases them once uploaded
+	raycastMesh.m_vertices = m_vertices;
+	raycastMesh.m_bvh.build(&m_vertices->data()->position, sizeof(VertexData), m_indexed ? m_indices.data() : nullptr, raycastMesh.m_triangleCount);
+}
+
+void MarchingCubeMesh::fillOctree(RaycastMesh& raycastMesh) const
+{
+	size_t triangleCount = raycastMesh.m_triangleCount;
+	const std::vector<VertexData>& vertices = *m_vertices;
+	TerrainOctree<Triangle>& octree = raycastMesh.m_octree;
+	octree.initialize(float3(0, 0, 0), float3(1, 1, 1), 3, triangleCount);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		Triangle tri;
+		for (int ip = 0; ip < 3; ip++)
+			tri.points[ip] = m_indexed ? vertices[m_indices[i * 3 + ip]] : vertices[i * 3 + ip];
+		float3 pmin, pmax;
+		pmin.x = min(tri.points[0].position.x, min(tri.points[1].position.x, tri.points[2].position.x));
+		pmin.y = min(tri.points[0].position.y, min(tri.points[1].position.y, tri.points[2].position.y));
+		pmin.z = min(tri.points[0].position.z, min(tri.points[1].position.z, tri.points[2].position.z));
+
+		pmax.x = max(tri.points[0].position.x, max(tri.points[1].position.x, tri.points[2].position.x));
+		pmax.y = max(tri.points[0].position.y, max(tri.points[1].position.y, tri.points[2].position.y));
+		pmax.z = max(tri.points[0].position.z, max(tri.points[1].position.z, tri.points[2].position.z));
+		octree.add(tri, pmin, pmax);
+	}
+	octree.finish();
+}
+
+MarchingCubeMesh::MarchingCubeMesh()
+{
+	m_sizeX = 0;
+	m_sizeY = 0;
+	m_sizeZ = 0;
+	m_surfaceValue = 126.f;
+	m_destroyValue = 255.f;
+	m_startDataPos = int3(0, 0, 0);
+	m_indexed = false;
+	m_vertexCount = 0;
+	m_indexCount = 0;
+	m_dirtyMin = int3(0, 0, 0);
+	m_dirtyMax = int3(-1, -1, -1);
+	m_dirtyAll = true;
+	m_snapshotTaken = false;
+}
+
+MarchingCubeMesh::~MarchingCubeMesh()
+{
+}
+
+void MarchingCubeMesh::buildMesh()
+{
+	// clear former data, the vertices are replaced once marchCubes has kept the unchanged rows
+	m_indices.clear();
+
+	// generate new data
+	{
+		TerrainTrace::Scope scope("march", getChunkId());
+		marchCubes();
+		m_buildVertices.shrink_to_fit(); // indexed meshes reserve an upper bound, marchCubes reserves the exact size for triangle lists
+		m_vertexCount = m_buildVertices.size();
+		m_vertices = std::make_shared<const std::vector<VertexData>>(std::move(m_buildVertices));
+		m_buildVertices.clear();
+		m_indexCount = m_indexed ? m_indices.size() : 0;
+		scope.setTriangles(getTriangleCount());
+	}
+
+	buildRaycastTree();
+	clearDirty();
+}
+
+void MarchingCubeMesh::releaseUploadedData()
+{
+	if (m_indexed)
+		m_vertices.reset(); // triangle lists are kept for the next partial remesh
+	m_indices.clear();
+	m_indices.shrink_to_fit();
+}
+
+void MarchingCubeMesh::markDirty(int3 cellMin, int3 cellMax)
+{
+	if (m_dirtyMin.x > m_dirtyMax.x)
+	{
+		m_dirtyMin = cellMin;
+		m_dirtyMax = cellMax;
+		return;
+	}
+	m_dirtyMin = int3(min(m_dirtyMin.x, cellMin.x), min(m_dirtyMin.y, cellMin.y), min(m_dirtyMin.z, cellMin.z));
+	m_dirtyMax = int3(max(m_dirtyMax.x, cellMax.x), max(m_dirtyMax.y, cellMax.y), max(m_dirtyMax.z, cellMax.z));
+}
+
+void MarchingCubeMesh::markAllDirty()
+{
+	m_dirtyAll = true;
+}
+
+bool MarchingCubeMesh::isDirty() const
+{
+	return m_dirtyAll || m_dirtyMin.x <= m_dirtyMax.x;
+}
+
+bool MarchingCubeMesh::isRowDirty(int y, int z) const
+{
+	return m_dirtyMin.y <= y && y <= m_dirtyMax.y && m_dirtyMin.z <= z && z <= m_dirtyMax.z;
+}
+
+void MarchingCubeMesh::clearDirty()
+{
+	m_dirtyMin = int3(0, 0, 0);
+	m_dirtyMax = int3(-1, -1, -1);
+	m_dirtyAll = false;
+}
+
+void MarchingCubeMesh::clearMesh()
+{
+	clearDirty();
+	m_rowVertexStart.clear();
+	m_vertices.reset();
+	m_indices.clear();
+	m_indices.shrink_to_fit();
+	m_vertexCount = 0;
+	m_indexCount = 0;
+	buildRaycastTree();
+}
+
+void MarchingCubeMesh::takeRemeshState(MarchingCubeMesh& front)
+{
+	m_sizeX = front.m_sizeX;
+	m_sizeY = front.m_sizeY;
+	m_sizeZ = front.m_sizeZ;
+	m_startDataPos = front.m_startDataPos;
+
+	m_dirtyMin = front.m_dirtyMin;
+	m_dirtyMax = front.m_dirtyMax;
+	m_dirtyAll = front.m_dirtyAll;
+	front.clearDirty();
+	m_snapshotTaken = false;
+
+	// a partial remesh keeps rows of the front mesh
+	m_indexed = front.m_indexed;
+	m_vertices.reset();
+	m_rowVertexStart.clear();
+	if (!m_dirtyAll && !m_indexed)
+	{
+		m_vertices = front.m_vertices; // shared, the front chunk keeps drawing them
+		m_rowVertexStart = front.m_rowVertexStart;
+	}
+}
+
+void MarchingCubeMesh::swapMesh(MarchingCubeMesh& other)
+{
+	std::swap(m_vertices, other.m_vertices);
+	std::swap(m_indices, other.m_indices);
+	std::swap(m_indexed, other.m_indexed);
+	std::swap(m_rowVertexStart, other.m_rowVertexStart);
+	std::swap(m_vertexCount, other.m_vertexCount);
+	std::swap(m_indexCount, other.m_indexCount);
+	std::swap(m_raycastMesh, other.m_raycastMesh);
+}
+
+void MarchingCubeMesh::snapshotTerrainData()
+{
+	dispatchVoxelFormat(s_terrainData->getFormat(), [&](auto voxel)
+	{
+		typedef decltype(voxel) Voxel;
+		if (!m_snapshot || m_snapshot->format != Voxel::format)
+			m_snapshot = std::make_unique<VoxelWindow<Voxel>>();
+		copyVoxelWindow(static_cast<VoxelWindow<Voxel>&>(*m_snapshot));
+	});
+	m_snapshotTaken = true;
+}
+
+void MarchingCubeMesh::setStartDataPos(int3 pos)
+{
+	m_startDataPos = pos;
+}
+
+int3 MarchingCubeMesh::getStartDataPos() const
+{
+	return m_startDataPos;
+}
+
+int3 MarchingCubeMesh::getChunkId() const
+{
+	return int3(m_startDataPos.x / max(m_sizeX, 1), m_startDataPos.y / max(m_sizeY, 1), m_startDataPos.z / max(m_sizeZ, 1));
+}
+
+void MarchingCubeMesh::getTerrainBounds(float3& boxMin, float3& boxMax) const
+{
+	float3 totalSizes((float)(m_sizeX * s_nrCubes), (float)(m_sizeY * s_nrCubes), (float)(m_sizeZ * s_nrCubes));
+	boxMin = float3((float)m_startDataPos.x, (float)m_startDataPos.y, (float)m_startDataPos.z) / totalSizes;
+	boxMax = boxMin + float3(1.f, 1.f, 1.f) / (float)s_nrCubes;
+}
+
+void MarchingCubeMesh::setTerrainData(std::shared_ptr<VoxelVolume> data)
+{
+	s_terrainData = data;
+}
+
+void MarchingCubeMesh::setNrCubes(int nr)
+{
+	s_nrCubes = nr;
+}
+
+void MarchingCubeMesh::setMeshMode(MeshMode mode)
+{
+	s_meshMode = mode;
+}
+
+MarchingCubeMesh::MeshMode MarchingCubeMesh::getMeshMode()
+{
+	return s_meshMode;
+}
+
+void MarchingCubeMesh::setRaycastTree(RaycastTree tree)
+{
+	s_raycastTree = tree;
+}
+
+MarchingCubeMesh::RaycastTree MarchingCubeMesh::getRaycastTree()
+{
+	return s_raycastTree;
+}
+
+void MarchingCubeMesh::setDataSizes(int x, int y, int z)
+{
+	m_sizeX = x;
+	m_sizeY = y;
+	m_sizeZ = z;
+}
+
+void MarchingCubeMesh::setDataSizes(int3 sizes)
+{
+	m_sizeX = sizes.x;
+	m_sizeY = sizes.y;
+	m_sizeZ = sizes.z;
+}
+
+std::vector<float3> MarchingCubeMesh::getVertexPositions()
+{
+	std::vector<float3> vec;
+	if (!m_vertices)
+		return vec;
+	vec.resize(m_vertices->size());
+
+	for (size_t i = 0; i < m_vertices->size(); i++)
+	{
+		vec[i] = (*m_vertices)[i].position;
+	}
+	return vec;
+}
+
+int MarchingCubeMesh::getTriangleDataSize()
+{
+	return (int)m_vertexCount;
+}
+
+int MarchingCubeMesh::getTriangleCount()
+{
+	return (int)(m_indexed ? m_indexCount : m_vertexCount) / 3;
+}
+
+size_t MarchingCubeMesh::getMeshDataSize()
+{
+	size_t size = m_vertexCount * sizeof(VertexData);
+	if (m_indexed)
+		size += m_indexCount * (m_vertexCount > 0xFFFF ? sizeof(unsigned int) : sizeof(unsigned short)); // 16 bit indices when they fit, see MarchingCube
+	return size;
+}
+
+size_t MarchingCubeMesh::getOctreeMemorySize() const
+{
+	return m_raycastMesh ? m_raycastMesh->getMemorySize() : 0;
+}
+
+std::shared_ptr<const MarchingCubeMesh::RaycastMesh> MarchingCubeMesh::getRaycastMesh() const
+{
+	return m_raycastMesh;
+}
+
+size_t MarchingCubeMesh::RaycastMesh::getTriangleCount() const
+{
+	return m_triangleCount;
+}
+
+size_t MarchingCubeMesh::RaycastMesh::getMemorySize() const
+{
+	return sizeof(RaycastMesh) + m_octree.getMemorySize() + m_bvh.getMemorySize();
+}
+
+void MarchingCubeMesh::addMemoryUsage(TerrainMemoryReport::Chunk& chunk) const
+{
+	chunk.triangles += (m_indexed ? m_indexCount : m_vertexCount) / 3;
+	chunk.bytes[TerrainMemoryReport::Memory_ChunkObjects] += sizeof(MarchingCubeMesh);
+	size_t vertexBytes = m_vertices ? m_vertices->capacity() * sizeof(VertexData) : 0;
+	chunk.bytes[TerrainMemoryReport::Memory_MeshData] += vertexBytes + (m_indices.capacity() + m_rowVertexStart.capacity()) * sizeof(unsigned int);
+	chunk.bytes[TerrainMemoryReport::Memory_TriangleOctree] += getOctreeMemorySize();
+	// released indexed vertices stay for the BVH
+	if (m_raycastMesh && m_raycastMesh->m_vertices && m_raycastMesh->m_vertices != m_vertices)
+		chunk.bytes[TerrainMemoryReport::Memory_TriangleOctree] += m_raycastMesh->m_vertices->capacity() * sizeof(VertexData);
+}
+
+// Möller-Trumbore, triangles are hit from both sides. Returns the distance along the normalized direction
+static bool intersectRayTriangle(const float3& origin, const float3& direction, const float3& v0, const float3& v1, const float3& v2, float& distance)
+{
+	const float epsilon = 1e-20f;
+	float3 edge1 = v1 - v0;
+	float3 edge2 = v2 - v0;
+	float3 p = direction.Cross(edge2);
+	float det = edge1.Dot(p);
+	if (det > -epsilon && det < epsilon)
+		return false; // parallel to the triangle
+	float inverseDet = 1.f / det;
+	float3 s = origin - v0;
+	float u = s.Dot(p) * inverseDet;
+	if (u < 0.f || u > 1.f)
+		return false;
+	float3 q = s.Cross(edge1);
+	float v = direction.Dot(q) * inverseDet;
+	if (v < 0.f || u + v > 1.f)
+		return false;
+	float t = edge2.Dot(q) * inverseDet;
+	if (t < 0.f)
+		return false;
+	distance = t;
+	return true;
+}
+
+static float3 calcFlatNormal(const float3& p0, const float3& p1, const float3& p2)
+{
+	float3 normal = (p1 - p0).Cross(p2 - p0);
+	normal.Normalize();
+	return normal;
+}
+
+template<typename Test, typename Visit>
+void MarchingCubeMesh::RaycastMesh::visitTriangleNodes(float3 direction, int mask, Test test, Visit visit) const
+{
+	struct OctreeTriangles {
+		const Triangle* triangles;
+		const float3& getPosition(unsigned int i, int corner) const { return triangles[i].points[corner].position; }
+	};
+	struct BvhTriangles {
+		const unsigned int* indices;
+		const VertexData* vertices;
+		const float3& getPosition(unsigned int i, int corner) const { return vertices[indices[i * 3 + corner]].position; }
+	};
+	if (!m_bvh.empty())
+	{
+		const unsigned int* indices = m_bvh.getIndices();
+		m_bvh.visitNodes(direction, mask, test, [&](unsigned int first, unsigned int count, int nodeMask)
+		{
+			visit(BvhTriangles{ indices + first * 3, m_vertices->data() }, count, nodeMask);
+		});
+	}
+	else
+	{
+		m_octree.visitNodes(direction, mask, test, [&](const Triangle* triangles, unsigned int count, int nodeMask)
+		{
+			visit(OctreeTriangles{ triangles }, count, nodeMask);
+		});
+	}
+}
+
+bool MarchingCubeMesh::RaycastMesh::raycast(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal, size_t& tests) const
+{
+	if (rayDirection.Length() == 0 || distance == 0)
+		return false;
+
+	// Transform to the chunk's local space, a translation and a uniform scale
+	const float3& boxMin = m_boxMin;
+	float toLocal = m_toLocal;
+	float3 lrayPos = (rayPosition - boxMin) * toLocal;
+	float3 lrayPosDest = (rayPosition + rayDirection * distance - boxMin) * toLocal;
+	float3 lrayDir = lrayPosDest - lrayPos;
+	float lrayDistance = lrayDir.Length();
+	lrayDir /= lrayDistance;
+	// triangle intersection tests in the tree nodes the ray passes, a hit shortens the ray so nodes behind it are skipped
+	float tmin = -1;
+	const float3* hitTriangle[3] = { nullptr };
+	float3 inverseDirection = inverseRayDirection(lrayDir);
+	visitTriangleNodes(lrayDir, 1, [&](const float3& nodeMin, const float3& nodeMax, int)
+	{
+		float entry;
+		return intersectRayBox(lrayPos, inverseDirection, lrayDistance, nodeMin, nodeMax, entry) ? 1 : 0;
+	},
+	[&](const auto& triangles, unsigned int count, int)
+	{
+		tests += count;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const float3& p0 = triangles.getPosition(i, 0);
+			const float3& p1 = triangles.getPosition(i, 1);
+			const float3& p2 = triangles.getPosition(i, 2);
+			float triDistance = lrayDistance;
+			if (intersectRayTriangle(lrayPos, lrayDir, p0, p1, p2, triDistance))
+			{
+				if (triDistance <= lrayDistance && (!hitTriangle[0] || triDistance < tmin))
+				{
+					tmin = triDistance;
+					lrayDistance = triDistance;
+					hitTriangle[0] = &p0, hitTriangle[1] = &p1, hitTriangle[2] = &p2;
+				}
+			}
+		}
+	});
+	// calculate result
+	if (hitTriangle[0])
+	{
+		//hit
+		float3 lPoint = lrayPos + lrayDir * tmin; // position
+		float3 lNormal = calcFlatNormal(*hitTriangle[0], *hitTriangle[1], *hitTriangle[2]); // normal, the uniform scale keeps its direction
+
+		// position
+		intersectionPosition = lPoint / toLocal + boxMin;
+		// normal
+		intersectionNormal = lNormal;
+		// distance
+		distance = (intersectionPosition - rayPosition).Length();
+		return true;
+	}
+	else
+		return false; // miss
+}
+
+int MarchingCubeMesh::RaycastMesh::raycastPacket(RayPacket& packet, int lanes, size_t& tests) const
+{
+	lanes &= (1 << s_packetSize) - 1;
+	if (lanes == 0)
+		return 0;
+
+	// Transform to the chunk's local space like raycast, structure of arrays with a lane per ray.
+	// Lanes not in 'lanes' repeat a ray that is, with a length that can't hit anything, so their math stays finite
+	const float3& boxMin = m_boxMin;
+	float toLocal = m_toLocal;
+	int firstLane = 0;
+	while (!(lanes & (1 << firstLane)))
+		firstLane++;
+	alignas(32) float origin[3][s_packetSize], direction[3][s_packetSize], inverseDirection[3][s_packetSize];
+	alignas(32) float nearest[s_packetSize];	// ray length of every lane, shortened to its nearest hit so far
+	for (int i = 0; i < s_packetSize; i++)
+	{
+		bool active = (lanes & (1 << i)) != 0;
+		int lane = active ? i : firstLane;
+		float3 lrayPos = (packet.positions[lane] - boxMin) * toLocal;
+		float3 lrayPosDest = (packet.positions[lane] + packet.directions[lane] * packet.distances[lane] - boxMin) * toLocal;
+		float3 lrayDir = lrayPosDest - lrayPos;
+		float lrayDistance = lrayDir.Length();
+		lrayDir /= lrayDistance;
+		float3 lrayInverse = inverseRayDirection(lrayDir);
+		origin[0][i] = lrayPos.x, origin[1][i] = lrayPos.y, origin[2][i] = lrayPos.z;
+		direction[0][i] = lrayDir.x, direction[1][i] = lrayDir.y, direction[2][i] = lrayDir.z;
+		inverseDirection[0][i] = lrayInverse.x, inverseDirection[1][i] = lrayInverse.y, inverseDirection[2][i] = lrayInverse.z;
+		nearest[i] = active ? lrayDistance : -1.f;
+	}
+	float3 nearDirection(direction[0][firstLane], direction[1][firstLane], direction[2][firstLane]);
+
+	// Every node is tested against the lanes that passed its parent, its triangles only against the lanes that pass it.
+	// A node only one lane passes is tested as raycast would, the others 8 lanes at a time with AVX2
+	const float3* hitTriangles[s_packetSize][3] = { { nullptr } };	// corners of every lane's nearest hit
+	int hitLanes = 0;
+	auto testTriangle = [&](int lane, const float3& p0, const float3& p1, const float3& p2)
+	{
+		float triDistance = nearest[lane];
+		float3 laneOrigin(origin[0][lane], origin[1][lane], origin[2][lane]);
+		float3 laneDirection(direction[0][lane], direction[1][lane], direction[2][lane]);
+		if (intersectRayTriangle(laneOrigin, laneDirection, p0, p1, p2, triDistance))
+		{
+			if (triDistance <= nearest[lane] && (!hitTriangles[lane][0] || triDistance < nearest[lane]))
+			{
+				nearest[lane] = triDistance;
+				hitTriangles[lane][0] = &p0, hitTriangles[lane][1] = &p1, hitTriangles[lane][2] = &p2;
+				hitLanes |= 1 << lane;
+			}
+		}
+	};
+#if defined(__AVX2__)
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.f);
+	const __m256 epsilon = _mm256_set1_ps(1e-20f);
+	const __m256 ox = _mm256_load_ps(origin[0]), oy = _mm256_load_ps(origin[1]), oz = _mm256_load_ps(origin[2]);
+	const __m256 dx = _mm256_load_ps(direction[0]), dy = _mm256_load_ps(direction[1]), dz = _mm256_load_ps(direction[2]);
+	const __m256 ix = _mm256_load_ps(inverseDirection[0]), iy = _mm256_load_ps(inverseDirection[1]), iz = _mm256_load_ps(inverseDirection[2]);
+	const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	auto toLaneMask = [&](int bits) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_and_si256(_mm256_set1_epi32(bits), laneBits), _mm256_setzero_si256())); };
+	visitTriangleNodes(nearDirection, lanes, [&](const float3& nodeMin, const float3& nodeMax, int mask)
+	{
+		__m256 t0x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(nodeMin.x), ox), ix), t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(nodeMax.x), ox), ix);
+		__m256 t0y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(nodeMin.y), oy), iy), t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(nodeMax.y), oy), iy);
+		__m256 t0z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(nodeMin.z), oz), iz), t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(nodeMax.z), oz), iz);
+		__m256 tNear = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t0x, t1x), _mm256_min_ps(t0y, t1y)), _mm256_max_ps(_mm256_min_ps(t0z, t1z), zero));
+		__m256 tFar = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t0x, t1x), _mm256_max_ps(t0y, t1y)), _mm256_min_ps(_mm256_max_ps(t0z, t1z), _mm256_load_ps(nearest)));
+		return _mm256_movemask_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ)) & mask;
+	},
+	[&](const auto& triangles, unsigned int count, int mask)
+	{
+		if (!(mask & (mask - 1)))
+		{
+			int lane = 0;
+			while (!(mask & (1 << lane)))
+				lane++;
+			tests += count;
+			for (unsigned int i = 0; i < count; i++)
+				testTriangle(lane, triangles.getPosition(i, 0), triangles.getPosition(i, 1), triangles.getPosition(i, 2));
+			return;
+		}
+		// Möller-Trumbore as intersectRayTriangle, on a triangle and eight rays
+		for (int lane = 0; lane < s_packetSize; lane++)
+			tests += (mask >> lane) & 1 ? count : 0;
+		__m256 laneMask = toLaneMask(mask);
+		__m256 hit = toLaneMask(hitLanes);
+		__m256 nearestLanes = _mm256_load_ps(nearest);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const float3& v0 = triangles.getPosition(i, 0);
+			const float3& v1 = triangles.getPosition(i, 1);
+			const float3& v2 = triangles.getPosition(i, 2);
+			float3 edge1 = v1 - v0;
+			float3 edge2 = v2 - v0;
+			__m256 e1x = _mm256_set1_ps(edge1.x), e1y = _mm256_set1_ps(edge1.y), e1z = _mm256_set1_ps(edge1.z);
+			__m256 e2x = _mm256_set1_ps(edge2.x), e2y = _mm256_set1_ps(edge2.y), e2z = _mm256_set1_ps(edge2.z);
+			// p = direction x edge2
+			__m256 px = _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+			__m256 py = _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+			__m256 pz = _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+			__m256 det = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e1x, px), _mm256_mul_ps(e1y, py)), _mm256_mul_ps(e1z, pz));
+			__m256 valid = _mm256_and_ps(laneMask, _mm256_or_ps(_mm256_cmp_ps(det, epsilon, _CMP_GE_OQ), _mm256_cmp_ps(det, _mm256_sub_ps(zero, epsilon), _CMP_LE_OQ)));
+			__m256 inverseDet = _mm256_div_ps(one, det);
+			// s = origin - v0
+			__m256 sx = _mm256_sub_ps(ox, _mm256_set1_ps(v0.x)), sy = _mm256_sub_ps(oy, _mm256_set1_ps(v0.y)), sz = _mm256_sub_ps(oz, _mm256_set1_ps(v0.z));
+			__m256 u = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, px), _mm256_mul_ps(sy, py)), _mm256_mul_ps(sz, pz)), inverseDet);
+			valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ)));
+			if (_mm256_movemask_ps(valid) == 0)
+				continue;
+			// q = s x edge1
+			__m256 qx = _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+			__m256 qy = _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+			__m256 qz = _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+			__m256 v = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)), _mm256_mul_ps(dz, qz)), inverseDet);
+			valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ)));
+			__m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)), _mm256_mul_ps(e2z, qz)), inverseDet);
+			// within the ray, and nearer than the lane's hit so far. The first of equally near triangles is kept, as raycast does
+			__m256 nearer = _mm256_blendv_ps(_mm256_cmp_ps(t, nearestLanes, _CMP_LE_OQ), _mm256_cmp_ps(t, nearestLanes, _CMP_LT_OQ), hit);
+			valid = _mm256_and_ps(valid, _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GE_OQ), nearer));
+			int hitMask = _mm256_movemask_ps(valid);
+			if (hitMask == 0)
+				continue;
+			nearestLanes = _mm256_blendv_ps(nearestLanes, t, valid);
+			hit = _mm256_or_ps(hit, valid);
+			hitLanes |= hitMask;
+			for (int lane = 0; lane < s_packetSize; lane++)
+			{
+				if (hitMask & (1 << lane))
+					hitTriangles[lane][0] = &v0, hitTriangles[lane][1] = &v1, hitTriangles[lane][2] = &v2;
+			}
+		}
+		_mm256_store_ps(nearest, nearestLanes);
+	});
+#else
+	visitTriangleNodes(nearDirection, lanes, [&](const float3& nodeMin, const float3& nodeMax, int mask)
+	{
+		int passed = 0;
+		for (int lane = 0; lane < s_packetSize; lane++)
+		{
+			float entry;
+			float3 laneOrigin(origin[0][lane], origin[1][lane], origin[2][lane]);
+			float3 laneInverse(inverseDirection[0][lane], inverseDirection[1][lane], inverseDirection[2][lane]);
+			if ((mask & (1 << lane)) && intersectRayBox(laneOrigin, laneInverse, nearest[lane], nodeMin, nodeMax, entry))
+				passed |= 1 << lane;
+		}
+		return passed;
+	},
+	[&](const auto& triangles, unsigned int count, int mask)
+	{
+		for (int lane = 0; lane < s_packetSize; lane++)
+		{
+			if (!(mask & (1 << lane)))
+				continue;
+			tests += count;
+			for (unsigned int i = 0; i < count; i++)
+				testTriangle(lane, triangles.getPosition(i, 0), triangles.getPosition(i, 1), triangles.getPosition(i, 2));
+		}
+	});
+#endif
+
+	// calculate results, as raycast
+	int hits = 0;
+	for (int lane = 0; lane < s_packetSize; lane++)
+	{
+		if (!(lanes & (1 << lane)) || !hitTriangles[lane][0])
+			continue;
+		float3 lPoint = float3(origin[0][lane], origin[1][lane], origin[2][lane]) + float3(direction[0][lane], direction[1][lane], direction[2][lane]) * nearest[lane];
+		packet.intersectionPositions[lane] = lPoint / toLocal + boxMin;
+		packet.intersectionNormals[lane] = calcFlatNormal(*hitTriangles[lane][0], *hitTriangles[lane][1], *hitTriangles[lane][2]);
+		packet.distances[lane] = (packet.intersectionPositions[lane] - packet.positions[lane]).Length();
+		hits |= 1 << lane;
+	}
+	return hits;
+}
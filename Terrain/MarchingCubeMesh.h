@@ -0,0 +1,238 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "BrickVolume.h"
+#include "DenseVolume.h"
+#include "TerrainBvh.h"
+#include "TerrainMemoryReport.h"
+#include "TerrainOctree.h"
+
+/*
+Mesh of one marching cube chunk, built from the terrain data on the cpu. Knows nothing of rendering or physics,
+MarchingCube puts the mesh on the gpu and builds the collider from it.
+Vertex positions are in the chunk's local space [0, 1], the chunk covers [start, start + size] of the terrain's data cells.
+*/
+class MarchingCubeMesh
+{
+public:
+	enum MeshMode {
+		Mesh_TriangleList,	// Every triangle gets three vertices of its own and a flat normal
+		Mesh_Indexed		// Vertices on a crossed voxel edge are shared between triangles and referenced by index
+	};
+	// What raycasts walk to find the triangles a ray may hit
+	enum RaycastTree {
+		Raycast_Octree,		// TerrainOctree of copies of the triangles
+		Raycast_Bvh			// TerrainBvh of indices into the mesh's vertices
+	};
+	struct VertexData {
+		float3 position;
+		float3 normal;
+	};
+	// The raycast tree of a mesh, see the end of the class
+	class RaycastMesh;
+protected:
+	/* Set of vertices that forms a triangle */
+	struct Triangle {
+		VertexData points[3];
+		/* returns the plane normal of the triangle */
+		float3 calcFlatNormal() const {
+			float3 normal = (points[1].position - points[0].position).Cross(points[2].position - points[0].position);
+			normal.Normalize();
+			return normal;
+		}
+	};
+
+private:
+	// Keeps track of the vertex created on each crossed edge in two layers of the chunk while marching in indexed mode
+	struct EdgeCache;
+	// Snapshot of the data cells a chunk reads while marching, with a one cell halo for the gradients. Holds the samples of the voxel format
+	struct VoxelSnapshot;
+	template<typename Voxel>
+	struct VoxelWindow;
+
+protected:
+	// Terrain data
+	static std::shared_ptr<VoxelVolume> s_terrainData;	// Basicly a 3D texture. This is a reference to the one in the handler
+	int m_sizeX;	// How many data cells this marching cube uses
+	int m_sizeY;
+	int m_sizeZ;
+
+	// Marching stuff
+	float m_surfaceValue;		// At what density value a surface will be rendered
+	float m_destroyValue;		// Set value to this after when destroyed
+
+	// Mesh
+	// Vertices of the latest mesh, never changed once built so BVH raycast meshes and back chunks share them. Kept for triangle lists
+	// so changed rows can be remeshed alone, see releaseUploadedData. Null before the first mesh and once released
+	std::shared_ptr<const std::vector<VertexData>> m_vertices;
+	std::vector<VertexData> m_buildVertices;		// the vertices marchCubes writes, buildMesh moves them to m_vertices
+	std::vector<unsigned int> m_indices;			// triangle indices into m_vertices while the mesh is built
+	bool m_indexed;									// if the latest generated mesh is indexed
+	std::vector<unsigned int> m_rowVertexStart;		// first vertex of every row of cells (y, z) and the vertex count last. Kept for triangle lists so changed rows can be remeshed alone
+	size_t m_vertexCount;							// of the latest mesh, also after its data has been released
+	size_t m_indexCount;
+
+	// Cells changed since the latest mesh, in cell coordinates of this chunk. Empty when min > max
+	int3 m_dirtyMin;
+	int3 m_dirtyMax;
+	bool m_dirtyAll;
+
+	// The raycast tree of the latest mesh, null without triangles. Replaced by every build, never changed
+	std::shared_ptr<const RaycastMesh> m_raycastMesh;
+
+	// Cells taken by snapshotTerrainData for the next build, kept allocated for the build after that
+	std::unique_ptr<VoxelSnapshot> m_snapshot;
+	bool m_snapshotTaken;
+
+	// Handling stuff
+	int3 m_startDataPos;
+	static int s_nrCubes;
+	static MeshMode s_meshMode;
+	static RaycastTree s_raycastTree;
+
+private:
+	/*
+	Copies the chunk's cells [-1, size + 1] in every axis to the window, positions outside the data are clamped to the closest edge cell.
+	The mesher only reads the window, so edits made while a worker marches the chunk never reach a half built mesh.
+	*/
+	template<typename Voxel>
+	void copyVoxelWindow(VoxelWindow<Voxel>& window) const;
+
+	// The marching functions are templates on the voxel traits of the data, see VoxelTraits.h, and the chunk extents, see ChunkExtents.h
+	// rows are the four data rows around the cube row, see MarchingCubeClassifier
+	template<typename Voxel, typename Extents>
+	void getCubeCorners(const Extents& extents, int x, int y, int z, const typename Voxel::Sample* const rows[4], float4 cubeCorners[8]) const;
+	template<typename Voxel, typename Extents>
+	void singleMarchCube(const Extents& extents, int x, int y, int z, int cubeIndex, const typename Voxel::Sample* const rows[4]);
+	// Writes the triangles of a cube (3 points and a face normal each) and returns how many. Triangles without area are left out
+	int getCubeTriangles(int cubeIndex, const float4 cubeCorners[8], float3 points[15], float3 normals[5]) const;
+	// Returns true if any corner of cube x in the rows is exactly the surface value, which is when triangles without area show up
+	template<typename Voxel>
+	bool hasCornerOnSurface(int x, const typename Voxel::Sample* const rows[4]) const;
+	template<typename Voxel, typename Extents>
+	void singleMarchCube_indexed(const Extents& extents, int x, int y, int z, int cubeIndex, const typename Voxel::Sample* const rows[4], const VoxelWindow<Voxel>& window, EdgeCache& cache);
+	// Marches every cell of the chunk into m_buildVertices (and m_indices if indexed).
+	// With a kept triangle list mesh only the rows of cells within the dirty region are marched, other rows are copied from the current mesh
+	// Picks the version of the mesher for the data's voxel format, and the fixed size one for chunks of 4, 8, 16 or 32 cells in every axis
+	void marchCubes();
+	template<typename Voxel, typename Extents>
+	void marchCubes(const Extents& extents);
+
+	// Returns the position of the surface point on a crossed edge, read from its vertex if it has been created.
+	// The edge cache only holds the layers around the cell's z, so the cell is given by x and y alone
+	template<typename Extents>
+	float3 getEdgePosition(const Extents& extents, int x, int y, int edgeIndex, const float4 cubeCorners[8], EdgeCache& cache);
+	// Returns the vertex index of a crossed edge, the vertex is created the first time the edge is visited.
+	template<typename Voxel, typename Extents>
+	unsigned int getEdgeVertex(const Extents& extents, int x, int y, int z, int edgeIndex, const float3& position, const float4 cubeCorners[8], const VoxelWindow<Voxel>& window, EdgeCache& cache);
+	// Density gradient based on central difference, points towards air
+	template<typename Voxel, typename Extents>
+	float3 getCornerGradient(const Extents& extents, const VoxelWindow<Voxel>& window, int x, int y, int z) const;
+
+	// Builds a new raycast mesh of the latest mesh with the tree of the mode
+	void buildRaycastTree();
+	void fillOctree(RaycastMesh& raycastMesh) const;
+	void buildBvh(RaycastMesh& raycastMesh) const;
+	bool isRowDirty(int y, int z) const;
+
+protected:
+	void clearDirty();
+
+public:
+	MarchingCubeMesh();
+	virtual ~MarchingCubeMesh();
+
+	// mesh generation
+	// Marches the chunk and rebuilds its triangle octree, the mesh data stays until releaseUploadedData
+	void buildMesh();
+	// Frees the mesh data that isn't needed once it is on the gpu, triangle lists are kept for the next partial remesh
+	void releaseUploadedData();
+	// Marks cells as changed, cellMin and cellMax are inclusive cell coordinates of this chunk
+	void markDirty(int3 cellMin, int3 cellMax);
+	// Marks the whole chunk as changed, the next run marches every cell
+	void markAllDirty();
+	bool isDirty() const;
+	// Double buffering. A back chunk takes over the placement and dirty region of a front chunk, builds the new mesh on a worker
+	// and is swapped with the front chunk on the main thread, which keeps the old mesh in the meantime
+	void takeRemeshState(MarchingCubeMesh& front);
+	void swapMesh(MarchingCubeMesh& other);
+	// Copies the cells the next build reads. Called on the main thread before a build is queued on a worker, so the worker
+	// never reads the terrain data the main thread edits. Builds without a snapshot copy the cells themselves
+	void snapshotTerrainData();
+	// Empties the mesh without marching, for chunks known to have no surface
+	void clearMesh();
+	// handle stuff
+	void setStartDataPos(int3 pos);
+	int3 getStartDataPos() const;
+	// Position of the chunk in the terrain's chunk grid
+	int3 getChunkId() const;
+	// The chunk's box in the terrain's local space [0, 1]
+	void getTerrainBounds(float3& boxMin, float3& boxMax) const;
+	static void setTerrainData(std::shared_ptr<VoxelVolume> data);
+	static void setNrCubes(int nr);
+	static void setMeshMode(MeshMode mode);
+	static MeshMode getMeshMode();
+	// Takes effect when a chunk is next built
+	static void setRaycastTree(RaycastTree tree);
+	static RaycastTree getRaycastTree();
+	void setDataSizes(int x, int y, int z);
+	void setDataSizes(int3 sizes);
+
+	std::vector<float3> getVertexPositions();
+	int getTriangleDataSize();	// vertices of the latest mesh
+	int getTriangleCount();
+	size_t getMeshDataSize();	// bytes of vertex and index data of the latest mesh, as stored on the gpu
+	size_t getOctreeMemorySize() const;	// of the raycast mesh, octree or BVH
+	// Null if the latest mesh has no triangles
+	std::shared_ptr<const RaycastMesh> getRaycastMesh() const;
+	// Adds what the chunk keeps in memory, the game's chunk adds its gpu buffers and collider
+	virtual void addMemoryUsage(TerrainMemoryReport::Chunk& chunk) const;
+
+	// Rays cast together by RaycastMesh::raycastPacket, in the terrain's local space like raycast
+	static const int s_packetSize = 8;
+	struct RayPacket {
+		float3 positions[s_packetSize];
+		float3 directions[s_packetSize];
+		float distances[s_packetSize];				// ray lengths, overwritten by the collision distance of the rays that hit
+		float3 intersectionPositions[s_packetSize];	// of the rays that hit
+		float3 intersectionNormals[s_packetSize];
+	};
+
+	/*
+	What raycasts read of a chunk: the raycast tree of a mesh and the vertices it refers to, placed in the terrain.
+	Built with the mesh and never changed after, the next mesh gets a new one. Query views share it with the chunk (see TerrainQueryView),
+	so a reader on another thread keeps casting against the mesh of its view while the chunk is remeshed or freed.
+	*/
+	class RaycastMesh
+	{
+	private:
+		friend MarchingCubeMesh;
+		float3 m_boxMin;		// the chunk's corner in the terrain's local space
+		float m_toLocal;		// scale from the terrain's local space to the chunk's, the chunks along an axis
+		size_t m_triangleCount = 0;
+		// One of the two trees is built, by the mode at the time, the other one is empty
+		TerrainOctree<Triangle> m_octree;
+		TerrainBvh m_bvh;
+		std::shared_ptr<const std::vector<VertexData>> m_vertices;	// the BVH's triangles index the mesh's vertices, which stay while it is cast against
+
+		// Calls the tree's visitNodes with visit(triangles, count, mask), triangles.getPosition(i, corner) gives a triangle's corners
+		template<typename Test, typename Visit>
+		void visitTriangleNodes(float3 direction, int mask, Test test, Visit visit) const;
+
+	public:
+		size_t getTriangleCount() const;
+		// Without the vertices, which are the mesh's, see addMemoryUsage
+		size_t getMemorySize() const;
+		/*
+		Returns true if ray collided with any triangles. The ray is in the terrain's local space [0, 1], like the results.
+		Parameter 'distance' defines the ray length and will also be overwritten by the rays collision distance.
+		Parameters 'intersectionPosition' and 'intersectionNormal' will be overwritten by the rays intersection point and normal of collision surface.
+		*/
+		bool raycast(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal, size_t& tests) const;
+		/*
+		raycast for the rays of the packet in 'lanes', bit i for ray i. The raycast tree is walked once for all of them and every triangle
+		is tested against all of them at once, 8 wide with AVX2. Returns the lanes that hit.
+		*/
+		int raycastPacket(RayPacket& packet, int lanes, size_t& tests) const;
+	};
+};
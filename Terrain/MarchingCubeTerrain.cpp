@@ -0,0 +1,1587 @@
+#include "pch.h"
+#include "MarchingCubeTerrain.h"
+#include "Profiler.h"
+#include "TerrainTrace.h"
+#include "L_System.h"
+#include "CaveCarver.h"
+#include <chrono>
+#include <thread>
+
+void MarchingCubeTerrain::initDataTexture(int sizeX, int sizeY, int sizeZ)
+{
+	// Round down to multiple of the amount of MarchingCubes. Don't want to handle exception cases at ends right now
+	m_sizeX = sizeX - (sizeX % m_nrCubes);
+	m_sizeY = sizeY - (sizeY % m_nrCubes);
+	m_sizeZ = sizeZ - (sizeZ % m_nrCubes);
+	m_totalSize = m_sizeX * m_sizeY * m_sizeZ;
+
+	createTerrainData();
+	invalidateTerrainData();
+
+	float longest = (float)max(max(m_sizeX, m_sizeY), m_sizeZ);
+	setTerrainScale(getTerrainScale() * float3(m_sizeX / longest, m_sizeY / longest, m_sizeZ / longest));
+}
+
+void MarchingCubeTerrain::createTerrainData()
+{
+	m_terrainData = createVoxelVolume(m_voxelFormat, m_voxelStorage);
+	visitVoxelVolume(*m_terrainData, [&](auto& volume) { volume.init(m_sizeX, m_sizeY, m_sizeZ); });
+	m_terrainData->setRetireFreedBricks(true);	// query views read it from other threads
+	MarchingCubeMesh::setTerrainData(m_terrainData);
+}
+
+void MarchingCubeTerrain::updateDensityRanges()
+{
+	if (m_totalSize == 0)
+		return;
+	// With brick storage, edited bricks that became solid or air are merged back. Their cells are reused once no reader of a view
+	// published before the merge can still read them, see reclaimReleasedViews. Remeshes read snapshots
+	reclaimReleasedViews();
+	size_t retiredBricks = m_terrainData->getRetiredBrickCount();
+	m_terrainData->compact();
+	if (m_terrainData->getRetiredBrickCount() > retiredBricks)
+	{
+		m_retiredBricksEpoch = m_queryEpoch;
+		reclaimReleasedViews();
+	}
+
+	int3 dataStride(m_sizeX / m_nrCubes, m_sizeY / m_nrCubes, m_sizeZ / m_nrCubes);
+	if (m_allDensityRangesDirty)
+	{
+		for (int i = 0; i < (int)m_brickRanges.size(); i++)
+			computeBrickRange(i);
+		for (int z = 0; z < m_nrCubes; z++)
+			for (int y = 0; y < m_nrCubes; y++)
+				for (int x = 0; x < m_nrCubes; x++)
+					computeCubeRange(int3(x, y, z));
+		updateRangePyramid(nullptr);
+	}
+	else if (m_dirtyBricks.size() > 0)
+	{
+		std::vector<bool> dirtyCubes(m_cubeRanges.size(), false);
+		for (size_t i = 0; i < m_dirtyBricks.size(); i++)
+		{
+			int brickIdx = m_dirtyBricks[i];
+			computeBrickRange(brickIdx);
+
+			// cubes reading any cell of the brick. A cube reads its own cells and the first layer of the next cube
+			int3 brick(brickIdx % m_brickCount.x, (brickIdx / m_brickCount.x) % m_brickCount.y, brickIdx / (m_brickCount.x * m_brickCount.y));
+			int3 cellMin = brick * s_brickSize;
+			int3 cellMax = cellMin + int3(s_brickSize - 1, s_brickSize - 1, s_brickSize - 1);
+			int3 cubeMin((cellMin.x - 1) / dataStride.x, (cellMin.y - 1) / dataStride.y, (cellMin.z - 1) / dataStride.z);
+			int3 cubeMax(cellMax.x / dataStride.x, cellMax.y / dataStride.y, cellMax.z / dataStride.z);
+			for (int z = max(cubeMin.z, 0); z <= min(cubeMax.z, m_nrCubes - 1); z++)
+				for (int y = max(cubeMin.y, 0); y <= min(cubeMax.y, m_nrCubes - 1); y++)
+					for (int x = max(cubeMin.x, 0); x <= min(cubeMax.x, m_nrCubes - 1); x++)
+						dirtyCubes[x + y * m_nrCubes + z * m_nrCubes * m_nrCubes] = true;
+		}
+		for (int i = 0; i < (int)dirtyCubes.size(); i++)
+		{
+			if (dirtyCubes[i])
+				computeCubeRange(getCubeId(i));
+		}
+		updateRangePyramid(&m_dirtyBricks);
+	}
+	m_allDensityRangesDirty = false;
+	m_dirtyBricks.clear();
+	std::fill(m_brickRangeDirty.begin(), m_brickRangeDirty.end(), (unsigned char)0);
+}
+
+void MarchingCubeTerrain::computeBrickRange(int brickIdx)
+{
+	int3 brick(brickIdx % m_brickCount.x, (brickIdx / m_brickCount.x) % m_brickCount.y, brickIdx / (m_brickCount.x * m_brickCount.y));
+	int3 cellMin = brick * s_brickSize;
+	int3 cellMax(min(cellMin.x + s_brickSize, m_sizeX), min(cellMin.y + s_brickSize, m_sizeY), min(cellMin.z + s_brickSize, m_sizeZ));
+
+	DensityRange& range = m_brickRanges[brickIdx];
+	visitVoxelVolume(*m_terrainData, [&](auto& volume)
+	{
+		typedef typename std::decay_t<decltype(volume)>::Voxel Voxel;
+		typedef typename Voxel::Type Type;
+
+		// Range bricks lie within one storage brick, a uniform storage brick gives the range without reading cells. Dense storage has none
+		Type value;
+		if (volume.getUniformValue(cellMin.x, cellMin.y, cellMin.z, value))
+		{
+			range.min = range.max = Voxel::toDensity(value);
+			return;
+		}
+
+		Type row[s_brickSize];
+		range.min = range.max = Voxel::toDensity(volume.get(cellMin.x, cellMin.y, cellMin.z));
+		for (int z = cellMin.z; z < cellMax.z; z++)
+		{
+			for (int y = cellMin.y; y < cellMax.y; y++)
+			{
+				volume.readRow(cellMin.x, y, z, cellMax.x - cellMin.x, row);
+				for (int x = 0; x < cellMax.x - cellMin.x; x++)
+				{
+					float density = Voxel::toDensity(row[x]);
+					range.min = min(range.min, density);
+					range.max = max(range.max, density);
+				}
+			}
+		}
+	});
+}
+
+void MarchingCubeTerrain::computeCubeRange(int3 cubeIdx)
+{
+	// Cells [start, start + stride] are read by the cube, reads outside the data are clamped to the edge
+	int3 dataStride(m_sizeX / m_nrCubes, m_sizeY / m_nrCubes, m_sizeZ / m_nrCubes);
+	int3 cellMin = cubeIdx * dataStride;
+	int3 cellMax(min(cellMin.x + dataStride.x, m_sizeX - 1), min(cellMin.y + dataStride.y, m_sizeY - 1), min(cellMin.z + dataStride.z, m_sizeZ - 1));
+	int3 brickMin = cellMin / s_brickSize;
+	int3 brickMax = cellMax / s_brickSize;
+
+	// Bricks can reach outside the cube, the range may be wider than needed but never misses a surface
+	DensityRange range = m_brickRanges[brickMin.x + brickMin.y * m_brickCount.x + brickMin.z * m_brickCount.x * m_brickCount.y];
+	for (int z = brickMin.z; z <= brickMax.z; z++)
+	{
+		for (int y = brickMin.y; y <= brickMax.y; y++)
+		{
+			for (int x = brickMin.x; x <= brickMax.x; x++)
+			{
+				const DensityRange& brick = m_brickRanges[x + y * m_brickCount.x + z * m_brickCount.x * m_brickCount.y];
+				range.min = min(range.min, brick.min);
+				range.max = max(range.max, brick.max);
+			}
+		}
+	}
+	m_cubeRanges[getCubeIndex(cubeIdx)] = range;
+}
+
+void MarchingCubeTerrain::invalidateTerrainData()
+{
+	m_brickCount = int3((m_sizeX + s_brickSize - 1) / s_brickSize, (m_sizeY + s_brickSize - 1) / s_brickSize, (m_sizeZ + s_brickSize - 1) / s_brickSize);
+	size_t brickTotal = (size_t)m_brickCount.x * m_brickCount.y * m_brickCount.z;
+	m_brickRanges.resize(brickTotal);
+	m_brickRangeDirty.assign(brickTotal, 0);
+	m_dirtyBricks.clear();
+	m_cubeRanges.resize((size_t)m_nrCubes * m_nrCubes * m_nrCubes);
+	m_allDensityRangesDirty = true;
+
+	m_pyramidLevelStart.clear();
+	m_pyramidLevelSize.clear();
+	int3 levelSize = m_brickCount;
+	int nodes = 0;
+	while (true)
+	{
+		m_pyramidLevelStart.push_back(nodes);
+		m_pyramidLevelSize.push_back(levelSize);
+		nodes += levelSize.x * levelSize.y * levelSize.z;
+		if (levelSize.x <= 1 && levelSize.y <= 1 && levelSize.z <= 1)
+			break;
+		levelSize = int3((levelSize.x + 1) / 2, (levelSize.y + 1) / 2, (levelSize.z + 1) / 2);
+	}
+	m_rangePyramid.resize(nodes);
+	m_pyramidCrossing.assign(nodes, 0);
+	m_brickCellMasks.assign(brickTotal, 0);
+
+	for (size_t i = 0; i < m_cubes.size(); i++)
+	{
+		if (m_cubes[i])
+			m_cubes[i]->markAllDirty();
+	}
+}
+
+void MarchingCubeTerrain::markTerrainPixelDirty(int x, int y, int z)
+{
+	// A data cell is a corner of the cells before and after it. The first data cell of a chunk is also read by the previous chunk
+	int3 dataStride(m_sizeX / m_nrCubes, m_sizeY / m_nrCubes, m_sizeZ / m_nrCubes);
+	int3 pixel(x, y, z);
+	int3 cube = pixel / dataStride;
+	int3 rest = pixel - cube * dataStride;
+	for (int i = 0; i < 8; i++)
+	{
+		int3 offset((i & 1) ? -1 : 0, (i & 2) ? -1 : 0, (i & 4) ? -1 : 0);
+		if ((offset.x != 0 && rest.x != 0) || (offset.y != 0 && rest.y != 0) || (offset.z != 0 && rest.z != 0))
+			continue;
+		int3 cubeIdx = cube + offset;
+		if (cubeIdx.x < 0 || cubeIdx.x >= m_nrCubes || cubeIdx.y < 0 || cubeIdx.y >= m_nrCubes || cubeIdx.z < 0 || cubeIdx.z >= m_nrCubes)
+			continue;
+		int3 local = pixel - cubeIdx * dataStride;
+		int3 cellMin(max(local.x - 1, 0), max(local.y - 1, 0), max(local.z - 1, 0));
+		int3 cellMax(min(local.x, dataStride.x - 1), min(local.y, dataStride.y - 1), min(local.z, dataStride.z - 1));
+		MarchingCubeMesh* cube = getCube(cubeIdx);
+		if (cube) // chunks without a surface are remeshed fully once they get one
+			cube->markDirty(cellMin, cellMax);
+	}
+}
+
+bool MarchingCubeTerrain::isCubeCrossingSurface(int3 cubeIdx) const
+{
+	const DensityRange& range = m_cubeRanges[getCubeIndex(cubeIdx)];
+	return range.min < m_surfaceValue && range.max >= m_surfaceValue;
+}
+
+void MarchingCubeTerrain::updateRangePyramid(const std::vector<int>* bricks)
+{
+	if (m_pyramidLevelSize.empty())
+		return;
+	// nodes to recompute on the current level, every node when null
+	std::vector<int> nodes;
+	if (bricks)
+	{
+		// a brick is read by the level 0 nodes of itself and of the bricks before it
+		for (int brickIdx : *bricks)
+		{
+			int3 brick(brickIdx % m_brickCount.x, (brickIdx / m_brickCount.x) % m_brickCount.y, brickIdx / (m_brickCount.x * m_brickCount.y));
+			for (int i = 0; i < 8; i++)
+			{
+				int3 node(brick.x - (i & 1), brick.y - ((i >> 1) & 1), brick.z - (i >> 2));
+				if (node.x >= 0 && node.y >= 0 && node.z >= 0)
+					nodes.push_back(node.x + node.y * m_brickCount.x + node.z * m_brickCount.x * m_brickCount.y);
+			}
+		}
+	}
+
+	for (int level = 0; level < (int)m_pyramidLevelSize.size(); level++)
+	{
+		int3 size = m_pyramidLevelSize[level];
+		int count = size.x * size.y * size.z;
+		if (bricks)
+		{
+			std::sort(nodes.begin(), nodes.end());
+			nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+		}
+		// level 0 reads the bricks, the levels above read up to 2x2x2 nodes of the level below
+		const DensityRange* below = level == 0 ? m_brickRanges.data() : &m_rangePyramid[m_pyramidLevelStart[level - 1]];
+		int3 belowSize = level == 0 ? m_brickCount : m_pyramidLevelSize[level - 1];
+		int3 scale = level == 0 ? int3(1, 1, 1) : int3(2, 2, 2);
+		for (int i = 0; i < (bricks ? (int)nodes.size() : count); i++)
+		{
+			int nodeIdx = bricks ? nodes[i] : i;
+			int3 node(nodeIdx % size.x, (nodeIdx / size.x) % size.y, nodeIdx / (size.x * size.y));
+			int3 first = node * scale;
+			int3 last(min(first.x + 1, belowSize.x - 1), min(first.y + 1, belowSize.y - 1), min(first.z + 1, belowSize.z - 1));
+			DensityRange range = below[first.x + first.y * belowSize.x + first.z * belowSize.x * belowSize.y];
+			for (int z = first.z; z <= last.z; z++)
+			{
+				for (int y = first.y; y <= last.y; y++)
+				{
+					for (int x = first.x; x <= last.x; x++)
+					{
+						const DensityRange& child = below[x + y * belowSize.x + z * belowSize.x * belowSize.y];
+						range.min = min(range.min, child.min);
+						range.max = max(range.max, child.max);
+					}
+				}
+			}
+			bool crossing = range.min < m_surfaceValue && range.max >= m_surfaceValue;
+			m_rangePyramid[m_pyramidLevelStart[level] + nodeIdx] = range;
+			m_pyramidCrossing[m_pyramidLevelStart[level] + nodeIdx] = crossing;
+			// a level 0 node covers the corners of the brick's cells, no cell crosses when the node doesn't
+			if (level == 0)
+				m_brickCellMasks[nodeIdx] = crossing ? computeBrickCellMask(node) : 0;
+		}
+		if (bricks && level + 1 < (int)m_pyramidLevelSize.size())
+		{
+			// parents of the recomputed nodes
+			int3 parentSize = m_pyramidLevelSize[level + 1];
+			for (int& nodeIdx : nodes)
+			{
+				int3 parent = int3(nodeIdx % size.x, (nodeIdx / size.x) % size.y, nodeIdx / (size.x * size.y)) / 2;
+				nodeIdx = parent.x + parent.y * parentSize.x + parent.z * parentSize.x * parentSize.y;
+			}
+		}
+	}
+}
+
+void MarchingCubeTerrain::growRangePyramid(int brickIdx, const DensityRange& range)
+{
+	int3 brick(brickIdx % m_brickCount.x, (brickIdx / m_brickCount.x) % m_brickCount.y, brickIdx / (m_brickCount.x * m_brickCount.y));
+	for (int i = 0; i < 8; i++)
+	{
+		int3 node(brick.x - (i & 1), brick.y - ((i >> 1) & 1), brick.z - (i >> 2));
+		if (node.x < 0 || node.y < 0 || node.z < 0)
+			continue;
+		for (int level = 0; level < (int)m_pyramidLevelSize.size(); level++, node = node / 2)
+		{
+			int3 size = m_pyramidLevelSize[level];
+			int nodeIdx = m_pyramidLevelStart[level] + node.x + node.y * size.x + node.z * size.x * size.y;
+			DensityRange& nodeRange = m_rangePyramid[nodeIdx];
+			if (nodeRange.min <= range.min && nodeRange.max >= range.max)
+				break; // the levels above contain this one
+			nodeRange.min = min(nodeRange.min, range.min);
+			nodeRange.max = max(nodeRange.max, range.max);
+			m_pyramidCrossing[nodeIdx] = nodeRange.min < m_surfaceValue && nodeRange.max >= m_surfaceValue;
+		}
+	}
+}
+
+unsigned long long MarchingCubeTerrain::computeBrickCellMask(int3 brick) const
+{
+	static_assert(s_brickSize * s_brickSize * s_brickSize <= 64, "a brick's cells must fit its mask");
+	const int corners = s_brickSize + 1;
+	int3 cellMin = brick * s_brickSize;
+	// the cells of the terrain are within [0, size - 2], the corners past them are outside
+	int3 cellCount(min(s_brickSize, m_sizeX - 1 - cellMin.x), min(s_brickSize, m_sizeY - 1 - cellMin.y), min(s_brickSize, m_sizeZ - 1 - cellMin.z));
+	bool below[corners * corners * corners];
+	visitVoxelVolume(*m_terrainData, [&](const auto& volume)
+	{
+		typedef typename std::decay_t<decltype(volume)>::Voxel Voxel;
+		typedef typename Voxel::Type Type;
+		Type values[corners * corners * corners];
+		volume.readBlock(cellMin.x, cellMin.y, cellMin.z, corners, corners, corners, values, Type(0));
+		for (int i = 0; i < corners * corners * corners; i++)
+			below[i] = Voxel::toDensity(values[i]) < m_surfaceValue;
+	});
+
+	unsigned long long mask = 0;
+	for (int z = 0; z < cellCount.z; z++)
+	{
+		for (int y = 0; y < cellCount.y; y++)
+		{
+			for (int x = 0; x < cellCount.x; x++)
+			{
+				const bool* corner = below + x + y * corners + z * corners * corners;
+				int count = corner[0] + corner[1] + corner[corners] + corner[corners + 1] +
+					corner[corners * corners] + corner[corners * corners + 1] + corner[corners * corners + corners] + corner[corners * corners + corners + 1];
+				if (count > 0 && count < 8)
+					mask |= 1ull << (x + y * s_brickSize + z * s_brickSize * s_brickSize);
+			}
+		}
+	}
+	return mask;
+}
+
+void MarchingCubeTerrain::setTerrainPixel(int x, int y, int z, float density)
+{
+	visitVoxelVolume(*m_terrainData, [&](auto& volume)
+	{
+		typedef typename std::decay_t<decltype(volume)>::Voxel Voxel;
+		setTerrainPixel(volume, x, y, z, Voxel::fromDensity(density));
+	});
+}
+
+template<typename Volume>
+void MarchingCubeTerrain::setTerrainPixel(Volume& volume, int x, int y, int z, typename Volume::Type value)
+{
+	typedef typename Volume::Voxel Voxel;
+	if (x < 0 || x >= m_sizeX || y < 0 || y >= m_sizeY || z < 0 || z >= m_sizeZ)
+		return;
+	if (!volume.set(x, y, z, value))
+		return;
+
+	// Grow the brick's range right away so it always contains the data, the exact range is recomputed later
+	int brickIdx = (x / s_brickSize) + (y / s_brickSize) * m_brickCount.x + (z / s_brickSize) * m_brickCount.x * m_brickCount.y;
+	DensityRange& range = m_brickRanges[brickIdx];
+	float density = Voxel::toDensity(value);
+	if (density < range.min || density > range.max)
+	{
+		range.min = min(range.min, density);
+		range.max = max(range.max, density);
+		if (!m_allDensityRangesDirty)
+			growRangePyramid(brickIdx, range);
+	}
+	if (!m_allDensityRangesDirty)
+	{
+		// the cells with the data cell as a corner may cross the surface now
+		for (int i = 0; i < 8; i++)
+		{
+			int3 cell(x - (i & 1), y - ((i >> 1) & 1), z - (i >> 2));
+			if (cell.x < 0 || cell.y < 0 || cell.z < 0 || cell.x > m_sizeX - 2 || cell.y > m_sizeY - 2 || cell.z > m_sizeZ - 2)
+				continue;
+			int3 brick = cell / s_brickSize;
+			int3 local = cell - brick * s_brickSize;
+			m_brickCellMasks[brick.x + brick.y * m_brickCount.x + brick.z * m_brickCount.x * m_brickCount.y] |=
+				1ull << (local.x + local.y * s_brickSize + local.z * s_brickSize * s_brickSize);
+		}
+	}
+	if (!m_brickRangeDirty[brickIdx])
+	{
+		m_brickRangeDirty[brickIdx] = 1;
+		m_dirtyBricks.push_back(brickIdx);
+	}
+	markTerrainPixelDirty(x, y, z);
+}
+
+float MarchingCubeTerrain::getTerrainPixel(int x, int y, int z) const
+{
+	if (0 <= x && x < m_sizeX && 0 <= y && y < m_sizeY && 0 <= z && z < m_sizeZ)
+		return m_terrainData->getDensity(x, y, z);
+	else
+		return 100;
+}
+
+float MarchingCubeTerrain::getTerrainPixel(float3 pos) const
+{
+	return TerrainQueryView::sampleDensity(*m_terrainData, pos);
+}
+
+bool MarchingCubeTerrain::queueMarchingCube(int3 cubeIdx)
+{
+	if (cubeIdx.x >= 0 && cubeIdx.x < m_nrCubes &&
+		cubeIdx.y >= 0 && cubeIdx.y < m_nrCubes &&
+		cubeIdx.z >= 0 && cubeIdx.z < m_nrCubes) {
+		const int linearIdx = getCubeIndex(cubeIdx);
+		if (linearIdx < 0 || linearIdx >= (int)m_marchingCubeQueueLookup.size())
+			return false; // idx outside valid value
+		if (!m_marchingCubeQueueLookup[linearIdx]) {
+			m_marchingCubeQueueLookup[linearIdx] = true;
+			m_marchingCubeQueue.push_back(cubeIdx);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool MarchingCubeTerrain::queueMarchingCube_pixelIndex(int3 pixelIdx)
+{
+	const int3 dataStride(m_sizeX / m_nrCubes, m_sizeY / m_nrCubes, m_sizeZ / m_nrCubes);
+	int3 cubeIdx = pixelIdx / dataStride;
+	int3 restIdx = int3(pixelIdx.x % dataStride.x, pixelIdx.y % dataStride.y, pixelIdx.z % dataStride.z);
+	// add to queue
+	bool addedAnyCubeToQueue = queueMarchingCube(cubeIdx);
+	// check if adjacent
+	if (restIdx.x == 0)
+		addedAnyCubeToQueue |= queueMarchingCube(cubeIdx + int3(-1, 0, 0));
+	if (restIdx.y == 0)
+		addedAnyCubeToQueue |= queueMarchingCube(cubeIdx + int3(0, -1, 0));
+	if (restIdx.z == 0)
+		addedAnyCubeToQueue |= queueMarchingCube(cubeIdx + int3(0, 0, -1));
+	if (restIdx.x == m_sizeX - 1)
+		addedAnyCubeToQueue |= queueMarchingCube(cubeIdx + int3(1, 0, 0));
+	if (restIdx.y == m_sizeY - 1)
+		addedAnyCubeToQueue |= queueMarchingCube(cubeIdx + int3(0, 1, 0));
+	if (restIdx.z == m_sizeZ - 1)
+		addedAnyCubeToQueue |= queueMarchingCube(cubeIdx + int3(0, 0, 1));
+
+	return addedAnyCubeToQueue;
+}
+
+MarchingCubeTerrain::MarchingCubeTerrain()
+{
+	m_sizeX = 0;
+	m_sizeY = 0;
+	m_sizeZ = 0;
+	m_totalSize = 0;
+	m_brickCount = int3(0, 0, 0);
+	m_nrCubes = s_defaultNrCubes;
+	m_terrainScale = float3(1.f);
+
+	m_surfaceValue = 126.f;
+	m_destroyValue = 255.f;
+}
+
+MarchingCubeTerrain::~MarchingCubeTerrain()
+{
+}
+
+void MarchingCubeTerrain::init(int sizeX, int sizeY, int sizeZ, float scale, int nrCubes, VoxelFormat format, VoxelStorage storage)
+{
+	finishAsyncRemeshes();
+	m_voxelFormat = format;
+	m_voxelStorage = storage;
+	m_nrCubes = Clamp(nrCubes, 1, max(min(min(sizeX, sizeY), sizeZ), 1));
+	setTerrainScale(float3(1.f) * scale);
+	initDataTexture(sizeX, sizeY, sizeZ);
+
+	initCubes();
+	initOctree();
+}
+
+VoxelFormat MarchingCubeTerrain::getVoxelFormat() const
+{
+	return m_voxelFormat;
+}
+
+VoxelStorage MarchingCubeTerrain::getVoxelStorage() const
+{
+	return m_voxelStorage;
+}
+
+int3 MarchingCubeTerrain::getDataSize() const
+{
+	return int3(m_sizeX, m_sizeY, m_sizeZ);
+}
+
+float3 MarchingCubeTerrain::getTerrainScale() const
+{
+	return m_terrainScale;
+}
+
+void MarchingCubeTerrain::setTerrainScale(float3 scale)
+{
+	m_terrainScale = scale;
+}
+
+float MarchingCubeTerrain::getVoxelLength() const
+{
+	return getTerrainScale().x / m_sizeX;
+}
+
+float3 MarchingCubeTerrain::translateTerrainToDataSpace(float3 terrainPos) const
+{
+	// terrainSpace [0, scale] to dataSpace [0, m_sizeX/Y/Z]
+	float3 dataSizes((float)m_sizeX, (float)m_sizeY, (float)m_sizeZ);
+	return terrainPos / getTerrainScale() * dataSizes;
+}
+
+float3 MarchingCubeTerrain::getDataFieldFlow(int3 pixelIdx, float localGridStepSize)
+{
+	// based on central difference ( df(x) = f(x+h)-f(x-h) )
+	// flow points to more air
+	float h = localGridStepSize;
+	float3 cellId = float3((float)pixelIdx.x, (float)pixelIdx.y, (float)pixelIdx.z);
+	float3 flow;
+	flow.x = (float)((int)getTerrainPixel(cellId + float3(h, 0, 0)) - (int)getTerrainPixel(cellId - float3(h, 0, 0))) / 255;
+	flow.y = (float)((int)getTerrainPixel(cellId + float3(0, h, 0)) - (int)getTerrainPixel(cellId - float3(0, h, 0))) / 255;
+	flow.z = (float)((int)getTerrainPixel(cellId + float3(0, 0, h)) - (int)getTerrainPixel(cellId - float3(0, 0, h))) / 255;
+	return flow;
+}
+
+void MarchingCubeTerrain::initOctree()
+{
+	publishQueryView();
+}
+
+void MarchingCubeTerrain::publishQueryView()
+{
+	std::shared_ptr<TerrainQueryView> view = std::make_shared<TerrainQueryView>();
+	view->m_epoch = ++m_queryEpoch;
+	view->m_nrCubes = m_nrCubes;
+	view->m_chunks.resize(m_cubes.size());
+	for (size_t i = 0; i < m_cubes.size(); i++)
+	{
+		if (m_cubes[i])
+			view->m_chunks[i] = m_cubes[i]->getRaycastMesh();
+	}
+	view->m_terrainData = m_terrainData;
+	view->m_dataSize = int3(m_sizeX, m_sizeY, m_sizeZ);
+	view->m_surfaceValue = m_surfaceValue;
+	view->m_raycastStats = m_raycastStats;
+
+	std::shared_ptr<const TerrainQueryView> previous = std::atomic_exchange(&m_queryView, std::shared_ptr<const TerrainQueryView>(std::move(view)));
+	if (previous)
+		m_heldViews.push_back(std::move(previous));
+	reclaimReleasedViews();
+}
+
+void MarchingCubeTerrain::reclaimReleasedViews()
+{
+	// A replaced view can't be acquired anymore, so once the terrain holds the last reference no reader is left.
+	// The fence orders the readers' reads through it, which end by dropping their references, before the cells are reused
+	m_heldViews.erase(std::remove_if(m_heldViews.begin(), m_heldViews.end(),
+		[](const std::shared_ptr<const TerrainQueryView>& view) { return view.use_count() == 1; }), m_heldViews.end());
+	if (!m_terrainData || m_terrainData->getRetiredBrickCount() == 0)
+		return;
+	// the view current when the bricks were compacted and every one before it must be gone, none were without a view
+	if (m_retiredBricksEpoch > 0 && (m_queryEpoch <= m_retiredBricksEpoch || (!m_heldViews.empty() && m_heldViews.front()->getEpoch() <= m_retiredBricksEpoch)))
+		return;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	m_terrainData->releaseRetiredBricks();
+}
+
+std::shared_ptr<const TerrainQueryView> MarchingCubeTerrain::acquireQueryView() const
+{
+	return std::atomic_load(&m_queryView);
+}
+
+bool MarchingCubeTerrain::longRaycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal)
+{
+	if (!m_queryView)
+		return false;
+	return m_queryView->raycast_localSpace(rayPosition, rayDirection, distance, intersectionPosition, intersectionNormal);
+}
+
+bool MarchingCubeTerrain::shortRaycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal)
+{
+	if (!m_queryView)
+		return false;
+	return m_queryView->raycast_localSpace(rayPosition, rayDirection, distance, intersectionPosition, intersectionNormal);
+}
+
+void MarchingCubeTerrain::raycastBatch_localSpace(size_t count, const float3* rayPositions, const float3* rayDirections, const float* distances, RayHit* hits)
+{
+	if (count == 0 || !m_queryView)
+		return;
+	TerrainRaycastStats::Batch batch(*m_raycastStats);
+	batch.rays = count;
+	const TerrainQueryView& view = *m_queryView;
+	std::vector<unsigned int> order;
+	view.sortRays(count, rayPositions, rayDirections, order);
+
+	size_t jobCount = (count + s_raycastJobSize - 1) / s_raycastJobSize;
+	std::vector<TerrainQueryView::RaycastCounters> jobCounters(jobCount);
+	runRaycastJobs(jobCount, [&](size_t job)
+	{
+		size_t first = job * s_raycastJobSize;
+		view.raycastPackets(&order[first], min(count - first, (size_t)s_raycastJobSize), rayPositions, rayDirections, distances, hits, jobCounters[job]);
+	});
+	for (const TerrainQueryView::RaycastCounters& counters : jobCounters)
+	{
+		batch.hits += counters.hits;
+		batch.cubesCulled += counters.cubesCulled;
+		batch.cubesTested += counters.cubesTested;
+		batch.trianglesTested += counters.trianglesTested;
+	}
+}
+
+void MarchingCubeTerrain::runRaycastJobs(size_t jobCount, const std::function<void(size_t job)>& job)
+{
+	for (size_t i = 0; i < jobCount; i++)
+		job(i);
+}
+
+bool MarchingCubeTerrain::raycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal)
+{
+	return longRaycast_localSpace(rayPosition, rayDirection, distance, intersectionPosition, intersectionNormal);
+}
+
+// Density of a data cell at 'local' [0, 1] in every axis, corners in the order of readBlock
+static float trilinear(const float corners[8], const float3& local)
+{
+	float bottom0 = Lerp(corners[0], corners[1], local.x);
+	float bottom1 = Lerp(corners[4], corners[5], local.x);
+	float top0 = Lerp(corners[2], corners[3], local.x);
+	float top1 = Lerp(corners[6], corners[7], local.x);
+	return Lerp(Lerp(bottom0, bottom1, local.z), Lerp(top0, top1, local.z), local.y);
+}
+
+template<typename Volume>
+bool MarchingCubeTerrain::densityRaycast(const Volume& volume, float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal) const
+{
+	typedef typename Volume::Voxel Voxel;
+	// March in data space, along a direction of unit length in data cells
+	float3 dataSize((float)m_sizeX, (float)m_sizeY, (float)m_sizeZ);
+	float3 origin = rayPosition * dataSize;
+	float3 direction = rayDirection * dataSize;
+	float dataPerLocal = direction.Length();
+	direction /= dataPerLocal;
+	float3 inverseDirection = inverseRayDirection(direction);
+
+	// Data cells have their corners at [x, x + 1], the cells of the terrain are within [0, size - 1]
+	float3 boxMax = dataSize - float3(1, 1, 1);
+	int3 cellMax(m_sizeX - 2, m_sizeY - 2, m_sizeZ - 2);
+	float t;
+	if (!intersectRayBox(origin, inverseDirection, distance * dataPerLocal, float3(0, 0, 0), boxMax, t))
+		return false;
+	float tEnd = min(distance * dataPerLocal, rayBoxExit(origin, inverseDirection, float3(0, 0, 0), boxMax));
+
+	const float step = 1e-3f;	// past the border of a skipped block, in data cells
+	const int samples = 4;		// per cell, where the density crosses the surface value is searched between them
+	int3 cellStep(direction.x < 0 ? -1 : 1, direction.y < 0 ? -1 : 1, direction.z < 0 ? -1 : 1);
+	float3 cellDelta(fabsf(inverseDirection.x), fabsf(inverseDirection.y), fabsf(inverseDirection.z));
+	// in locals, the cell reads are atomics and the compiler would load the members again after every one
+	float surfaceValue = m_surfaceValue;
+	const unsigned char* crossing = m_pyramidCrossing.data();
+	const unsigned long long* cellMasks = m_brickCellMasks.data();
+	const int* levelStart = m_pyramidLevelStart.data();
+	const int3* levelSize = m_pyramidLevelSize.data();
+	int topLevel = (int)m_pyramidLevelSize.size() - 1;
+	int level = topLevel;
+	auto isNodeCrossing = [&](int nodeLevel, int3 node)
+	{
+		int3 size = levelSize[nodeLevel];
+		return crossing[levelStart[nodeLevel] + node.x + node.y * size.x + node.z * size.x * size.y] != 0;
+	};
+	while (t <= tEnd)
+	{
+		float3 position = origin + direction * t;
+		int3 cell(Clamp((int)floorf(position.x), 0, cellMax.x), Clamp((int)floorf(position.y), 0, cellMax.y), Clamp((int)floorf(position.z), 0, cellMax.z));
+		int3 brick = cell / s_brickSize;
+
+		// Find the largest block the surface can't be in. A node's range contains its children's, so the levels that can't hold
+		// the surface are all below the ones that can. Neighbouring blocks are mostly of a size, the search starts at the last one's level
+		level = min(level + 1, topLevel);
+		if (isNodeCrossing(level, int3(brick.x >> level, brick.y >> level, brick.z >> level)))
+		{
+			while (--level >= 0 && isNodeCrossing(level, int3(brick.x >> level, brick.y >> level, brick.z >> level)))
+				;
+		}
+		else
+		{
+			while (level < topLevel && !isNodeCrossing(level + 1, int3(brick.x >> (level + 1), brick.y >> (level + 1), brick.z >> (level + 1))))
+				level++;
+		}
+		// the surface may cross the brick's range without crossing any of its cells
+		unsigned long long cellMask = level < 0 ? cellMasks[brick.x + brick.y * m_brickCount.x + brick.z * m_brickCount.x * m_brickCount.y] : 0;
+		if (cellMask == 0)
+		{
+			// Skip node after node of the level until one may hold the surface, climbing whenever the parent can't either.
+			// Only that node is searched from the position again
+			level = max(level, 0);
+			int3 node(brick.x >> level, brick.y >> level, brick.z >> level);
+			float nodeCells = (float)(s_brickSize << level);
+			float3 nodeExit(((node.x + (cellStep.x > 0)) * nodeCells - origin.x) * inverseDirection.x,
+				((node.y + (cellStep.y > 0)) * nodeCells - origin.y) * inverseDirection.y, ((node.z + (cellStep.z > 0)) * nodeCells - origin.z) * inverseDirection.z);
+			while (true)
+			{
+				int3 parent(node.x >> 1, node.y >> 1, node.z >> 1);
+				// a grazing ray may still round into the node it left, the next exit is never behind it
+				if (nodeExit.x <= nodeExit.y && nodeExit.x <= nodeExit.z)
+				{
+					t = max(t, nodeExit.x);
+					node.x += cellStep.x;
+					nodeExit.x += cellDelta.x * nodeCells;
+				}
+				else if (nodeExit.y <= nodeExit.z)
+				{
+					t = max(t, nodeExit.y);
+					node.y += cellStep.y;
+					nodeExit.y += cellDelta.y * nodeCells;
+				}
+				else
+				{
+					t = max(t, nodeExit.z);
+					node.z += cellStep.z;
+					nodeExit.z += cellDelta.z * nodeCells;
+				}
+				// past the end, or rounded out of the nodes where the ray leaves the data
+				int3 size = levelSize[level];
+				if (t > tEnd || node.x < 0 || node.y < 0 || node.z < 0 || node.x >= size.x || node.y >= size.y || node.z >= size.z)
+					return false;
+				if (isNodeCrossing(level, node))
+					break;
+				// the parent of the last node can hold the surface, else it would have been climbed to
+				int3 nextParent(node.x >> 1, node.y >> 1, node.z >> 1);
+				if (level < topLevel && nextParent != parent && !isNodeCrossing(level + 1, nextParent))
+				{
+					level++;
+					node = nextParent;
+					nodeCells *= 2;
+					nodeExit = float3(((node.x + (cellStep.x > 0)) * nodeCells - origin.x) * inverseDirection.x,
+						((node.y + (cellStep.y > 0)) * nodeCells - origin.y) * inverseDirection.y, ((node.z + (cellStep.z > 0)) * nodeCells - origin.z) * inverseDirection.z);
+				}
+			}
+			// the search goes down from the node
+			level--;
+			t += step;
+			continue;
+		}
+
+		// step through the brick's cells, only the ones of the mask are read
+		int3 blockMin = brick * s_brickSize;
+		float3 blockLow((float)blockMin.x, (float)blockMin.y, (float)blockMin.z);
+		float3 blockHigh(min(blockLow.x + s_brickSize, boxMax.x), min(blockLow.y + s_brickSize, boxMax.y), min(blockLow.z + s_brickSize, boxMax.z));
+		float blockExit = min(rayBoxExit(origin, inverseDirection, blockLow, blockHigh), tEnd);
+		float3 next(cellStep.x > 0 ? cell.x + 1.f : (float)cell.x, cellStep.y > 0 ? cell.y + 1.f : (float)cell.y, cellStep.z > 0 ? cell.z + 1.f : (float)cell.z);
+		float3 cellExit = (next - origin) * inverseDirection;
+		while (t <= blockExit)
+		{
+			float cellEnd = min(min(min(cellExit.x, cellExit.y), cellExit.z), blockExit);
+			int3 local = cell - blockMin;
+			if ((cellMask >> (local.x + local.y * s_brickSize + local.z * s_brickSize * s_brickSize)) & 1)
+			{
+				// the cell's corners are all inside the data, relative to the surface value, below 0 is ground
+				typename Voxel::Type cells[8];
+				volume.readCube(cell.x, cell.y, cell.z, cells);
+				float corners[8];
+				for (int i = 0; i < 8; i++)
+					corners[i] = Voxel::toDensity(cells[i]) - surfaceValue;
+				// the first sign change between samples, then linear interpolation across the surface value
+				float3 cellOrigin((float)cell.x, (float)cell.y, (float)cell.z);
+				float t0 = t;
+				float d0 = trilinear(corners, origin + direction * t0 - cellOrigin);
+				for (int i = 1; i <= samples; i++)
+				{
+					float t1 = t + (cellEnd - t) * i / samples;
+					float d1 = trilinear(corners, origin + direction * t1 - cellOrigin);
+					if ((d0 < 0) != (d1 < 0))
+					{
+						for (int refine = 0; refine < 3; refine++)
+						{
+							float tm = t0 + (t1 - t0) * d0 / (d0 - d1);
+							float dm = trilinear(corners, origin + direction * tm - cellOrigin);
+							if ((d0 < 0) == (dm < 0))
+								t0 = tm, d0 = dm;
+							else
+								t1 = tm, d1 = dm;
+						}
+						float tHit = d0 == d1 ? t0 : t0 + (t1 - t0) * d0 / (d0 - d1);
+						float3 local = origin + direction * tHit - cellOrigin;
+						// gradient of the trilinear density, from data space to local space
+						float3 gradient(
+							Lerp(Lerp(corners[1] - corners[0], corners[5] - corners[4], local.z), Lerp(corners[3] - corners[2], corners[7] - corners[6], local.z), local.y),
+							Lerp(Lerp(corners[2] - corners[0], corners[6] - corners[4], local.z), Lerp(corners[3] - corners[1], corners[7] - corners[5], local.z), local.x),
+							Lerp(Lerp(corners[4] - corners[0], corners[5] - corners[1], local.x), Lerp(corners[6] - corners[2], corners[7] - corners[3], local.x), local.y));
+						gradient *= dataSize;
+						distance = tHit / dataPerLocal;
+						intersectionPosition = rayPosition + rayDirection * distance;
+						intersectionNormal = gradient.Length() > 0 ? Normalize(gradient) : -rayDirection;
+						return true;
+					}
+					t0 = t1;
+					d0 = d1;
+				}
+			}
+
+			// next cell
+			t = cellEnd;
+			if (cellExit.x <= cellExit.y && cellExit.x <= cellExit.z)
+			{
+				cell.x += cellStep.x;
+				cellExit.x += cellDelta.x;
+			}
+			else if (cellExit.y <= cellExit.z)
+			{
+				cell.y += cellStep.y;
+				cellExit.y += cellDelta.y;
+			}
+			else
+			{
+				cell.z += cellStep.z;
+				cellExit.z += cellDelta.z;
+			}
+			if (cell.x < blockMin.x || cell.x >= blockMin.x + s_brickSize || cell.x > cellMax.x ||
+				cell.y < blockMin.y || cell.y >= blockMin.y + s_brickSize || cell.y > cellMax.y ||
+				cell.z < blockMin.z || cell.z >= blockMin.z + s_brickSize || cell.z > cellMax.z)
+				break;
+		}
+		t = max(t, blockExit) + step;
+	}
+	return false;
+}
+
+bool MarchingCubeTerrain::densityRaycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal)
+{
+	if (rayDirection.Length() < 0.00001f || distance < 0.00001f || m_totalSize == 0)
+		return false;
+	if (m_allDensityRangesDirty)
+		updateDensityRanges();
+	TerrainRaycastStats::Ray ray(*m_raycastStats);
+	ray.hit = visitVoxelVolume(*m_terrainData, [&](const auto& volume)
+	{
+		return densityRaycast(volume, rayPosition, rayDirection, distance, intersectionPosition, intersectionNormal);
+	});
+	return ray.hit;
+}
+
+void MarchingCubeTerrain::initCubes()
+{
+	// set static members
+	MarchingCubeMesh::setNrCubes(m_nrCubes);
+	MarchingCubeMesh::setTerrainData(m_terrainData);
+
+	// init cube table, chunks are created by the first mesh run that finds a surface in them
+	for (int i = 0; i < (int)m_cubes.size(); i++)
+		releaseCube(getCubeId(i));
+	size_t totalCubes = (size_t)m_nrCubes * m_nrCubes * m_nrCubes;
+	m_cubes.resize(totalCubes);
+	m_cubeRanges.resize(totalCubes);
+	m_marchingCubeQueue.clear();
+	m_marchingCubeQueueLookup.assign(totalCubes, false);
+}
+
+int MarchingCubeTerrain::getCubeIndex(int3 cubeIdx) const
+{
+	return cubeIdx.x + cubeIdx.y * m_nrCubes + cubeIdx.z * m_nrCubes * m_nrCubes;
+}
+
+int3 MarchingCubeTerrain::getCubeId(int cubeIndex) const
+{
+	return int3(cubeIndex % m_nrCubes, (cubeIndex / m_nrCubes) % m_nrCubes, cubeIndex / (m_nrCubes * m_nrCubes));
+}
+
+MarchingCubeMesh* MarchingCubeTerrain::getCube(int3 cubeIdx) const
+{
+	return m_cubes[getCubeIndex(cubeIdx)].get();
+}
+
+MarchingCubeMesh& MarchingCubeTerrain::createCube(int3 cubeIdx)
+{
+	std::unique_ptr<MarchingCubeMesh>& cube = m_cubes[getCubeIndex(cubeIdx)];
+	if (!cube)
+	{
+		int3 dataStride(m_sizeX / m_nrCubes, m_sizeY / m_nrCubes, m_sizeZ / m_nrCubes);
+
+		cube = createCubeMesh(cubeIdx);
+		cube->setStartDataPos(cubeIdx * dataStride);
+		cube->setDataSizes(dataStride);
+	}
+	return *cube;
+}
+
+std::unique_ptr<MarchingCubeMesh> MarchingCubeTerrain::createCubeMesh(int3)
+{
+	return std::make_unique<MarchingCubeMesh>();
+}
+
+void MarchingCubeTerrain::releaseCube(int3 cubeIdx)
+{
+	m_cubes[getCubeIndex(cubeIdx)].reset();
+}
+
+void MarchingCubeTerrain::updateCubeAllocation()
+{
+	for (int i = 0; i < (int)m_cubes.size(); i++)
+	{
+		int3 id = getCubeId(i);
+		if (isCubeCrossingSurface(id))
+			createCube(id).markAllDirty();
+		else if (m_cubes[i])
+			releaseCube(id);
+	}
+}
+
+void MarchingCubeTerrain::runAllMarchingCubes()
+{
+	Profiler::start("RunAllMarchingCubes");
+	TerrainTrace::Scope scope("RunAllMarchingCubes");
+	finishAsyncRemeshes();
+
+	// create mesh
+	updateDensityRanges();
+	updateCubeAllocation();
+	std::vector<MarchingCubeMesh*> cubes;
+	for (size_t i = 0; i < m_cubes.size(); i++)
+	{
+		if (m_cubes[i])
+			cubes.push_back(m_cubes[i].get());
+	}
+	remeshCubes(cubes);
+	m_marchingCubeQueue.clear();
+	m_marchingCubeQueueLookup.assign(m_marchingCubeQueueLookup.size(), false);
+
+	initOctree();
+
+	Profiler::stop();
+}
+
+void MarchingCubeTerrain::runQueuedMarchingCubes()
+{
+	Profiler::start("RunQueuedMarchingCubes");
+	TerrainTrace::Scope scope("RunQueuedMarchingCubes");
+	finishAsyncRemeshes();
+
+	bool anyTerrainUpdates = (m_marchingCubeQueue.size() > 0);
+	if (anyTerrainUpdates) {
+		remeshQueuedCubes();
+		initOctree();
+	}
+
+	Profiler::stop();
+}
+
+void MarchingCubeTerrain::remeshQueuedCubes()
+{
+	auto start = std::chrono::steady_clock::now();
+	updateDensityRanges();
+	sortMarchingCubeQueue();
+
+	// Remesh in batches of one chunk per thread until the next batch would likely exceed the frame budget
+	size_t batchSize = max((size_t)std::thread::hardware_concurrency(), (size_t)1);
+	std::vector<MarchingCubeMesh*> batch;
+	float elapsed = 0;
+	float lastBatch = 0;
+	size_t remeshed = 0;
+	size_t next = 0;
+	while (next < m_marchingCubeQueue.size())
+	{
+		if (m_remeshBudget > 0 && remeshed > 0 && elapsed + lastBatch > m_remeshBudget)
+			break;
+		batch.clear();
+		for (; next < m_marchingCubeQueue.size() && batch.size() < batchSize; next++)
+		{
+			int3 id = m_marchingCubeQueue[next];
+			MarchingCubeMesh* cube = getCube(id);
+			if (cube && !cube->isDirty())
+				continue; // queued but none of its data cells changed
+			if (!isCubeCrossingSurface(id))
+			{
+				if (cube)
+					releaseCube(id); // only solid or air, nothing to march
+				continue;
+			}
+			if (!cube)
+				cube = &createCube(id);
+			batch.push_back(cube);
+		}
+		remeshCubes(batch);
+		remeshed += batch.size();
+
+		float total = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		lastBatch = total - elapsed;
+		elapsed = total;
+	}
+
+	// keep what didn't fit, in priority order
+	std::vector<int3> remaining(m_marchingCubeQueue.begin() + next, m_marchingCubeQueue.end());
+	m_marchingCubeQueue.clear();
+	m_marchingCubeQueueLookup.assign(m_marchingCubeQueueLookup.size(), false);
+	for (size_t i = 0; i < remaining.size(); i++)
+		queueMarchingCube(remaining[i]);
+
+	m_remeshStats.backlog = m_marchingCubeQueue.size();
+	m_remeshStats.inFlight = getRemeshesInFlight();
+	m_remeshStats.remeshed = remeshed;
+	m_remeshStats.milliseconds = elapsed;
+}
+
+void MarchingCubeTerrain::remeshCubes(const std::vector<MarchingCubeMesh*>& cubes)
+{
+	for (size_t i = 0; i < cubes.size(); i++)
+	{
+		cubes[i]->buildMesh();
+		cubes[i]->releaseUploadedData();
+	}
+}
+
+void MarchingCubeTerrain::sortMarchingCubeQueue()
+{
+	// queue order
+}
+
+void MarchingCubeTerrain::finishAsyncRemeshes()
+{
+	// every remesh is done when remeshCubes returns
+}
+
+size_t MarchingCubeTerrain::getRemeshesInFlight() const
+{
+	return 0;
+}
+
+void MarchingCubeTerrain::setRemeshBudget(float milliseconds)
+{
+	m_remeshBudget = milliseconds;
+}
+
+MarchingCubeTerrain::RemeshStats MarchingCubeTerrain::getRemeshStats() const
+{
+	return m_remeshStats;
+}
+
+void MarchingCubeTerrain::setMeshMode(MarchingCubeMesh::MeshMode mode)
+{
+	if (mode == MarchingCubeMesh::getMeshMode())
+		return;
+	MarchingCubeMesh::setMeshMode(mode);
+
+	// every chunk has to be rebuilt in the new format
+	for (int i = 0; i < (int)m_cubes.size(); i++)
+	{
+		if (!m_cubes[i])
+			continue;
+		m_cubes[i]->markAllDirty();
+		queueMarchingCube(getCubeId(i));
+	}
+}
+
+void MarchingCubeTerrain::setRaycastTree(MarchingCubeMesh::RaycastTree tree)
+{
+	if (tree == MarchingCubeMesh::getRaycastTree())
+		return;
+	MarchingCubeMesh::setRaycastTree(tree);
+
+	// indexed meshes no longer have the vertices to build the other tree from, so every chunk is marched again
+	for (int i = 0; i < (int)m_cubes.size(); i++)
+	{
+		if (!m_cubes[i])
+			continue;
+		m_cubes[i]->markAllDirty();
+		queueMarchingCube(getCubeId(i));
+	}
+}
+
+void MarchingCubeTerrain::setTerrainData(int sizeX, int sizeY, int sizeZ, unsigned char arr[])
+{
+	std::shared_ptr<unsigned char[]> sp(arr);
+	setTerrainData(sizeX, sizeY, sizeZ, sp);
+}
+
+void MarchingCubeTerrain::setTerrainData(int sizeX, int sizeY, int sizeZ, std::shared_ptr<unsigned char[]> sp)
+{
+	finishAsyncRemeshes();
+	m_sizeX = sizeX;
+	m_sizeY = sizeY;
+	m_sizeZ = sizeZ;
+	m_totalSize = m_sizeX * m_sizeY * m_sizeZ;
+
+	// copied into a new volume of the storage chosen at init. Held views keep the volume they were published with
+	createTerrainData();
+	m_terrainData->loadDensities(sp.get());
+	invalidateTerrainData();
+	publishQueryView();
+}
+
+const std::vector<CaveCarver::StructurePoint>& MarchingCubeTerrain::getStructurePoints() const
+{
+	return m_structurePoints;
+}
+
+const std::vector<float3>& MarchingCubeTerrain::getPlayerSpawnPositions() const
+{
+	return m_playerSpawnPositions;
+}
+
+void MarchingCubeTerrain::generateData_sphere()
+{
+	float boundSize = 10;
+	float planetRadius = 4;
+	float3 id;
+	float3 dataSizeMinusOne((float)m_sizeX - 1, (float)m_sizeY - 1, (float)m_sizeZ - 1);
+
+	for (int iz = 0; iz < m_sizeZ; iz++)
+	{
+		id.z = (float)iz;
+		for (int iy = 0; iy < m_sizeY; iy++)
+		{
+			id.y = (float)iy;
+			for (int ix = 0; ix < m_sizeX; ix++)
+			{
+				id.x = (float)ix;
+
+				// Sphere
+				float3 worldPos = ((id / dataSizeMinusOne) - float3(0.5, 0.5, 0.5)) * boundSize;
+				float distFromCentre = worldPos.Length();
+				float mapValue = distFromCentre - planetRadius;
+				setTerrainPixel(ix, iy, iz, mapValue);
+
+			}
+		}
+	}
+}
+
+void MarchingCubeTerrain::generateData_cheese()
+{
+	for (float iz = 0; iz < m_sizeZ; iz++)
+	{
+		for (float iy = 0; iy < m_sizeY; iy++)
+		{
+			for (float ix = 0; ix < m_sizeX; ix++)
+			{
+				float radius = (m_sizeX + m_sizeZ) / 2.f;
+				float angle = 3 / 3.5f;
+				float2 pos(ix, iz);
+				float2 posNorm(pos);
+				posNorm.Normalize();
+				float2 one(1, 1);
+				one.Normalize();
+
+				if (pos.Length() < radius && posNorm.Dot(one) > angle)
+					setTerrainPixel((int)roundf(ix), (int)roundf(iy), (int)roundf(iz), 0);
+				else
+					setTerrainPixel((int)roundf(ix), (int)roundf(iy), (int)roundf(iz), m_destroyValue);
+
+				if (iy == 0 || (m_sizeY * 0.6) < iy)
+					setTerrainPixel((int)roundf(ix), (int)roundf(iy), (int)roundf(iz), m_destroyValue);
+			}
+		}
+	}
+
+	//Create cheese holes
+	float3 scale = getTerrainScale();
+	for (size_t i = 0; i < 70; i++)
+	{
+		float x = RandomFloat(0.0f, scale.x);
+		float y = RandomFloat(0.0f, scale.y);
+		float z = RandomFloat(0.0f, scale.z);
+		float radius = RandomFloat(scale.x * 0.01f, scale.x * 0.07f);;
+		destroySphere_dataSpace(translateTerrainToDataSpace(float3(x, y, z)), radius / getVoxelLength());
+	}
+}
+
+void MarchingCubeTerrain::generateData_fill()
+{
+	// a new volume, which starts at density 0, rather than refilling the one held views may be reading
+	finishAsyncRemeshes();
+	createTerrainData();
+	invalidateTerrainData();
+	publishQueryView();
+
+	// comment out in final release. Draws a boundry around the cube
+
+	/*
+	for (float iz = 0; iz < m_sizeZ; iz++)
+	{
+		for (float iy = 0; iy < m_sizeY; iy++)
+		{
+			for (float ix = 0; ix < m_sizeX; ix++)
+			{
+				//if (((ix * iy < 20) || (ix == m_sizeX - 2) || (iy == m_sizeY - 2) || (iz == m_sizeZ - 2)) && sin(ix + iy + iz) < 0)
+				//setTerrainPixel((int)roundf(ix), (int)roundf(iy), (int)roundf(iz), m_destroyValue);
+				}
+		}
+	}
+	*/
+
+}
+
+void MarchingCubeTerrain::generateData_testCave(int nrOfPlayers, unsigned int seed)
+{
+	Profiler::start("GenerateData_testCave");
+	TerrainTrace::Scope scope("GenerateData_testCave");
+	generateData_fill();
+	L_System ls;
+	CaveCarver cc;
+	std::string str;
+
+	float3 scale = getTerrainScale();
+	float sx = scale.x;
+
+	// define spawnpoints, in range [0,1] later multiplied with scale (placement temp until we decide something better) 	// |407|
+	m_playerSpawnPositions =																									// |2 3|
+	{																														// |615|
+		{0.5f, 0.8f, 0.8f}, {0.5f, 0.8f, 0.2f}, {0.2f, 0.8f, 0.5f}, {0.8f, 0.8f, 0.5f},
+		{0.2f, 0.7f, 0.8f}, {0.8f, 0.7f, 0.2f}, {0.2f, 0.7f, 0.2f}, {0.8f, 0.7f, 0.8f}
+	};
+
+	//for (size_t i = 0; i < nrOfPlayers; i++)
+	//{
+	//	m_playerSpawnPositions.push_back(playerSpawns[i]);
+	//}
+
+	// initiate cave L-system
+	srand(seed);
+	m_latestSeed = seed;
+	ls.createBasicRuleSet();
+
+	std::vector<CaveCarver::StructurePoint> newPoints;
+
+	int nrOfCaves[] = { 10,0,0 };	// caveSize 3,4,5
+
+	if (sx > 21.f)
+	{
+		nrOfCaves[1] += 2;
+	}
+	if (sx > 41.f)
+	{
+		nrOfCaves[2] += 2;
+	}
+
+	for (int iCaveSize = 0; iCaveSize < 3; iCaveSize++)
+	{
+		for (int i = 0; i < nrOfCaves[iCaveSize]; i++)
+		{
+			str = ls.runSentence("K", iCaveSize + 3);
+			float3 pos = float3(RandomFloat(0, 1), RandomFloat(0, 0.4f), RandomFloat(0, 1)) * scale;
+			cc.createStructurePoints(str, pos, float3(RandomFloat(-1.f, 1.f), RandomFloat(-0.1f, 0.1f), RandomFloat(-1.f, 1.f)));
+		}
+	}
+
+	cc.ajustPointsToTerrain(*this);
+	m_structurePoints = cc.getStructurePoints();	// get structure before carve deletes it
+	cc.carveData(*this);							// carve resets structure points here so the spawnpoints later won't get scaled the same
+
+	// create spawn points
+	std::vector<CaveCarver::StructurePoint> playerSpawnStructurePoints;
+	for (int i = 0; i < nrOfPlayers; i++)
+	{
+		// Define the logic of the spawn point
+		float3 pos = m_playerSpawnPositions.at(i) * scale;
+		float3 dir = float3(RandomFloat(-1.f, 1.f), RandomFloat(-0.1f, 0.1f), RandomFloat(-1.f, 1.f));
+		str = ls.runSentence("K", 2);
+
+		// Creates a all the structure points based on the provided information
+		cc.createStructurePoints(str, pos, dir);
+		m_playerSpawnPositions.at(i) = pos;
+	}
+
+	// Readjust points so they are within the terrain
+	cc.ajustPointsToTerrain(*this);
+	m_structurePoints.insert(m_structurePoints.end(), cc.getStructurePoints().begin(), cc.getStructurePoints().end());
+	playerSpawnStructurePoints.insert(playerSpawnStructurePoints.end(), cc.getStructurePoints().begin(), cc.getStructurePoints().end());
+	cc.carveData(*this);
+
+	// smooth terrain with 4 iterations
+	for (size_t i = 0; i < 4; i++)
+		smoothTerrain();
+
+	for (int i = 0; i < nrOfPlayers; i++)
+	{
+		CaveCarver::StructurePoint nearestPoint = playerSpawnStructurePoints.at(0);
+		float distance = 999999.0f;
+		for (size_t y = 0; y < playerSpawnStructurePoints.size(); y++)
+		{
+			float currentDistance = DirectX::SimpleMath::Vector3::Distance(m_playerSpawnPositions.at(i), playerSpawnStructurePoints.at(y).pos);
+			if (currentDistance < distance)
+			{
+				distance = currentDistance;
+				nearestPoint = playerSpawnStructurePoints.at(y);
+			}
+		}
+		m_playerSpawnPositions.at(i) = nearestPoint.pos;
+	}
+	Profiler::stop();
+}
+
+std::vector<MarchingCubeTerrain::DecorPlacement> MarchingCubeTerrain::findDecorPlacements(int collectionCount)
+{
+	static const int decorTag = TerrainRaycastStats::registerTag("Decor");
+	TerrainRaycastStats::Tag tag(decorTag);
+	// the rays first, then cast together
+	std::vector<float3> rayPositions;
+	std::vector<float3> rayDirections;
+	for (int iz = 0; iz < m_sizeX; iz++)
+	{
+		for (int iy = 0; iy < m_sizeY; iy++)
+		{
+			for (int ix = 0; ix < m_sizeX; ix++)
+			{
+				int3 node = int3(ix, iy, iz);
+				if (isOnEdge(node)) {
+					if (RandomFloat(0, 1) > 0.2f)
+						continue;
+
+					rayPositions.push_back(float3((float)ix / m_sizeX, (float)iy / m_sizeY, (float)iz / m_sizeZ));
+					rayDirections.push_back(Normalize(float3(RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1))));
+				}
+			}
+		}
+	}
+	std::vector<float> distances(rayPositions.size(), 1.f);
+	std::vector<RayHit> hits(rayPositions.size());
+	raycastBatch_localSpace(rayPositions.size(), rayPositions.data(), rayDirections.data(), distances.data(), hits.data());
+
+	std::vector<DecorPlacement> placements;
+	for (const RayHit& hit : hits)
+	{
+		if (!hit.hit || hit.normal.Dot(float3::Up) < 0.6f)
+			continue;
+
+		DecorPlacement placement;
+		placement.collection = rand() % collectionCount;
+		placement.position = hit.position;
+		placement.normal = hit.normal;
+		float3 randDir = float3(RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1));
+		randDir.Normalize();
+		placement.axis = randDir;
+		placement.angle = RandomFloat(0, DirectX::XM_2PI);
+		placement.scale = RandomFloat(1.0f, 4.f);
+		placements.push_back(placement);
+	}
+	return placements;
+}
+
+void MarchingCubeTerrain::destroySphere_dataSpace(float3 pos, float radius)
+{
+	int3 dataStride(m_sizeX / m_nrCubes, m_sizeY / m_nrCubes, m_sizeZ / m_nrCubes);
+
+	//raise destruction
+	visitVoxelVolume(*m_terrainData, [&](auto& volume)
+	{
+		typedef typename std::decay_t<decltype(volume)>::Voxel Voxel;
+		for (int iz = (int)max(0, floorf(pos.z - radius)); iz < (int)min(ceilf(pos.z + radius), m_sizeZ - 1); iz++)
+		{
+			for (int iy = (int)max(0, floorf(pos.y - radius)); iy < (int)min(ceilf(pos.y + radius), m_sizeY - 1); iy++)
+			{
+				for (int ix = (int)max(0, floorf(pos.x - radius)); ix < (int)min(ceilf(pos.x + radius), m_sizeX - 1); ix++)
+				{
+					float length = (pos - float3((float)ix, (float)iy, (float)iz)).Length();
+					if (length < radius)
+					{
+						float falloff = (radius - length * 0.9f) / radius;
+						setTerrainPixel(volume, ix, iy, iz, Voxel::fromDensity(m_destroyValue * falloff * 0.5f + m_surfaceValue));
+					}
+					if (length < radius + 2)
+					{
+						int3 id = int3(ix / dataStride.x, iy / dataStride.y, iz / dataStride.z);
+						queueMarchingCube(id);
+					}
+				}
+			}
+		}
+	});
+}
+
+void MarchingCubeTerrain::damageSphere_dataSpace(float3 pos, float radius, float smoothingDataRange)
+{
+	Profiler::start("damageSphere");
+	TerrainTrace::Scope scope("damageSphere");
+	int3 dataStride(m_sizeX / m_nrCubes, m_sizeY / m_nrCubes, m_sizeZ / m_nrCubes);
+
+	//raise destruction
+	visitVoxelVolume(*m_terrainData, [&](auto& volume)
+	{
+		typedef typename std::decay_t<decltype(volume)>::Voxel Voxel;
+		for (int iz = (int)max(0, floorf(pos.z - radius)); iz < (int)min(ceilf(pos.z + radius), m_sizeZ - 1); iz++)
+		{
+			for (int iy = (int)max(0, floorf(pos.y - radius)); iy < (int)min(ceilf(pos.y + radius), m_sizeY - 1); iy++)
+			{
+				for (int ix = (int)max(0, floorf(pos.x - radius)); ix < (int)min(ceilf(pos.x + radius), m_sizeX - 1); ix++)
+				{
+					float length = (pos - float3((float)ix, (float)iy, (float)iz)).Length();
+					if (length < radius)
+					{
+						float falloff = Map(length, radius - smoothingDataRange, radius, 1, 0);
+						float pixelFade = Clamp<float>(Map(falloff, 0, 1, 0, 1), 0, 1);
+						float terrainMass = 1.f - Voxel::toDensity(volume.get(ix, iy, iz)) / 255.f; // 0 = no terrain, 1 = full terrain
+						float newMass = Clamp<float>(terrainMass - pixelFade, 0, 1);
+						float newPixelValue = Map(newMass, 0, 1, 255.f, 0.f);
+						setTerrainPixel(volume, ix, iy, iz, Voxel::fromDensity(newPixelValue));
+					}
+					if (length < radius + 2)
+					{
+						// Find which marching cubes are affected and add them to the update queue if id isn't aleady there.
+						// This find will run unnecessarely often. Should look into alternative methods
+						int3 id = int3(ix / dataStride.x, iy / dataStride.y, iz / dataStride.z);
+						queueMarchingCube(id);
+					}
+				}
+			}
+		}
+	});
+	Profiler::stop();
+}
+
+void MarchingCubeTerrain::damageCylinder_dataSpace(float3 pos, float radius, float height, float strength)
+{
+	Profiler::start("damageCylinder");
+	TerrainTrace::Scope scope("damageCylinder");
+	int3 dataStride(m_sizeX / m_nrCubes, m_sizeY / m_nrCubes, m_sizeZ / m_nrCubes);
+
+	//raise destruction
+	visitVoxelVolume(*m_terrainData, [&](auto& volume)
+	{
+		typedef typename std::decay_t<decltype(volume)>::Voxel Voxel;
+		for (int iz = (int)max(0, floorf(pos.z - radius)); iz < (int)min(ceilf(pos.z + radius), m_sizeZ - 1); iz++)
+		{
+			for (int iy = (int)max(0, floorf(pos.y - 1)); iy < (int)min(ceilf(pos.y + height + 1), m_sizeY - 1); iy++)
+			{
+				for (int ix = (int)max(0, floorf(pos.x - radius)); ix < (int)min(ceilf(pos.x + radius), m_sizeX - 1); ix++)
+				{
+					float length = (pos - float3((float)ix, pos.y, (float)iz)).Length();
+					if (length < radius && (pos.y <= iy && iy < pos.y + height + 1))
+					{
+						float falloff = (radius - length * 0.4f) / radius;
+						float v = Voxel::toDensity(volume.get(ix, iy, iz));
+
+						setTerrainPixel(volume, ix, iy, iz, Voxel::fromDensity(v + strength * falloff)); // clamped to 255
+					}
+					if (length < radius + 2)
+					{
+						// Find which marching cubes are affected and add them to the update queue if id isn't aleady there.
+						// This find will run unnecessarely often. Should look into alternative methods
+						int3 id = int3(ix / dataStride.x, iy / dataStride.y, iz / dataStride.z);
+						queueMarchingCube(id);
+					}
+				}
+			}
+		}
+	});
+	Profiler::stop();
+}
+
+void MarchingCubeTerrain::smoothTerrain()
+{
+	// Works a row at a time. The six neighbours give both the central difference and the average.
+	// Rows are read when reached, so earlier rows and cells are seen smoothed, same as reading cell by cell
+	visitVoxelVolume(*m_terrainData, [&](auto& volume)
+	{
+		typedef typename std::decay_t<decltype(volume)>::Voxel Voxel;
+		typedef typename Voxel::Type Type;
+		std::vector<Type> row(m_sizeX + 2);	// padded with the cell before and after the row
+		std::vector<Type> rowYNeg(m_sizeX), rowYPos(m_sizeX), rowZNeg(m_sizeX), rowZPos(m_sizeX);
+		Type outside = Voxel::fromDensity(100);
+
+		for (int iz = 0; iz < m_sizeZ; iz++)
+		{
+			for (int iy = 0; iy < m_sizeY; iy++)
+			{
+				volume.readBlock(-1, iy, iz, m_sizeX + 2, 1, 1, row.data(), outside);
+				volume.readBlock(0, iy - 1, iz, m_sizeX, 1, 1, rowYNeg.data(), outside);
+				volume.readBlock(0, iy + 1, iz, m_sizeX, 1, 1, rowYPos.data(), outside);
+				volume.readBlock(0, iy, iz - 1, m_sizeX, 1, 1, rowZNeg.data(), outside);
+				volume.readBlock(0, iy, iz + 1, m_sizeX, 1, 1, rowZPos.data(), outside);
+				for (int ix = 0; ix < m_sizeX; ix++)
+				{
+					int3 point = int3(ix, iy, iz);
+					Type* cell = &row[ix + 1];
+					// same as getDataFieldFlow(point, 1.f)
+					float3 normal(
+						(Voxel::toDensity(cell[1]) - Voxel::toDensity(cell[-1])) / 255,
+						(Voxel::toDensity(rowYPos[ix]) - Voxel::toDensity(rowYNeg[ix])) / 255,
+						(Voxel::toDensity(rowZPos[ix]) - Voxel::toDensity(rowZNeg[ix])) / 255);
+					if (normal.Length() < 0.0001f)
+						continue;
+					normal.Normalize();
+					float tilt = normal.Dot(float3::Up);
+					if (tilt > 0.6f) {
+						// average the cell with its neighbours
+						float sum = Voxel::toDensity(cell[0]) + Voxel::toDensity(cell[1]) + Voxel::toDensity(cell[-1]) +
+							Voxel::toDensity(rowYPos[ix]) + Voxel::toDensity(rowYNeg[ix]) + Voxel::toDensity(rowZPos[ix]) + Voxel::toDensity(rowZNeg[ix]);
+						Type avg = Voxel::fromDensity(sum / 7);
+						setTerrainPixel(volume, ix, iy, iz, avg);
+						*cell = avg; // the next cell sees the smoothed value
+
+						// enqueue 
+						queueMarchingCube_pixelIndex(point);
+					}
+				}
+			}
+		}
+	});
+}
+
+bool MarchingCubeTerrain::isOnEdge(int3 nodeIndex) const
+{
+	if (getTerrainPixel(nodeIndex.x, nodeIndex.y, nodeIndex.z) > m_surfaceValue)
+	{
+		// adjacent nodes outside the grid are read as air so they never count
+		return visitVoxelVolume(*m_terrainData, [&](const auto& volume)
+		{
+			typedef typename std::decay_t<decltype(volume)>::Voxel Voxel;
+			typename Voxel::Type adjacent[27];
+			volume.readBlock(nodeIndex.x - 1, nodeIndex.y - 1, nodeIndex.z - 1, 3, 3, 3, adjacent, Voxel::fromDensity(255));
+			for (int i = 0; i < 27; i++)
+			{
+				if (i != 13 && Voxel::toDensity(adjacent[i]) < m_surfaceValue) // 13 is the middle node
+					return true;
+			}
+			return false;
+		});
+	}
+	return false;
+}
+
+float MarchingCubeTerrain::getTriangleMeshSize()
+{
+	float size = 0;
+	for (int iz = 0; iz < m_nrCubes; iz++)
+	{
+		for (int iy = 0; iy < m_nrCubes; iy++)
+		{
+			for (int ix = 0; ix < m_nrCubes; ix++)
+			{
+				MarchingCubeMesh* cube = getCube(int3(ix, iy, iz));
+				if (cube)
+					size += (float)cube->getMeshDataSize();
+			}
+		}
+	}
+	return size;
+}
+
+float MarchingCubeTerrain::getTerrainDataSize()
+{
+	size_t voxelSize = dispatchVoxelFormat(m_voxelFormat, [](auto voxel) { return sizeof(typename decltype(voxel)::Type); });
+	return (float)m_totalSize * voxelSize;
+}
+
+void MarchingCubeTerrain::addMemoryUsage(TerrainMemoryReport& report) const
+{
+	if (m_terrainData)
+		report.terrain[TerrainMemoryReport::Memory_VoxelData] += m_terrainData->getMemorySize();
+	report.terrain[TerrainMemoryReport::Memory_DensityRanges] += (m_brickRanges.capacity() + m_cubeRanges.capacity() + m_rangePyramid.capacity()) * sizeof(DensityRange) +
+		(m_brickRangeDirty.capacity() + m_pyramidCrossing.capacity()) * sizeof(unsigned char) + m_brickCellMasks.capacity() * sizeof(unsigned long long) + m_dirtyBricks.capacity() * sizeof(int) +
+		m_pyramidLevelStart.capacity() * sizeof(int) + m_pyramidLevelSize.capacity() * sizeof(int3);
+	report.terrain[TerrainMemoryReport::Memory_ChunkTable] += m_cubes.capacity() * sizeof(std::unique_ptr<MarchingCubeMesh>) +
+		m_marchingCubeQueueLookup.capacity() / 8 + m_marchingCubeQueue.capacity() * sizeof(int3);
+	report.terrain[TerrainMemoryReport::Memory_Other] += m_structurePoints.capacity() * sizeof(CaveCarver::StructurePoint) +
+		m_playerSpawnPositions.capacity() * sizeof(float3) + m_raycastStats->getMemorySize();
+
+	for (size_t i = 0; i < m_cubes.size(); i++)
+	{
+		if (!m_cubes[i])
+			continue;
+		TerrainMemoryReport::Chunk chunk;
+		chunk.id = getCubeId((int)i);
+		m_cubes[i]->addMemoryUsage(chunk);
+		report.chunks.push_back(chunk);
+	}
+}
+
+TerrainMemoryReport MarchingCubeTerrain::getMemoryReport() const
+{
+	TerrainMemoryReport report;
+	addMemoryUsage(report);
+	return report;
+}
+
+TerrainRaycastStats& MarchingCubeTerrain::getRaycastStats()
+{
+	return *m_raycastStats;
+}
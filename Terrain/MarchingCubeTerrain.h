@@ -0,0 +1,285 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include "MarchingCubeMesh.h"
+#include "CaveCarver.h"
+#include "TerrainQueryView.h"
+#include "TerrainRaycastStats.h"
+
+/*
+The terrain without the game around it: the density grid, edits, cave generation, the chunk meshes and raycasts against them.
+Builds on its own (see CMakeLists.txt), MarchingCubeHandler puts it in a scene and adds rendering, physics and decor.
+Positions are in one of three spaces:
+	local space		[0, 1] over the whole terrain, used by the meshes and raycasts
+	terrain space	local space times the terrain scale, world units with the terrain's corner at the origin. Used by generation
+	data space		[0, size] in data cells, used by edits
+The virtual functions are the points a game hooks into, the defaults mesh serially and keep the scale here.
+Everything is called from one thread, the main thread, except for the queries of a TerrainQueryView, see acquireQueryView.
+*/
+class MarchingCubeTerrain
+{
+public:
+	struct RemeshStats {
+		size_t backlog = 0;		// chunks still queued after the latest run
+		size_t inFlight = 0;	// async remeshes not swapped in yet
+		size_t remeshed = 0;	// chunks remeshed or started by the latest run
+		float milliseconds = 0;	// main thread time of the latest run
+	};
+	// Where findDecorPlacements wants a piece of decor, in local space
+	struct DecorPlacement {
+		int collection;		// which of the collections
+		float3 position;
+		float3 normal;		// of the surface it stands on
+		float3 axis;		// rotation, 'angle' radians around 'axis'
+		float angle;
+		float scale;
+	};
+	typedef TerrainQueryView::RayHit RayHit;
+protected:
+	static const int s_defaultNrCubes = 16;
+	int m_nrCubes;	// marching cube chunks along each axis, chosen by init
+	// Chunk table indexed by x + y * m_nrCubes + z * m_nrCubes * m_nrCubes.
+	// A chunk is only allocated once it has a surface, chunks of solid rock or air are null
+	std::vector<std::unique_ptr<MarchingCubeMesh>> m_cubes;
+
+	std::vector<bool> m_marchingCubeQueueLookup; // quick way of checking if cube data is updated. Used together with queue.
+	std::vector<int3> m_marchingCubeQueue;
+
+	// Remesh scheduling. Queued chunks are remeshed in the order of sortMarchingCubeQueue, as long as they fit the time budget of a frame
+	float m_remeshBudget = 4.f;					// milliseconds per frame, 0 remeshes the whole queue
+	RemeshStats m_remeshStats;
+
+	std::shared_ptr<TerrainRaycastStats> m_raycastStats = std::make_shared<TerrainRaycastStats>();	// shared with the query views
+
+	// The latest published view of the chunks' raycast meshes and the terrain data. The main thread replaces it and reads it directly,
+	// other threads only through acquireQueryView
+	std::shared_ptr<const TerrainQueryView> m_queryView;
+	unsigned long long m_queryEpoch = 0;	// of the latest view
+	// Replaced views, oldest first, kept until no reader holds them anymore. Bricks compacted while a view was current
+	// may still be read through it, their cells are reused once no view up to m_retiredBricksEpoch is held
+	std::vector<std::shared_ptr<const TerrainQueryView>> m_heldViews;
+	unsigned long long m_retiredBricksEpoch = 0;	// of the view current when bricks were last compacted
+
+	std::shared_ptr<VoxelVolume> m_terrainData;	// Basicly a 3D texture
+	VoxelFormat m_voxelFormat = Voxel_UInt8;		// format of the terrain data, chosen by init
+	VoxelStorage m_voxelStorage = Storage_Dense;	// layout of the terrain data, chosen by init
+	int m_sizeX;
+	int m_sizeY;
+	int m_sizeZ;
+	int m_totalSize;
+	float3 m_terrainScale;	// size of the terrain in world units, see getTerrainScale
+
+	// Min and max density of blocks of data cells. A chunk whose range doesn't cross the surface value has no triangles and is never marched.
+	struct DensityRange {
+		float min;
+		float max;
+	};
+	static const int s_brickSize = 4;					// data cells per side of a brick
+	int3 m_brickCount;
+	std::vector<DensityRange> m_brickRanges;			// Grown directly by setTerrainPixel, shrunk to exact values by updateDensityRanges
+	std::vector<unsigned char> m_brickRangeDirty;
+	std::vector<int> m_dirtyBricks;
+	std::vector<DensityRange> m_cubeRanges;				// per chunk, covers all data cells a marching cube reads, including the shared border
+	bool m_allDensityRangesDirty = true;
+	// Min/max pyramid over the bricks for densityRaycast_localSpace. A level 0 node covers the cells of a brick and the corners they read,
+	// which reach into the next brick along every axis. Every level above halves the nodes along every axis, up to a single node.
+	// Grown with the brick ranges on edits and made exact again by updateDensityRanges
+	std::vector<DensityRange> m_rangePyramid;
+	// 1 for the pyramid nodes whose range holds the surface value, kept with m_rangePyramid. A node test then reads a byte
+	// instead of a range, the flags of a 128^3 terrain fit the L1 cache
+	std::vector<unsigned char> m_pyramidCrossing;
+	// Per brick, a bit for each of its cells whose corners are both below and at or above the surface value, x fastest.
+	// Computed with level 0 of the pyramid, set for the cells around an edited data cell until then
+	std::vector<unsigned long long> m_brickCellMasks;
+	std::vector<int> m_pyramidLevelStart;		// first node of every level
+	std::vector<int3> m_pyramidLevelSize;		// nodes along every axis of every level
+
+	float m_surfaceValue; // is right now hardcoded both here and in MarchingCubeMesh
+	float m_destroyValue; // is right now hardcoded both here and in MarchingCubeMesh
+
+	std::vector<CaveCarver::StructurePoint> m_structurePoints;		// Structure points used in carving algorithm, in terrain space
+	std::vector<float3> m_playerSpawnPositions;						// The generated player spawn positions, in terrain space
+
+	unsigned int m_latestSeed = 0;
+
+protected:
+	void initDataTexture(int sizeX, int sizeY, int sizeZ);
+	// Replaces the terrain data by a new volume of the current size. Views readers hold keep the old one
+	void createTerrainData();
+	// Brings brick and cube density ranges up to date with the terrain data
+	void updateDensityRanges();
+	void computeBrickRange(int brickIdx);
+	void computeCubeRange(int3 cubeIdx);
+	// Marks every density range and chunk mesh as out of date, used when the terrain data is written without setTerrainPixel
+	void invalidateTerrainData();
+	// Marks the cells of every chunk that reads the data cell as changed, so only those rows are remeshed
+	void markTerrainPixelDirty(int x, int y, int z);
+	// Returns true if the cube has cells both below and above the surface value. Only valid after updateDensityRanges
+	bool isCubeCrossingSurface(int3 cubeIdx) const;
+	// Recomputes the pyramid nodes over the bricks from the brick ranges, every node if bricks is null
+	void updateRangePyramid(const std::vector<int>* bricks);
+	// Widens the pyramid nodes over the brick to contain its range
+	void growRangePyramid(int brickIdx, const DensityRange& range);
+	// Reads the corners of the brick's cells for its bit mask, see m_brickCellMasks
+	unsigned long long computeBrickCellMask(int3 brick) const;
+	template<typename Volume>
+	bool densityRaycast(const Volume& volume, float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal) const;
+	// Rays of a batch per job, a multiple of the packet size
+	static const int s_raycastJobSize = 64;
+	// Publishes a new view of the chunk meshes and the terrain data, the raycasts of the main thread see it right away, other threads once they acquire it
+	void publishQueryView();
+	// Lets go of the replaced views no reader holds anymore, and returns the compacted bricks to the terrain data once none that may read them is left
+	void reclaimReleasedViews();
+	// Remeshes queued chunks in priority order until the frame budget is used, the rest stays queued
+	void remeshQueuedCubes();
+	// Densities in [0, 255], converted to and from the voxel format
+	void setTerrainPixel(int x, int y, int z, float density);
+	float getTerrainPixel(int x, int y, int z) const;
+	float getTerrainPixel(float3 pos) const;
+	// For the editing loops, which take the volume as the volume class of its format and storage once instead of converting every cell
+	template<typename Volume>
+	void setTerrainPixel(Volume& volume, int x, int y, int z, typename Volume::Type value);
+
+	// Chunk table
+	int getCubeIndex(int3 cubeIdx) const;
+	int3 getCubeId(int cubeIndex) const;
+	// Returns null if the chunk isn't allocated
+	MarchingCubeMesh* getCube(int3 cubeIdx) const;
+	// Allocates and places the chunk if it isn't allocated
+	MarchingCubeMesh& createCube(int3 cubeIdx);
+	// Allocates chunks with a surface and frees the others, used before remeshing everything
+	void updateCubeAllocation();
+
+	// Adds cube index to update queue.
+	// Returns true if added to queue.
+	bool queueMarchingCube(int3 cubeIdx);
+	// Adds pixel's cube index to update queue and aand adjacent cubes the pixel is edgeing.
+	// Returns true if added to queue.
+	bool queueMarchingCube_pixelIndex(int3 pixelIdx);
+
+	// Game hooks
+	// Makes an unplaced chunk, createCube gives it its data cells
+	virtual std::unique_ptr<MarchingCubeMesh> createCubeMesh(int3 cubeIdx);
+	// Frees the chunk
+	virtual void releaseCube(int3 cubeIdx);
+	// Builds the meshes of the chunks and returns when all are done
+	virtual void remeshCubes(const std::vector<MarchingCubeMesh*>& cubes);
+	// Orders the queue by priority, highest first
+	virtual void sortMarchingCubeQueue();
+	// Waits for any remesh still running on other threads, used before the chunks or terrain data are changed
+	virtual void finishAsyncRemeshes();
+	// Remeshes that may still read the terrain data
+	virtual size_t getRemeshesInFlight() const;
+	virtual void setTerrainScale(float3 scale);
+	// Adds the terrain's memory and that of every allocated chunk to the report, the game adds what it owns
+	virtual void addMemoryUsage(TerrainMemoryReport& report) const;
+	// Runs job(0) to job(jobCount - 1) of a raycast batch and returns when all are done, one after the other by default.
+	// The jobs only read the terrain and write their own rays' results
+	virtual void runRaycastJobs(size_t jobCount, const std::function<void(size_t job)>& job);
+
+public:
+	MarchingCubeTerrain();
+	virtual ~MarchingCubeTerrain();
+
+	// nrCubes is the amount of marching cube chunks along each axis, format is how the terrain data stores its cells.
+	// storage is how the cells are laid out: bricks take less memory where the terrain is mostly solid or air, dense reads faster.
+	// The terrain is 'scale' world units along its longest side
+	void init(int sizeX, int sizeY, int sizeZ, float scale, int nrCubes = s_defaultNrCubes, VoxelFormat format = Voxel_UInt8, VoxelStorage storage = Storage_Dense);
+	VoxelFormat getVoxelFormat() const;
+	VoxelStorage getVoxelStorage() const;
+	int3 getDataSize() const;
+	// Size of the terrain in world units
+	virtual float3 getTerrainScale() const;
+	// World units per data cell
+	float getVoxelLength() const;
+	float3 translateTerrainToDataSpace(float3 terrainPos) const;
+
+	float3 getDataFieldFlow(int3 pixelIdx, float localGridStepSize = 1.f); // gets normal based on neighboring data cells, based on central difference
+
+	// Octree. Called whenever chunk meshes changed, for the game's culling. Publishes the query view the raycasts walk
+	virtual void initOctree();
+	/*
+	Raycast against terrain mesh in local space. Visits the chunks along the ray nearest first and stops at the first one it hits, without allocating.
+	Returns true if ray collided with any triangles.
+	Parameter 'distance' defines the ray length and will also be overwritten by the rays collision distance.
+	Parameters 'intersectionPosition' and 'intersectionNormal' will be overwritten by the rays intersection point and normal of collision surface.
+	*/
+	bool longRaycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
+	// Raycast against terrain mesh in local space, the same chunk walk as the long raycast
+	bool shortRaycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
+	// The long raycast, which is as fast for short distances now
+	bool raycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
+	/*
+	Raycasts 'count' rays against the terrain mesh in local space, every hit is the one longRaycast_localSpace gives for the ray.
+	The rays are sorted by the chunk and direction octant they start in, then cast 8 at a time: the rays of a packet that are in the
+	same chunk are tested together, every triangle against all of them at once (see MarchingCubeMesh::raycastPacket).
+	Batches of more than s_raycastJobSize rays are split into jobs, which the game runs on its thread pool.
+	*/
+	virtual void raycastBatch_localSpace(size_t count, const float3* rayPositions, const float3* rayDirections, const float* distances, RayHit* hits);
+	/*
+	Raycast against the density field in local space instead of the meshes, so it is valid right after an edit, before the chunks are remeshed.
+	Skips the blocks the surface can't be in with a 3D DDA over the nodes of the min/max pyramid, climbing to a coarser level whenever
+	the parent node can't hold the surface either. In a brick that may hold it, only the cells of its mask are read (see m_brickCellMasks),
+	and the ray finds where their interpolated density crosses the surface value. The normal is the density gradient, pointing towards air.
+	The trilinear surface inside a cell isn't the cell's triangles, so rays that graze the surface can hit here and miss the mesh or
+	the other way round. Tolerance against longRaycast_localSpace, checked by TerrainBenchmark: at most 0.5% of rays differ on hit
+	or miss, and 99% of the rays both hit are within a data cell of each other. On TerrainBenchmark's long rays it takes 0.75 of
+	longRaycast_localSpace's time at 128^3 and 0.8 at 256^3. At 512^3 the lower levels and the cells no longer fit the cache and it is 1.1 to 1.25 times slower.
+	*/
+	bool densityRaycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal);
+
+	// Counters of the raycasts of every thread, per caller. The game ends their frames
+	TerrainRaycastStats& getRaycastStats();
+	/*
+	The latest published view of the terrain, for queries from any thread, and the one function of the terrain other threads may call.
+	Take it when a job starts and keep it while the job queries, its raycasts see the chunk meshes as they were when it was published.
+	Null before init
+	*/
+	std::shared_ptr<const TerrainQueryView> acquireQueryView() const;
+
+	// MC handling
+	virtual void initCubes();
+
+	// Mech creating
+	void runAllMarchingCubes();
+	void runQueuedMarchingCubes();
+	// Time in milliseconds queued remeshing may use per frame, 0 for no limit
+	void setRemeshBudget(float milliseconds);
+	RemeshStats getRemeshStats() const;
+	// Switches between flat triangle list and indexed (shared vertex) meshes. Queues all chunks for a rebuild.
+	void setMeshMode(MarchingCubeMesh::MeshMode mode);
+	// Switches the chunks' raycast trees between octrees and BVHs. Queues all chunks for a rebuild, raycasts use the old trees until then
+	void setRaycastTree(MarchingCubeMesh::RaycastTree tree);
+
+	// data reading, 8 bit densities that are stored in the terrain's voxel format
+	void setTerrainData(int sizeX, int sizeY, int sizeZ, unsigned char arr[]);
+	void setTerrainData(int sizeX, int sizeY, int sizeZ, std::shared_ptr<unsigned char[]> sp);
+
+	const std::vector<CaveCarver::StructurePoint>& getStructurePoints() const;
+	const std::vector<float3>& getPlayerSpawnPositions() const;
+
+	// Generates data.
+	void generateData_sphere();
+	void generateData_cheese();
+	void generateData_fill();
+
+	void generateData_testCave(int nrOfPlayers = 2, unsigned int seed = rand());
+
+	// Picks spots on the floor for decor, every placement is from one of 'collectionCount' collections
+	std::vector<DecorPlacement> findDecorPlacements(int collectionCount);
+
+	// Edits in data space. Radius, height and smoothing are in data cells
+	void destroySphere_dataSpace(float3 pos, float radius);
+	void damageSphere_dataSpace(float3 pos, float radius, float smoothingDataRange = 1.f);
+	void damageCylinder_dataSpace(float3 pos, float radius, float height, float strength = 180);
+	void smoothTerrain();
+
+	// check terrain
+	bool isOnEdge(int3 nodeIndex) const;
+
+	float getTriangleMeshSize();
+	float getTerrainDataSize();
+	// Everything the terrain keeps in memory, per chunk and by category
+	TerrainMemoryReport getMemoryReport() const;
+};
@@ -0,0 +1,216 @@
+#include "pch.h"
+#include "TerrainBvh.h"
+#include <algorithm>
+
+static_assert(sizeof(TerrainBvh::Node) == 32, "BVH nodes are meant to be 32 bytes, two to a cache line");
+
+namespace
+{
+	const float s_huge = 1e30f;
+
+	template<typename Bounds>
+	inline void setEmpty(Bounds& bounds)
+	{
+		for (int axis = 0; axis < 4; axis++)
+		{
+			bounds.low[axis] = s_huge;
+			bounds.high[axis] = -s_huge;
+		}
+	}
+
+	template<typename Bounds>
+	inline void grow(Bounds& bounds, const Bounds& other)
+	{
+		for (int axis = 0; axis < 4; axis++)
+		{
+			bounds.low[axis] = min(bounds.low[axis], other.low[axis]);
+			bounds.high[axis] = max(bounds.high[axis], other.high[axis]);
+		}
+	}
+
+	template<typename Bounds>
+	inline float getHalfArea(const Bounds& bounds)
+	{
+		float x = bounds.high[0] - bounds.low[0], y = bounds.high[1] - bounds.low[1], z = bounds.high[2] - bounds.low[2];
+		if (x < 0 || y < 0 || z < 0)
+			return 0; // empty
+		return x * y + y * z + z * x;
+	}
+}
+
+void TerrainBvh::build(const float3* positions, size_t stride, const unsigned int* indices, size_t triangleCount)
+{
+	static thread_local std::vector<BuildTriangle> triangles;
+	static thread_local std::vector<Node> nodes;
+
+	if (triangleCount == 0)
+	{
+		clear();
+		return;
+	}
+
+	// bounds and center of every triangle
+	const char* vertexData = (const char*)positions;
+	triangles.resize(triangleCount);
+	Bounds box;
+	setEmpty(box);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		BuildTriangle& triangle = triangles[t];
+		for (int i = 0; i < 3; i++)
+			triangle.vertices[i] = indices ? indices[t * 3 + i] : (unsigned int)(t * 3 + i);
+		const float* p0 = (const float*)(vertexData + triangle.vertices[0] * stride);
+		const float* p1 = (const float*)(vertexData + triangle.vertices[1] * stride);
+		const float* p2 = (const float*)(vertexData + triangle.vertices[2] * stride);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			triangle.box.low[axis] = min(p0[axis], min(p1[axis], p2[axis]));
+			triangle.box.high[axis] = max(p0[axis], max(p1[axis], p2[axis]));
+			triangle.center[axis] = (triangle.box.low[axis] + triangle.box.high[axis]) * 0.5f;
+		}
+		triangle.box.low[3] = triangle.box.high[3] = 0;
+		grow(box, triangle.box);
+	}
+
+	// built in the scratch array, which grows to the largest chunk once, then copied at its exact size
+	nodes.clear();
+	nodes.push_back(Node());
+	buildNode(nodes, triangles.data(), 0, 0, (unsigned int)triangleCount, 0, box);
+	m_nodes.assign(nodes.begin(), nodes.end());
+	m_indices.resize(triangleCount * 3);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int i = 0; i < 3; i++)
+			m_indices[t * 3 + i] = triangles[t].vertices[i];
+	}
+	m_nodes.shrink_to_fit();
+	m_indices.shrink_to_fit();
+}
+
+void TerrainBvh::buildNode(std::vector<Node>& nodes, BuildTriangle* triangles, unsigned int node, unsigned int first, unsigned int count, int depth, const Bounds& box)
+{
+	nodes[node].boxMin = float3(box.low[0], box.low[1], box.low[2]);
+	nodes[node].boxMax = float3(box.high[0], box.high[1], box.high[2]);
+	auto makeLeaf = [&]()
+	{
+		nodes[node].offset = first;
+		nodes[node].count = (unsigned short)count;
+		nodes[node].axis = 0;
+	};
+	if (count <= s_maxLeafSize || depth >= s_maxDepth)
+	{
+		makeLeaf();
+		return;
+	}
+
+	// split across the node's longest side
+	int axis = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if (box.high[i] - box.low[i] > box.high[axis] - box.low[axis])
+			axis = i;
+	}
+
+	unsigned int leftCount = 0;
+	Bounds childBox[2];
+	if (depth < s_sahDepth)
+	{
+		// Bin the triangle centers in one pass, then sweep the bins from both sides for the cheapest split.
+		// Cost is the surface area heuristic, a child's half area times its triangles
+		struct Bin {
+			Bounds box;
+			unsigned int count;
+		};
+		Bin bins[s_bins];
+		for (int b = 0; b < s_bins; b++)
+		{
+			setEmpty(bins[b].box);
+			bins[b].count = 0;
+		}
+		float low = box.low[axis];
+		float toBin = s_bins / max(box.high[axis] - low, 1e-30f);
+		auto getBin = [&](const BuildTriangle& triangle) { return Clamp((int)((triangle.center[axis] - low) * toBin), 0, s_bins - 1); };
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			Bin& bin = bins[getBin(triangles[i])];
+			grow(bin.box, triangles[i].box);
+			bin.count++;
+		}
+
+		// the cost of what is right of every split, then the left side while sweeping back. Only the best split's boxes are kept
+		float rightCost[s_bins];
+		Bounds side;
+		setEmpty(side);
+		unsigned int sideCount = 0;
+		for (int b = s_bins - 1; b > 0; b--)
+		{
+			grow(side, bins[b].box);
+			sideCount += bins[b].count;
+			rightCost[b] = getHalfArea(side) * sideCount;
+		}
+		float bestCost = s_huge;
+		int bestSplit = -1;	// bins [0, bestSplit] go left
+		setEmpty(side);
+		sideCount = 0;
+		for (int b = 0; b < s_bins - 1; b++)
+		{
+			grow(side, bins[b].box);
+			sideCount += bins[b].count;
+			if (sideCount == 0 || sideCount == count)
+				continue;
+			float cost = getHalfArea(side) * sideCount + rightCost[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+				childBox[0] = side;
+			}
+		}
+		if (bestSplit >= 0)
+		{
+			setEmpty(childBox[1]);
+			for (int b = bestSplit + 1; b < s_bins; b++)
+				grow(childBox[1], bins[b].box);
+			BuildTriangle* middle = std::partition(triangles + first, triangles + first + count, [&](const BuildTriangle& triangle) { return getBin(triangle) <= bestSplit; });
+			leftCount = (unsigned int)(middle - (triangles + first));
+		}
+	}
+	if (leftCount == 0)
+	{
+		// deep, or the centers are too close to bin apart. Half the triangles
+		leftCount = count / 2;
+		std::nth_element(triangles + first, triangles + first + leftCount, triangles + first + count,
+			[axis](const BuildTriangle& a, const BuildTriangle& b) { return a.center[axis] < b.center[axis]; });
+		for (int child = 0; child < 2; child++)
+		{
+			setEmpty(childBox[child]);
+			unsigned int begin = child == 0 ? first : first + leftCount;
+			unsigned int end = child == 0 ? first + leftCount : first + count;
+			for (unsigned int i = begin; i < end; i++)
+				grow(childBox[child], triangles[i].box);
+		}
+	}
+
+	unsigned int left = (unsigned int)nodes.size();
+	nodes.push_back(Node());
+	buildNode(nodes, triangles, left, first, leftCount, depth + 1, childBox[0]);
+	unsigned int right = (unsigned int)nodes.size();
+	nodes.push_back(Node());
+	buildNode(nodes, triangles, right, first + leftCount, count - leftCount, depth + 1, childBox[1]);
+	nodes[node].offset = right;
+	nodes[node].count = 0;
+	nodes[node].axis = (unsigned short)axis;
+}
+
+void TerrainBvh::clear()
+{
+	m_nodes.clear();
+	m_nodes.shrink_to_fit();
+	m_indices.clear();
+	m_indices.shrink_to_fit();
+}
+
+size_t TerrainBvh::getMemorySize() const
+{
+	return m_nodes.capacity() * sizeof(Node) + m_indices.capacity() * sizeof(unsigned int);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+
+/*
+Bounding volume hierarchy of the triangles of a chunk for raycasts, the other choice to TerrainOctree<Triangle>.
+Triangles are three indices into the chunk's vertex positions instead of copies of their vertices.
+Built top down with binned SAH, every split bins its triangles in one pass over them. Nodes are 32 bytes in one array,
+depth first: the left child of an inner node follows it, the right child is at its offset. The triangles of a leaf are contiguous.
+*/
+class TerrainBvh
+{
+public:
+	struct Node {
+		float3 boxMin;
+		float3 boxMax;
+		unsigned int offset;	// first triangle of a leaf, right child of an inner node
+		unsigned short count;	// triangles of a leaf, 0 for an inner node
+		unsigned short axis;	// an inner node's split axis, the child on the low side is the left one
+	};
+
+private:
+	static const int s_bins = 8;
+	static const int s_maxLeafSize = 8;	// larger nodes are split
+	static const int s_sahDepth = 32;	// deeper nodes split at the median, which bounds the depth by the triangle count
+	static const int s_maxDepth = 64;
+
+	// Box while building, indexed by axis. Empty when low > high. Four floats a side, so growing a box is one vector min and max
+	struct Bounds {
+		alignas(16) float low[4];
+		alignas(16) float high[4];
+	};
+	struct BuildTriangle {
+		Bounds box;
+		float center[3];
+		unsigned int vertices[3];
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<unsigned int> m_indices;	// three vertex indices per triangle, in leaf order
+
+	// Makes node 'node' of triangles [first, first + count[ and the nodes below it, the parent passes their box
+	static void buildNode(std::vector<Node>& nodes, BuildTriangle* triangles, unsigned int node, unsigned int first, unsigned int count, int depth, const Bounds& box);
+
+public:
+	/*
+	Builds the tree of 'triangleCount' triangles. Vertex i is at 'positions' + i * stride bytes, triangle t is vertices
+	indices[t * 3] to indices[t * 3 + 2], or vertices t * 3 to t * 3 + 2 without indices.
+	*/
+	void build(const float3* positions, size_t stride, const unsigned int* indices, size_t triangleCount);
+	void clear();
+
+	bool empty() const { return m_nodes.empty(); }
+	size_t size() const { return m_indices.size() / 3; }
+	size_t getNodeCount() const { return m_nodes.size(); }
+	size_t getMemorySize() const;
+	// The vertex indices of the triangles, triangle i of visitNodes' range is getIndices()[i * 3] to getIndices()[i * 3 + 2]
+	const unsigned int* getIndices() const { return m_indices.data(); }
+
+	// Calls visit(first, count, mask) with the triangles of every leaf for which test(boxMin, boxMax, parentMask) gives a mask
+	// other than 0, the nearer child first along 'direction'. The nodes below a node get its mask, the root gets 'mask',
+	// as TerrainOctree::visitNodes
+	template<typename Test, typename Visit>
+	void visitNodes(float3 direction, int mask, Test test, Visit visit) const;
+};
+
+template<typename Test, typename Visit>
+void TerrainBvh::visitNodes(float3 direction, int mask, Test test, Visit visit) const
+{
+	if (m_nodes.empty())
+		return;
+	const bool negative[3] = { direction.x < 0, direction.y < 0, direction.z < 0 };
+	struct Entry {
+		unsigned int node;
+		int mask;
+	};
+	// a node pushes its two children and pops itself, so the stack never holds more than the depth plus one
+	Entry stack[s_maxDepth + 1];
+	int size = 0;
+	stack[size++] = { 0, mask };
+	while (size > 0)
+	{
+		Entry entry = stack[--size];
+		const Node& node = m_nodes[entry.node];
+		int nodeMask = test(node.boxMin, node.boxMax, entry.mask);
+		if (nodeMask == 0)
+			continue;
+		if (node.count > 0)
+		{
+			visit(node.offset, (unsigned int)node.count, nodeMask);
+			continue;
+		}
+		unsigned int nearChild = entry.node + 1;
+		unsigned int farChild = node.offset;
+		if (negative[node.axis])
+			std::swap(nearChild, farChild);
+		stack[size++] = { farChild, nodeMask };
+		stack[size++] = { nearChild, nodeMask };
+	}
+}
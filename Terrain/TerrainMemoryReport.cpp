@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "TerrainMemoryReport.h"
+
+namespace
+{
+	const float s_megabyte = 1024.f * 1024.f;
+}
+
+size_t TerrainMemoryReport::Chunk::getTotal() const
+{
+	size_t total = 0;
+	for (int category = 0; category < Memory_CategoryCount; category++)
+		total += bytes[category];
+	return total;
+}
+
+void TerrainMemoryReport::addToTerrain(const Chunk& chunk)
+{
+	for (int category = 0; category < Memory_CategoryCount; category++)
+		terrain[category] += chunk.bytes[category];
+}
+
+size_t TerrainMemoryReport::getTotal(Category category) const
+{
+	size_t total = terrain[category];
+	for (const Chunk& chunk : chunks)
+		total += chunk.bytes[category];
+	return total;
+}
+
+size_t TerrainMemoryReport::getTotal() const
+{
+	size_t total = 0;
+	for (int category = 0; category < Memory_CategoryCount; category++)
+		total += getTotal((Category)category);
+	return total;
+}
+
+size_t TerrainMemoryReport::getTriangleCount() const
+{
+	size_t triangles = 0;
+	for (const Chunk& chunk : chunks)
+		triangles += chunk.triangles;
+	return triangles;
+}
+
+const char* TerrainMemoryReport::getCategoryName(Category category)
+{
+	static const char* names[Memory_CategoryCount] = {
+		"voxel data", "density ranges", "chunk table", "chunk objects", "mesh data", "raycast trees", "chunk octrees",
+		"gpu buffers", "gpu buffer copies", "colliders", "pipeline instances", "decor", "other"
+	};
+	return category >= 0 && category < Memory_CategoryCount ? names[category] : "";
+}
+
+bool TerrainMemoryReport::isGpuMemory(Category category)
+{
+	return category == Memory_GpuBuffers;
+}
+
+void TerrainMemoryReport::print(FILE* file, size_t largestChunks) const
+{
+	size_t cpu = 0, gpu = 0;
+	for (int category = 0; category < Memory_CategoryCount; category++)
+		(isGpuMemory((Category)category) ? gpu : cpu) += getTotal((Category)category);
+	fprintf(file, "%-20s %10s %10s %12s\n", "memory", "MB", "terrain MB", "KB per chunk");
+	for (int category = 0; category < Memory_CategoryCount; category++)
+	{
+		size_t total = getTotal((Category)category);
+		if (total == 0)
+			continue;
+		fprintf(file, "%-20s %10.2f %10.2f %12.2f%s\n", getCategoryName((Category)category), total / s_megabyte, terrain[category] / s_megabyte,
+			chunks.empty() ? 0.f : (total - terrain[category]) / 1024.f / chunks.size(), isGpuMemory((Category)category) ? "  (gpu)" : "");
+	}
+	fprintf(file, "%-20s %10.2f cpu, %.2f gpu, %zu chunks, %zu triangles\n", "total", cpu / s_megabyte, gpu / s_megabyte, chunks.size(), getTriangleCount());
+
+	std::vector<const Chunk*> largest;
+	for (const Chunk& chunk : chunks)
+		largest.push_back(&chunk);
+	std::sort(largest.begin(), largest.end(), [](const Chunk* a, const Chunk* b) { return a->getTotal() > b->getTotal(); });
+	largest.resize(min(largest.size(), largestChunks));
+	if (!largest.empty())
+		fprintf(file, "\n%-12s %10s %10s %10s %10s\n", "chunk", "KB", "triangles", "mesh KB", "tree KB");
+	for (const Chunk* chunk : largest)
+	{
+		char id[32];
+		snprintf(id, sizeof(id), "%d %d %d", chunk->id.x, chunk->id.y, chunk->id.z);
+		fprintf(file, "%-12s %10.1f %10zu %10.1f %10.1f\n", id, chunk->getTotal() / 1024.f, chunk->triangles,
+			chunk->bytes[Memory_MeshData] / 1024.f, chunk->bytes[Memory_TriangleOctree] / 1024.f);
+	}
+}
+
+bool TerrainMemoryReport::write(const std::string& path) const
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n\t\"bytes\": %zu,\n\t\"triangles\": %zu,\n\t\"categories\": [\n", getTotal(), getTriangleCount());
+	for (int category = 0; category < Memory_CategoryCount; category++)
+	{
+		fprintf(file, "\t\t{ \"name\": \"%s\", \"gpu\": %s, \"bytes\": %zu, \"terrainBytes\": %zu }%s\n", getCategoryName((Category)category),
+			isGpuMemory((Category)category) ? "true" : "false", getTotal((Category)category), terrain[category], category + 1 < Memory_CategoryCount ? "," : "");
+	}
+	fprintf(file, "\t],\n\t\"chunks\": [\n");
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		const Chunk& chunk = chunks[i];
+		fprintf(file, "\t\t{ \"id\": [%d, %d, %d], \"triangles\": %zu, \"bytes\": [", chunk.id.x, chunk.id.y, chunk.id.z, chunk.triangles);
+		for (int category = 0; category < Memory_CategoryCount; category++)
+			fprintf(file, "%s%zu", category > 0 ? ", " : "", chunk.bytes[category]);
+		fprintf(file, "] }%s\n", i + 1 < chunks.size() ? "," : "");
+	}
+	fprintf(file, "\t]\n}\n");
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+What the terrain keeps in memory, per chunk and for the whole terrain, by category. Made by MarchingCubeTerrain::getMemoryReport,
+the game adds what only it owns (gpu buffers, colliders, pipeline instances, decor).
+Sizes are the capacity of the containers, what the allocator was asked for. Memory owned by libraries that don't report it,
+PhysX and the gpu driver, is estimated from what the terrain gave them.
+*/
+struct TerrainMemoryReport
+{
+	enum Category {
+		Memory_VoxelData,			// the terrain data's bricks
+		Memory_DensityRanges,		// min and max density of bricks and chunks, and their dirty lists
+		Memory_ChunkTable,			// the chunk table and the remesh queue
+		Memory_ChunkObjects,		// the chunk objects themselves
+		Memory_MeshData,			// vertices, indices and row starts kept on the cpu
+		Memory_TriangleOctree,		// every chunk's triangle BVH or octree for raycasts
+		Memory_ChunkOctree,			// the game's octree of the chunks, for culling
+		Memory_GpuBuffers,			// vertex and index buffers on the gpu
+		Memory_GpuBufferCopies,		// the cpu side of the gpu buffers, which keeps their capacity
+		Memory_Colliders,			// PhysX actors and their cooked triangle meshes
+		Memory_PipelineInstances,	// the chunks' draw state
+		Memory_Decor,				// decor instances
+		Memory_Other,				// structure points, raycast counters, async remesh chunks
+		Memory_CategoryCount
+	};
+
+	struct Chunk {
+		int3 id;
+		size_t triangles = 0;
+		size_t bytes[Memory_CategoryCount] = { 0 };
+
+		size_t getTotal() const;
+	};
+
+	size_t terrain[Memory_CategoryCount] = { 0 };	// not owned by one chunk
+	std::vector<Chunk> chunks;						// allocated chunks
+
+	// Adds a chunk's memory to the terrain's, for chunks that aren't in the chunk table
+	void addToTerrain(const Chunk& chunk);
+	// Terrain and every chunk
+	size_t getTotal(Category category) const;
+	size_t getTotal() const;
+	size_t getTriangleCount() const;
+
+	static const char* getCategoryName(Category category);
+	static bool isGpuMemory(Category category);
+
+	// Totals by category, then the chunks using the most memory
+	void print(FILE* file, size_t largestChunks = 8) const;
+	// Totals and every chunk as json, returns false if the file can't be written
+	bool write(const std::string& path) const;
+};
@@ -0,0 +1,249 @@
+#pragma once
+#include <vector>
+
+/*
+Ray culling octree of the terrain, independent of the engine's culling trees.
+Holds the triangles of a chunk and the chunks of the terrain for raycasts.
+Elements are stored in the deepest node whose box fully contains them, nodes are a complete tree
+of 'depth' levels below the root. Elements are added, then finish() sorts them into one array so
+every node's elements are contiguous. Adding after finish() needs a new initialize.
+*/
+template<typename T>
+class TerrainOctree
+{
+private:
+	struct Pending
+	{
+		unsigned int node;
+		T element;
+	};
+	float3 m_boxMin;
+	float3 m_boxMax;
+	int m_depth = 0;
+	std::vector<unsigned int> m_levelStart;		// first node of every level
+	std::vector<unsigned int> m_nodeStart;		// first element of every node, plus the element count
+	std::vector<unsigned int> m_subtreeCount;	// elements in the node and every node below it
+	std::vector<T> m_elements;
+	std::vector<Pending> m_pending;
+
+	// Node at 'level' containing cell (x, y, z) of that level's grid
+	unsigned int getNode(int level, int x, int y, int z) const
+	{
+		int side = 1 << level;
+		return m_levelStart[level] + x + y * side + z * side * side;
+	}
+	template<typename Test, typename Visit>
+	void visitNode(int level, int x, int y, int z, int nearChild, int mask, Test& test, Visit& visit) const;
+
+public:
+	// The box is given by its min and max corners, depth is the number of levels below the root
+	void initialize(float3 boxMin, float3 boxMax, int depth, size_t capacity = 0);
+	void add(const T& element, float3 elementMin, float3 elementMax);
+	void finish();
+	void clear();
+
+	size_t size() const;
+	size_t getMemorySize() const;
+	// Adds every element in a node the ray passes within 'distance', nearest node first is not guaranteed
+	void cullElements(float3 rayPosition, float3 rayDirection, float distance, std::vector<const T*>& elements) const;
+	// Calls visit(element) for the elements of every node the ray passes within 'distance', without allocating.
+	// Children are visited nearest first, visit may shorten 'distance' on a hit and nodes past it are skipped
+	template<typename Visit>
+	void visitElements(float3 rayPosition, float3 rayDirection, float& distance, Visit visit) const;
+	// Calls visit(elements, count, mask) with the elements of every node for which test(boxMin, boxMax, parentMask) gives a mask
+	// other than 0, children nearest first along 'direction'. The nodes below a node get its mask, the root gets 'mask'.
+	// For rays tested together, a mask bit per ray that passes the node
+	template<typename Test, typename Visit>
+	void visitNodes(float3 direction, int mask, Test test, Visit visit) const;
+};
+
+/*
+Slab test of a ray against a box. Returns true if the ray passes the box within [0, distance],
+'entry' is where it enters, 0 if it starts inside. inverseDirection is from inverseRayDirection.
+*/
+inline bool intersectRayBox(const float3& rayPosition, const float3& inverseDirection, float distance, const float3& boxMin, const float3& boxMax, float& entry)
+{
+	float t0x = (boxMin.x - rayPosition.x) * inverseDirection.x, t1x = (boxMax.x - rayPosition.x) * inverseDirection.x;
+	float t0y = (boxMin.y - rayPosition.y) * inverseDirection.y, t1y = (boxMax.y - rayPosition.y) * inverseDirection.y;
+	float t0z = (boxMin.z - rayPosition.z) * inverseDirection.z, t1z = (boxMax.z - rayPosition.z) * inverseDirection.z;
+	float tNear = 0.f;
+	float tFar = distance;
+	float nx = min(t0x, t1x), fx = max(t0x, t1x);
+	float ny = min(t0y, t1y), fy = max(t0y, t1y);
+	float nz = min(t0z, t1z), fz = max(t0z, t1z);
+	if (nx > tNear) tNear = nx;
+	if (ny > tNear) tNear = ny;
+	if (nz > tNear) tNear = nz;
+	if (fx < tFar) tFar = fx;
+	if (fy < tFar) tFar = fy;
+	if (fz < tFar) tFar = fz;
+	entry = tNear;
+	return tNear <= tFar;
+}
+
+// Distance along the ray to where it leaves the box, for a ray starting inside it
+inline float rayBoxExit(const float3& rayPosition, const float3& inverseDirection, const float3& boxMin, const float3& boxMax)
+{
+	float fx = max((boxMin.x - rayPosition.x) * inverseDirection.x, (boxMax.x - rayPosition.x) * inverseDirection.x);
+	float fy = max((boxMin.y - rayPosition.y) * inverseDirection.y, (boxMax.y - rayPosition.y) * inverseDirection.y);
+	float fz = max((boxMin.z - rayPosition.z) * inverseDirection.z, (boxMax.z - rayPosition.z) * inverseDirection.z);
+	return min(min(fx, fy), fz);
+}
+
+inline float3 inverseRayDirection(const float3& direction)
+{
+	const float huge = 1e30f;
+	return float3(direction.x != 0 ? 1.f / direction.x : huge, direction.y != 0 ? 1.f / direction.y : huge, direction.z != 0 ? 1.f / direction.z : huge);
+}
+
+template<typename T>
+void TerrainOctree<T>::initialize(float3 boxMin, float3 boxMax, int depth, size_t capacity)
+{
+	m_boxMin = boxMin;
+	m_boxMax = boxMax;
+	m_depth = max(depth, 0);
+	m_levelStart.resize(m_depth + 2);
+	unsigned int nodes = 0;
+	for (int level = 0; level <= m_depth; level++)
+	{
+		m_levelStart[level] = nodes;
+		nodes += 1u << (3 * level);
+	}
+	m_levelStart[m_depth + 1] = nodes;
+	m_nodeStart.assign(nodes + 1, 0);
+	m_subtreeCount.assign(nodes, 0);
+	m_elements.clear();
+	m_pending.clear();
+	m_pending.reserve(capacity);
+}
+
+template<typename T>
+void TerrainOctree<T>::add(const T& element, float3 elementMin, float3 elementMax)
+{
+	// cells of the deepest level the element's box touches, clamped to the tree.
+	// A box ending exactly on a cell border stays in the cell before it, so a chunk fits its own node
+	int side = 1 << m_depth;
+	float3 toCell = float3((float)side, (float)side, (float)side) / (m_boxMax - m_boxMin);
+	float3 cellMin = (elementMin - m_boxMin) * toCell;
+	float3 cellMax = (elementMax - m_boxMin) * toCell;
+	int3 low(Clamp((int)floorf(cellMin.x), 0, side - 1), Clamp((int)floorf(cellMin.y), 0, side - 1), Clamp((int)floorf(cellMin.z), 0, side - 1));
+	int3 high(Clamp((int)ceilf(cellMax.x) - 1, low.x, side - 1), Clamp((int)ceilf(cellMax.y) - 1, low.y, side - 1), Clamp((int)ceilf(cellMax.z) - 1, low.z, side - 1));
+
+	// go up until the box is inside one cell
+	int level = m_depth;
+	while (level > 0 && low != high)
+	{
+		low = int3(low.x >> 1, low.y >> 1, low.z >> 1);
+		high = int3(high.x >> 1, high.y >> 1, high.z >> 1);
+		level--;
+	}
+	m_pending.push_back({ getNode(level, low.x, low.y, low.z), element });
+}
+
+template<typename T>
+void TerrainOctree<T>::finish()
+{
+	// counting sort of the elements by node
+	size_t nodeCount = m_subtreeCount.size();
+	std::fill(m_nodeStart.begin(), m_nodeStart.end(), 0);
+	for (size_t i = 0; i < m_pending.size(); i++)
+		m_nodeStart[m_pending[i].node + 1]++;
+	for (size_t i = 0; i < nodeCount; i++)
+	{
+		m_subtreeCount[i] = m_nodeStart[i + 1];
+		m_nodeStart[i + 1] += m_nodeStart[i];
+	}
+	std::vector<unsigned int> next(m_nodeStart.begin(), m_nodeStart.end() - 1);
+	m_elements.clear();
+	m_elements.resize(m_pending.size());
+	for (size_t i = 0; i < m_pending.size(); i++)
+		m_elements[next[m_pending[i].node]++] = m_pending[i].element;
+	m_pending.clear();
+	m_pending.shrink_to_fit();
+
+	// sum the subtrees bottom up, so empty branches are skipped when culling
+	for (int level = m_depth; level > 0; level--)
+	{
+		int side = 1 << level;
+		for (int z = 0; z < side; z++)
+			for (int y = 0; y < side; y++)
+				for (int x = 0; x < side; x++)
+					m_subtreeCount[getNode(level - 1, x >> 1, y >> 1, z >> 1)] += m_subtreeCount[getNode(level, x, y, z)];
+	}
+}
+
+template<typename T>
+void TerrainOctree<T>::clear()
+{
+	initialize(m_boxMin, m_boxMax, m_depth);
+	m_elements.shrink_to_fit();
+}
+
+template<typename T>
+size_t TerrainOctree<T>::size() const
+{
+	return m_elements.size();
+}
+
+template<typename T>
+size_t TerrainOctree<T>::getMemorySize() const
+{
+	return m_elements.capacity() * sizeof(T) + (m_nodeStart.capacity() + m_subtreeCount.capacity() + m_levelStart.capacity()) * sizeof(unsigned int);
+}
+
+template<typename T>
+void TerrainOctree<T>::cullElements(float3 rayPosition, float3 rayDirection, float distance, std::vector<const T*>& elements) const
+{
+	visitElements(rayPosition, rayDirection, distance, [&](const T& element) { elements.push_back(&element); });
+}
+
+template<typename T>
+template<typename Visit>
+void TerrainOctree<T>::visitElements(float3 rayPosition, float3 rayDirection, float& distance, Visit visit) const
+{
+	float3 inverseDirection = inverseRayDirection(rayDirection);
+	visitNodes(rayDirection, 1, [&](const float3& boxMin, const float3& boxMax, int)
+	{
+		float entry;
+		return intersectRayBox(rayPosition, inverseDirection, distance, boxMin, boxMax, entry) ? 1 : 0;
+	},
+	[&](const T* elements, unsigned int count, int)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			visit(elements[i]);
+	});
+}
+
+template<typename T>
+template<typename Test, typename Visit>
+void TerrainOctree<T>::visitNodes(float3 direction, int mask, Test test, Visit visit) const
+{
+	if (m_elements.empty())
+		return;
+	// the child on the side the ray comes from, the others follow in an order that never visits a child before one in front of it
+	int nearChild = (direction.x < 0 ? 1 : 0) | (direction.y < 0 ? 2 : 0) | (direction.z < 0 ? 4 : 0);
+	visitNode(0, 0, 0, 0, nearChild, mask, test, visit);
+}
+
+template<typename T>
+template<typename Test, typename Visit>
+void TerrainOctree<T>::visitNode(int level, int x, int y, int z, int nearChild, int mask, Test& test, Visit& visit) const
+{
+	unsigned int node = getNode(level, x, y, z);
+	if (m_subtreeCount[node] == 0)
+		return;
+	float3 cellSize = (m_boxMax - m_boxMin) / (float)(1 << level);
+	float3 cellMin = m_boxMin + float3((float)x, (float)y, (float)z) * cellSize;
+	mask = test(cellMin, cellMin + cellSize, mask);
+	if (mask == 0)
+		return;
+	if (m_nodeStart[node + 1] > m_nodeStart[node])
+		visit(&m_elements[m_nodeStart[node]], m_nodeStart[node + 1] - m_nodeStart[node], mask);
+	if (level == m_depth)
+		return;
+	for (int order = 0; order < 8; order++)
+	{
+		int child = order ^ nearChild;
+		visitNode(level + 1, x * 2 + (child & 1), y * 2 + ((child >> 1) & 1), z * 2 + (child >> 2), nearChild, mask, test, visit);
+	}
+}
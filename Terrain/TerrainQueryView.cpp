@@ -0,0 +1,293 @@
+#include "pch.h"
+#include "TerrainQueryView.h"
+#include <algorithm>
+
+// The chunks a ray passes, in order. A 3D DDA over the chunk grid in chunk space, where a chunk is a unit.
+// The ray keeps its parameter, so distances along it stay in local space
+struct ChunkWalk {
+	int3 cubeIdx;
+	int3 cubeStep;
+	float3 cubeExit;	// where the ray leaves the chunk along every axis
+	float3 cubeDelta;
+	float tEnd;
+	int nrCubes;
+
+	// Returns false if the ray misses the grid within 'distance'
+	bool start(float3 rayPosition, float3 rayDirection, float distance, int chunks)
+	{
+		nrCubes = chunks;
+		float3 origin = rayPosition * (float)nrCubes;
+		float3 inverseDirection = inverseRayDirection(rayDirection * (float)nrCubes);
+		float3 gridMax((float)nrCubes, (float)nrCubes, (float)nrCubes);
+		float t;
+		if (!intersectRayBox(origin, inverseDirection, distance, float3(0, 0, 0), gridMax, t))
+			return false;
+		tEnd = min(distance, rayBoxExit(origin, inverseDirection, float3(0, 0, 0), gridMax));
+
+		float3 entry = origin + rayDirection * (float)nrCubes * t;
+		cubeIdx = int3(Clamp((int)floorf(entry.x), 0, nrCubes - 1), Clamp((int)floorf(entry.y), 0, nrCubes - 1), Clamp((int)floorf(entry.z), 0, nrCubes - 1));
+		cubeStep = int3(rayDirection.x < 0 ? -1 : 1, rayDirection.y < 0 ? -1 : 1, rayDirection.z < 0 ? -1 : 1);
+		float3 next(cubeStep.x > 0 ? cubeIdx.x + 1.f : (float)cubeIdx.x, cubeStep.y > 0 ? cubeIdx.y + 1.f : (float)cubeIdx.y, cubeStep.z > 0 ? cubeIdx.z + 1.f : (float)cubeIdx.z);
+		cubeExit = (next - origin) * inverseDirection;
+		cubeDelta = float3(fabsf(inverseDirection.x), fabsf(inverseDirection.y), fabsf(inverseDirection.z));
+		return true;
+	}
+
+	// Moves to the next chunk, returns false once the ray ends or leaves the grid
+	bool next()
+	{
+		if (cubeExit.x <= cubeExit.y && cubeExit.x <= cubeExit.z)
+		{
+			if (cubeExit.x > tEnd)
+				return false;
+			cubeIdx.x += cubeStep.x;
+			cubeExit.x += cubeDelta.x;
+		}
+		else if (cubeExit.y <= cubeExit.z)
+		{
+			if (cubeExit.y > tEnd)
+				return false;
+			cubeIdx.y += cubeStep.y;
+			cubeExit.y += cubeDelta.y;
+		}
+		else
+		{
+			if (cubeExit.z > tEnd)
+				return false;
+			cubeIdx.z += cubeStep.z;
+			cubeExit.z += cubeDelta.z;
+		}
+		return cubeIdx.x >= 0 && cubeIdx.x < nrCubes && cubeIdx.y >= 0 && cubeIdx.y < nrCubes && cubeIdx.z >= 0 && cubeIdx.z < nrCubes;
+	}
+};
+
+int TerrainQueryView::getCubeIndex(int3 cubeIdx) const
+{
+	return cubeIdx.x + cubeIdx.y * m_nrCubes + cubeIdx.z * m_nrCubes * m_nrCubes;
+}
+
+unsigned long long TerrainQueryView::getEpoch() const
+{
+	return m_epoch;
+}
+
+int TerrainQueryView::getNrCubes() const
+{
+	return m_nrCubes;
+}
+
+int3 TerrainQueryView::getDataSize() const
+{
+	return m_dataSize;
+}
+
+bool TerrainQueryView::raycastChunks(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal, TerrainRaycastStats::Ray& ray) const
+{
+	ChunkWalk walk;
+	if (m_chunks.empty() || !walk.start(rayPosition, rayDirection, distance, m_nrCubes))
+		return false;
+
+	// chunks in the order the ray passes them, a chunk's triangles stay within its cell so the first hit is the nearest
+	size_t triTests = 0;
+	do
+	{
+		ray.cubesCulled++;
+		const MarchingCubeMesh::RaycastMesh* cube = m_chunks[getCubeIndex(walk.cubeIdx)].get();
+		if (cube)
+		{
+			ray.cubesTested++;
+			float cubeDistance = distance;
+			if (cube->raycast(rayPosition, rayDirection, cubeDistance, intersectionPosition, intersectionNormal, triTests))
+			{
+				distance = cubeDistance;
+				ray.hit = true;
+				break;
+			}
+		}
+	} while (walk.next());
+	ray.trianglesTested = triTests;
+	return ray.hit;
+}
+
+bool TerrainQueryView::raycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal) const
+{
+	if (rayDirection.Length() < 0.00001f || distance < 0.00001f)
+		return false;
+	TerrainRaycastStats::Ray ray(*m_raycastStats);
+	return raycastChunks(rayPosition, rayDirection, distance, intersectionPosition, intersectionNormal, ray);
+}
+
+void TerrainQueryView::sortRays(size_t count, const float3* rayPositions, const float3* rayDirections, std::vector<unsigned int>& order) const
+{
+	// the rays of a packet then share chunks and tree nodes
+	std::vector<unsigned long long> keys(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		float3 start = rayPositions[i] * (float)m_nrCubes;
+		int3 cubeIdx(Clamp((int)floorf(start.x), 0, m_nrCubes - 1), Clamp((int)floorf(start.y), 0, m_nrCubes - 1), Clamp((int)floorf(start.z), 0, m_nrCubes - 1));
+		int octant = (rayDirections[i].x < 0 ? 1 : 0) | (rayDirections[i].y < 0 ? 2 : 0) | (rayDirections[i].z < 0 ? 4 : 0);
+		keys[i] = ((unsigned long long)(getCubeIndex(cubeIdx) * 8 + octant) << 32) | i;
+	}
+	std::sort(keys.begin(), keys.end());
+	order.resize(count);
+	for (size_t i = 0; i < count; i++)
+		order[i] = (unsigned int)keys[i];
+}
+
+void TerrainQueryView::raycastPackets(const unsigned int* order, size_t count, const float3* rayPositions, const float3* rayDirections, const float* distances, RayHit* hits, RaycastCounters& counters) const
+{
+	const int packetSize = MarchingCubeMesh::s_packetSize;
+	for (size_t first = 0; first < count; first += packetSize)
+	{
+		MarchingCubeMesh::RayPacket packet;
+		ChunkWalk walks[packetSize];
+		// Walks the lane on to the next chunk with triangles, returns false once the ray ends or leaves the grid
+		auto findCube = [&](ChunkWalk& walk)
+		{
+			do
+			{
+				counters.cubesCulled++;
+				if (m_chunks[getCubeIndex(walk.cubeIdx)])
+					return true;
+			} while (walk.next());
+			return false;
+		};
+		int active = 0;	// lanes still walking their chunks
+		int lanes = (int)min(count - first, (size_t)packetSize);
+		for (int lane = 0; lane < lanes; lane++)
+		{
+			unsigned int i = order[first + lane];
+			hits[i].hit = false;
+			hits[i].distance = distances[i];
+			if (rayDirections[i].Length() < 0.00001f || distances[i] < 0.00001f)
+				continue;
+			packet.positions[lane] = rayPositions[i];
+			packet.directions[lane] = rayDirections[i];
+			packet.distances[lane] = distances[i];
+			if (walks[lane].start(rayPositions[i], rayDirections[i], distances[i], m_nrCubes) && findCube(walks[lane]))
+				active |= 1 << lane;
+		}
+
+		// Every ray visits its chunks in its own order, the rays in the chunk of the first one go along with it.
+		// A chunk's triangles stay within its cell, so a ray's first hit is its nearest
+		while (active)
+		{
+			int firstLane = 0;
+			while (!(active & (1 << firstLane)))
+				firstLane++;
+			int3 cubeIdx = walks[firstLane].cubeIdx;
+			int together = 0;
+			int togetherCount = 0;
+			for (int lane = firstLane; lane < lanes; lane++)
+			{
+				if ((active & (1 << lane)) && walks[lane].cubeIdx == cubeIdx)
+				{
+					together |= 1 << lane;
+					togetherCount++;
+				}
+			}
+			counters.cubesTested += togetherCount;
+
+			int hitLanes = 0;
+			const MarchingCubeMesh::RaycastMesh* cube = m_chunks[getCubeIndex(cubeIdx)].get();
+			if (togetherCount == 1)
+			{
+				// alone in the chunk, the packet's setup costs more than it saves
+				if (cube->raycast(packet.positions[firstLane], packet.directions[firstLane], packet.distances[firstLane],
+					packet.intersectionPositions[firstLane], packet.intersectionNormals[firstLane], counters.trianglesTested))
+					hitLanes = together;
+			}
+			else
+				hitLanes = cube->raycastPacket(packet, together, counters.trianglesTested);
+			for (int lane = firstLane; lane < lanes; lane++)
+			{
+				if (!(together & (1 << lane)))
+					continue;
+				if (hitLanes & (1 << lane))
+				{
+					RayHit& hit = hits[order[first + lane]];
+					hit.hit = true;
+					hit.distance = packet.distances[lane];
+					hit.position = packet.intersectionPositions[lane];
+					hit.normal = packet.intersectionNormals[lane];
+					counters.hits++;
+					active &= ~(1 << lane);
+				}
+				else if (!walks[lane].next() || !findCube(walks[lane]))
+					active &= ~(1 << lane);
+			}
+		}
+	}
+}
+
+void TerrainQueryView::raycastBatch_localSpace(size_t count, const float3* rayPositions, const float3* rayDirections, const float* distances, RayHit* hits) const
+{
+	if (count == 0)
+		return;
+	TerrainRaycastStats::Batch batch(*m_raycastStats);
+	batch.rays = count;
+	std::vector<unsigned int> order;
+	sortRays(count, rayPositions, rayDirections, order);
+	RaycastCounters counters;
+	raycastPackets(order.data(), count, rayPositions, rayDirections, distances, hits, counters);
+	batch.hits = counters.hits;
+	batch.cubesCulled = counters.cubesCulled;
+	batch.cubesTested = counters.cubesTested;
+	batch.trianglesTested = counters.trianglesTested;
+}
+
+float TerrainQueryView::getTerrainValue_dataSpace(float3 dataPos) const
+{
+	int x = (int)dataPos.x, y = (int)dataPos.y, z = (int)dataPos.z;
+	if (m_terrainData && 0 <= x && x < m_dataSize.x && 0 <= y && y < m_dataSize.y && 0 <= z && z < m_dataSize.z)
+		return m_terrainData->getDensity(x, y, z);
+	else
+		return 100;
+}
+
+bool TerrainQueryView::isInGround_dataSpace(float3 dataPos) const
+{
+	return getTerrainValue_dataSpace(dataPos) < m_surfaceValue;
+}
+
+float3 TerrainQueryView::getDataFieldFlow_dataSpace(float3 dataPos, float localGridStepSize) const
+{
+	if (!m_terrainData)
+		return float3(0, 0, 0);
+	// based on central difference ( df(x) = f(x+h)-f(x-h) )
+	// flow points to more air
+	const VoxelVolume& volume = *m_terrainData;
+	float h = localGridStepSize;
+	float3 flow;
+	flow.x = (float)((int)sampleDensity(volume, dataPos + float3(h, 0, 0)) - (int)sampleDensity(volume, dataPos - float3(h, 0, 0))) / 255;
+	flow.y = (float)((int)sampleDensity(volume, dataPos + float3(0, h, 0)) - (int)sampleDensity(volume, dataPos - float3(0, h, 0))) / 255;
+	flow.z = (float)((int)sampleDensity(volume, dataPos + float3(0, 0, h)) - (int)sampleDensity(volume, dataPos - float3(0, 0, h))) / 255;
+	return flow;
+}
+
+float TerrainQueryView::sampleDensity(const VoxelVolume& volume, float3 dataPos)
+{
+	int3 nodeIndex(dataPos.x, dataPos.y, dataPos.z);
+	float3 frac(dataPos.x - nodeIndex.x, dataPos.y - nodeIndex.y, dataPos.z - nodeIndex.z);
+	float edgeValue[2][2][2]; // [z][y][x], the order readBlock writes
+	visitVoxelVolume(volume, [&](const auto& typedVolume)
+	{
+		typedef typename std::decay_t<decltype(typedVolume)>::Voxel Voxel;
+		typename Voxel::Type cells[8];
+		typedVolume.readBlock(nodeIndex.x, nodeIndex.y, nodeIndex.z, 2, 2, 2, cells, Voxel::fromDensity(100));
+		for (int i = 0; i < 8; i++)
+			(&edgeValue[0][0][0])[i] = Voxel::toDensity(cells[i]);
+	});
+
+	// bottom plane
+	float botx0 = Lerp(edgeValue[0][0][0], edgeValue[0][0][1], frac.x);
+	float botx1 = Lerp(edgeValue[1][0][0], edgeValue[1][0][1], frac.x);
+	float botz = Lerp(botx0, botx1, frac.z);
+	// top plane
+	float topx0 = Lerp(edgeValue[0][1][0], edgeValue[0][1][1], frac.x);
+	float topx1 = Lerp(edgeValue[1][1][0], edgeValue[1][1][1], frac.x);
+	float topz = Lerp(topx0, topx1, frac.z);
+	// center
+	float midy = Lerp(botz, topz, frac.y);
+	return midy;
+}
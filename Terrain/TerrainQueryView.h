@@ -0,0 +1,76 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "MarchingCubeMesh.h"
+#include "TerrainRaycastStats.h"
+
+/*
+Read-only snapshot of the terrain for queries from other threads, AI, audio and gameplay jobs. MarchingCubeTerrain publishes a new
+view whenever chunk meshes changed, a reader takes the latest with acquireQueryView and keeps it for as long as it queries.
+The view shares the raycast meshes of its chunks, which are never changed once built, so remeshing neither blocks its readers
+nor changes what they read. A held view keeps the meshes it was published with, the epoch tells a newer view from an older one.
+The terrain data isn't copied, density queries read the live cells, which are atomic, and see edits as they are made, see DenseVolume and BrickVolume.
+Queries are in local space [0, 1] or data space [0, size] like those of MarchingCubeTerrain, which casts its own rays through the latest view.
+*/
+class TerrainQueryView
+{
+public:
+	// Result of a ray of raycastBatch_localSpace. Position and normal are only set when it hit
+	struct RayHit {
+		bool hit;
+		float distance;		// to the intersection, the ray's length if it missed
+		float3 position;
+		float3 normal;
+	};
+	// What the rays of a batch, or of a job of one, tested
+	struct RaycastCounters {
+		size_t hits = 0;
+		size_t cubesCulled = 0;
+		size_t cubesTested = 0;
+		size_t trianglesTested = 0;
+	};
+
+private:
+	friend class MarchingCubeTerrain;
+
+	unsigned long long m_epoch = 0;
+	int m_nrCubes = 0;
+	// Raycast mesh of every chunk, indexed as the chunk table. Null for chunks without triangles
+	std::vector<std::shared_ptr<const MarchingCubeMesh::RaycastMesh>> m_chunks;
+	std::shared_ptr<const VoxelVolume> m_terrainData;
+	int3 m_dataSize = int3(0, 0, 0);
+	float m_surfaceValue = 0;
+	std::shared_ptr<TerrainRaycastStats> m_raycastStats;	// the terrain's, which may be gone before the view
+
+	int getCubeIndex(int3 cubeIdx) const;
+	// Walks the chunk grid along the ray with a 3D DDA and raycasts the chunks with triangles in the order the ray passes them, stops at the first hit
+	bool raycastChunks(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal, TerrainRaycastStats::Ray& ray) const;
+	// The order to cast a batch's rays in: sorted by the chunk the ray starts in and the octant of its direction
+	void sortRays(size_t count, const float3* rayPositions, const float3* rayDirections, std::vector<unsigned int>& order) const;
+	// Casts rays order[0, count[ of a batch in packets, walking the chunks of all rays of a packet together
+	void raycastPackets(const unsigned int* order, size_t count, const float3* rayPositions, const float3* rayDirections, const float* distances, RayHit* hits, RaycastCounters& counters) const;
+
+public:
+	unsigned long long getEpoch() const;
+	int getNrCubes() const;
+	int3 getDataSize() const;
+
+	/*
+	Raycast against the chunk meshes of the view in local space, as MarchingCubeTerrain::longRaycast_localSpace. Counted in the terrain's raycast stats.
+	Returns true if ray collided with any triangles.
+	Parameter 'distance' defines the ray length and will also be overwritten by the rays collision distance.
+	Parameters 'intersectionPosition' and 'intersectionNormal' will be overwritten by the rays intersection point and normal of collision surface.
+	*/
+	bool raycast_localSpace(float3 rayPosition, float3 rayDirection, float& distance, float3& intersectionPosition, float3& intersectionNormal) const;
+	// Raycasts 'count' rays in packets as MarchingCubeTerrain::raycastBatch_localSpace, all on the calling thread
+	void raycastBatch_localSpace(size_t count, const float3* rayPositions, const float3* rayDirections, const float* distances, RayHit* hits) const;
+
+	// Density of the data cell containing the position, 100 outside the terrain
+	float getTerrainValue_dataSpace(float3 dataPos) const;
+	bool isInGround_dataSpace(float3 dataPos) const;
+	// Gets normal based on neighboring data cells, based on central difference
+	float3 getDataFieldFlow_dataSpace(float3 dataPos, float localGridStepSize = 1.f) const;
+
+	// Density interpolated between the data cells around the position, cells outside the terrain count as 100
+	static float sampleDensity(const VoxelVolume& volume, float3 dataPos);
+};
@@ -0,0 +1,271 @@
+#include "pch.h"
+#include "TerrainRaycastStats.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	std::mutex s_tagMutex;
+	std::string s_tagNames[TerrainRaycastStats::s_maxTags] = { "untagged" };
+	std::atomic<int> s_tagCount(1);
+	std::atomic<unsigned int> s_nextId(1);
+
+	thread_local int t_tag = 0;
+
+	// The block of the instance the thread counted in last, so the instance's list is only searched when that changes
+	struct ThreadCache {
+		unsigned int id = 0;
+		void* counters = nullptr;
+	};
+	thread_local ThreadCache t_cache;
+
+	inline int highestBit(unsigned long long value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	// Only the owning thread writes its counters, so a load and a store is enough and costs no locked instruction
+	inline void add(std::atomic<unsigned long long>& counter, unsigned long long value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+}
+
+TerrainRaycastStats::Tag::Tag(int tag) : m_previous(t_tag)
+{
+	t_tag = Clamp(tag, 0, s_maxTags - 1);
+}
+
+TerrainRaycastStats::Tag::~Tag()
+{
+	t_tag = m_previous;
+}
+
+TerrainRaycastStats::Ray::~Ray()
+{
+	if (m_stats)
+		m_stats->record(*this, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_begin).count());
+}
+
+TerrainRaycastStats::Batch::~Batch()
+{
+	if (m_stats)
+		m_stats->record(*this, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_begin).count());
+}
+
+TerrainRaycastStats::TerrainRaycastStats() : m_id(s_nextId++), m_enabled(false)
+{
+	reset();
+}
+
+TerrainRaycastStats::~TerrainRaycastStats()
+{
+}
+
+void TerrainRaycastStats::setEnabled(bool enabled)
+{
+	m_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+int TerrainRaycastStats::registerTag(const char* name)
+{
+	std::lock_guard<std::mutex> lock(s_tagMutex);
+	int count = s_tagCount;
+	for (int i = 0; i < count; i++)
+	{
+		if (s_tagNames[i] == name)
+			return i;
+	}
+	if (count == s_maxTags)
+		return s_maxTags - 1;
+	s_tagNames[count] = name;
+	s_tagCount = count + 1;
+	return count;
+}
+
+int TerrainRaycastStats::getTagCount()
+{
+	return s_tagCount;
+}
+
+const char* TerrainRaycastStats::getTagName(int tag)
+{
+	std::lock_guard<std::mutex> lock(s_tagMutex);
+	return tag >= 0 && tag < s_tagCount ? s_tagNames[tag].c_str() : "";
+}
+
+TerrainRaycastStats::ThreadCounters& TerrainRaycastStats::getThreadCounters()
+{
+	if (t_cache.id == m_id)
+		return *(ThreadCounters*)t_cache.counters;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::thread::id thread = std::this_thread::get_id();
+	ThreadCounters* counters = nullptr;
+	for (const std::unique_ptr<ThreadCounters>& threadCounters : m_threads)
+	{
+		if (threadCounters->thread == thread)
+			counters = threadCounters.get();
+	}
+	if (!counters)
+	{
+		m_threads.push_back(std::make_unique<ThreadCounters>());
+		counters = m_threads.back().get();
+		counters->thread = thread;
+	}
+	t_cache.id = m_id;
+	t_cache.counters = counters;
+	return *counters;
+}
+
+void TerrainRaycastStats::record(const Ray& ray, long long nanoseconds)
+{
+	CountersOf<std::atomic<unsigned long long>>& counters = getThreadCounters().tags[t_tag];
+	add(counters.rays, 1);
+	add(counters.hits, ray.hit ? 1 : 0);
+	add(counters.cubesCulled, ray.cubesCulled);
+	add(counters.cubesTested, ray.cubesTested);
+	add(counters.trianglesTested, ray.trianglesTested);
+	add(counters.nanoseconds, nanoseconds);
+	add(counters.histogram[getBucket(nanoseconds)], 1);
+}
+
+void TerrainRaycastStats::record(const Batch& batch, long long nanoseconds)
+{
+	if (batch.rays == 0)
+		return;
+	CountersOf<std::atomic<unsigned long long>>& counters = getThreadCounters().tags[t_tag];
+	add(counters.rays, batch.rays);
+	add(counters.hits, batch.hits);
+	add(counters.cubesCulled, batch.cubesCulled);
+	add(counters.cubesTested, batch.cubesTested);
+	add(counters.trianglesTested, batch.trianglesTested);
+	add(counters.nanoseconds, nanoseconds);
+	add(counters.histogram[getBucket(nanoseconds / (long long)batch.rays)], batch.rays);
+}
+
+int TerrainRaycastStats::getBucket(long long nanoseconds)
+{
+	if (nanoseconds < 4)
+		return 0;
+	// the octave, and the two bits below the highest one for the quarter
+	int exponent = highestBit((unsigned long long)nanoseconds);
+	int quarter = (int)(nanoseconds >> (exponent - 2)) & 3;
+	return min(exponent * 4 + quarter, s_buckets - 1);
+}
+
+float TerrainRaycastStats::getBucketValue(int bucket)
+{
+	return exp2f((bucket + 0.5f) / 4);
+}
+
+float TerrainRaycastStats::getPercentile(const unsigned long long histogram[s_buckets], size_t count, float percentile)
+{
+	if (count == 0)
+		return 0;
+	size_t rank = max((size_t)ceil(percentile / 100 * count), (size_t)1);
+	size_t seen = 0;
+	for (int bucket = 0; bucket < s_buckets; bucket++)
+	{
+		seen += histogram[bucket];
+		if (seen >= rank)
+			return getBucketValue(bucket);
+	}
+	return getBucketValue(s_buckets - 1);
+}
+
+void TerrainRaycastStats::collect(ThreadCounters& thread, long long frameNanoseconds[s_maxTags])
+{
+	for (int tag = 0; tag < s_maxTags; tag++)
+	{
+		CountersOf<std::atomic<unsigned long long>>& counters = thread.tags[tag];
+		Counters& seen = thread.seen[tag];
+		unsigned long long rays = counters.rays.load(std::memory_order_relaxed);
+		if (rays == seen.rays)
+			continue;
+		// a raycast finishing meanwhile may be partly counted, the rest is added next frame
+		Counters& total = m_total[tag];
+		auto collectCounter = [](std::atomic<unsigned long long>& counter, unsigned long long& seen, unsigned long long& total)
+		{
+			unsigned long long value = counter.load(std::memory_order_relaxed);
+			total += value - seen;
+			seen = value;
+		};
+		collectCounter(counters.rays, seen.rays, total.rays);
+		collectCounter(counters.hits, seen.hits, total.hits);
+		collectCounter(counters.cubesCulled, seen.cubesCulled, total.cubesCulled);
+		collectCounter(counters.cubesTested, seen.cubesTested, total.cubesTested);
+		collectCounter(counters.trianglesTested, seen.trianglesTested, total.trianglesTested);
+		unsigned long long nanoseconds = seen.nanoseconds;
+		collectCounter(counters.nanoseconds, seen.nanoseconds, total.nanoseconds);
+		if (frameNanoseconds)
+			frameNanoseconds[tag] += (long long)(seen.nanoseconds - nanoseconds);
+		for (int bucket = 0; bucket < s_buckets; bucket++)
+			collectCounter(counters.histogram[bucket], seen.histogram[bucket], total.histogram[bucket]);
+	}
+}
+
+void TerrainRaycastStats::endFrame()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	long long frameNanoseconds[s_maxTags] = { 0 };
+	for (const std::unique_ptr<ThreadCounters>& thread : m_threads)
+		collect(*thread, frameNanoseconds);
+	for (int tag = 0; tag < s_maxTags; tag++)
+		m_frameMilliseconds[tag][m_frames % s_frameHistory] = frameNanoseconds[tag] * 1e-6f;
+	m_frames++;
+}
+
+void TerrainRaycastStats::reset()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (const std::unique_ptr<ThreadCounters>& thread : m_threads)
+		collect(*thread, nullptr);	// what was counted so far is left out
+	memset(m_total, 0, sizeof(m_total));
+	memset(m_frameMilliseconds, 0, sizeof(m_frameMilliseconds));
+	m_frames = 0;
+}
+
+size_t TerrainRaycastStats::getMemorySize() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return sizeof(TerrainRaycastStats) + m_threads.size() * sizeof(ThreadCounters) + m_threads.capacity() * sizeof(std::unique_ptr<ThreadCounters>);
+}
+
+TerrainRaycastStats::Summary TerrainRaycastStats::getSummary(int tag) const
+{
+	Summary summary = { 0, 0, 0, 0, 0, 0, { 0, 0 }, { 0, 0 } };
+	if (tag < 0 || tag >= s_maxTags)
+		return summary;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const Counters& total = m_total[tag];
+	summary.frames = m_frames;
+	summary.rays = total.rays;
+	summary.hits = total.hits;
+	if (total.rays > 0)
+	{
+		summary.cubesCulledPerRay = (float)total.cubesCulled / total.rays;
+		summary.cubesTestedPerRay = (float)total.cubesTested / total.rays;
+		summary.trianglesPerRay = (float)total.trianglesTested / total.rays;
+		summary.rayMicroseconds[0] = getPercentile(total.histogram, total.rays, 50) * 1e-3f;
+		summary.rayMicroseconds[1] = getPercentile(total.histogram, total.rays, 99) * 1e-3f;
+	}
+
+	size_t frames = min(m_frames, (size_t)s_frameHistory);
+	if (frames > 0)
+	{
+		std::vector<float> sorted(m_frameMilliseconds[tag], m_frameMilliseconds[tag] + frames);
+		std::sort(sorted.begin(), sorted.end());
+		summary.frameMilliseconds[0] = sorted[max((size_t)ceil(0.5 * frames), (size_t)1) - 1];
+		summary.frameMilliseconds[1] = sorted[max((size_t)ceil(0.99 * frames), (size_t)1) - 1];
+	}
+	return summary;
+}
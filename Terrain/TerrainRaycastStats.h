@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Counters of the terrain's raycasts, per caller. A gameplay system tags the raycasts it casts with a Tag scope,
+untagged raycasts count as "untagged". Every thread counts in its own block without locking, endFrame adds what the blocks
+counted since the frame before once per frame.
+Queries cover the frames since reset: the time of single raycasts from a histogram, and the time a caller spent raycasting
+per frame over the latest s_frameHistory frames.
+Off until setEnabled, a raycast then costs one relaxed load of the flag and neither reads the clock nor touches the counters.
+*/
+class TerrainRaycastStats
+{
+public:
+	static const int s_maxTags = 32;
+	static const int s_frameHistory = 256;
+
+	// Makes the calling thread's raycasts count for a caller while it lives
+	class Tag
+	{
+	private:
+		int m_previous;
+	public:
+		Tag(int tag);
+		~Tag();
+		Tag(const Tag&) = delete;
+		Tag& operator=(const Tag&) = delete;
+	};
+
+	// Counts one raycast while it lives, if the stats are enabled. The raycast fills in what it tested and whether it hit
+	class Ray
+	{
+	private:
+		TerrainRaycastStats* m_stats;	// null while disabled
+		std::chrono::steady_clock::time_point m_begin;
+	public:
+		size_t cubesCulled = 0;		// chunks the ray passed in the chunk table
+		size_t cubesTested = 0;		// chunks whose triangles were tested
+		size_t trianglesTested = 0;
+		bool hit = false;
+
+		Ray(TerrainRaycastStats& stats) : m_stats(stats.isEnabled() ? &stats : nullptr)
+		{
+			if (m_stats)
+				m_begin = std::chrono::steady_clock::now();
+		}
+		~Ray();
+		Ray(const Ray&) = delete;
+		Ray& operator=(const Ray&) = delete;
+	};
+
+	// Counts the rays of a batch while it lives, as rays that each took the batch's time per ray, if the stats are enabled.
+	// The batch fills in its totals
+	class Batch
+	{
+	private:
+		TerrainRaycastStats* m_stats;	// null while disabled
+		std::chrono::steady_clock::time_point m_begin;
+	public:
+		size_t rays = 0;
+		size_t hits = 0;
+		size_t cubesCulled = 0;
+		size_t cubesTested = 0;
+		size_t trianglesTested = 0;
+
+		Batch(TerrainRaycastStats& stats) : m_stats(stats.isEnabled() ? &stats : nullptr)
+		{
+			if (m_stats)
+				m_begin = std::chrono::steady_clock::now();
+		}
+		~Batch();
+		Batch(const Batch&) = delete;
+		Batch& operator=(const Batch&) = delete;
+	};
+
+	struct Summary {
+		size_t frames;				// ended since reset
+		size_t rays;
+		size_t hits;
+		float cubesCulledPerRay;
+		float cubesTestedPerRay;
+		float trianglesPerRay;
+		float rayMicroseconds[2];	// p50, p99 of single raycasts
+		float frameMilliseconds[2];	// p50, p99 of the caller's raycast time per frame
+	};
+
+private:
+	static const int s_buckets = 128;	// quarter octaves of nanoseconds
+
+	template<typename T>
+	struct CountersOf {
+		T rays;
+		T hits;
+		T cubesCulled;
+		T cubesTested;
+		T trianglesTested;
+		T nanoseconds;
+		T histogram[s_buckets];
+	};
+	typedef CountersOf<unsigned long long> Counters;
+	// Counters of one thread. Only the thread writes them, the atomics let endFrame read them while it does
+	struct ThreadCounters {
+		std::thread::id thread;
+		CountersOf<std::atomic<unsigned long long>> tags[s_maxTags];
+		Counters seen[s_maxTags];	// what endFrame has added to the totals, only used by endFrame
+	};
+
+	unsigned int m_id;	// tells the thread's cached block of this instance from the one of an earlier instance
+	std::atomic<bool> m_enabled;
+	mutable std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadCounters>> m_threads;
+	Counters m_total[s_maxTags];						// frames ended since reset
+	float m_frameMilliseconds[s_maxTags][s_frameHistory];	// per frame raycast time, ring buffer
+	size_t m_frames = 0;
+
+	ThreadCounters& getThreadCounters();
+	void record(const Ray& ray, long long nanoseconds);
+	void record(const Batch& batch, long long nanoseconds);
+	static int getBucket(long long nanoseconds);
+	static float getBucketValue(int bucket);
+	static float getPercentile(const unsigned long long histogram[s_buckets], size_t count, float percentile);
+	// Adds what the thread counted since the latest call to the totals
+	void collect(ThreadCounters& thread, long long frameNanoseconds[s_maxTags]);
+
+public:
+	TerrainRaycastStats();
+	~TerrainRaycastStats();
+	TerrainRaycastStats(const TerrainRaycastStats&) = delete;
+	TerrainRaycastStats& operator=(const TerrainRaycastStats&) = delete;
+
+	// Returns the tag of a caller, the same name always gives the same tag. Tag 0 is "untagged", names past s_maxTags share the last tag
+	static int registerTag(const char* name);
+	static int getTagCount();
+	static const char* getTagName(int tag);
+
+	// Raycasts started while enabled are counted, the counts so far are kept while disabled
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+	// Adds the frame's raycasts to the totals, call once per frame from one thread
+	void endFrame();
+	void reset();
+	Summary getSummary(int tag) const;
+	// Bytes of the counters, which grow by a block per thread that has cast a ray
+	size_t getMemorySize() const;
+};
@@ -0,0 +1,245 @@
+#include "pch.h"
+#include "TerrainRecorder.h"
+
+namespace
+{
+	const char s_magic[4] = { 'T', 'R', 'E', 'C' };
+	const unsigned int s_version = 2;	// 2 added Event_Densities, version 1 recordings still load
+	const size_t s_flushSize = 1 << 16;
+
+	// Which fields of an event its type writes
+	struct EventLayout {
+		const char* name;
+		bool position;
+		bool direction;
+		int sizes;
+		int values;
+	};
+	const EventLayout s_layouts[TerrainRecorder::Event_TypeCount] = {
+		{ "init",			true,	false,	1, 2 },
+		{ "generate",		false,	false,	0, 2 },
+		{ "destroySphere",	true,	false,	1, 0 },
+		{ "damageSphere",	true,	false,	2, 0 },
+		{ "damageCylinder",	true,	false,	3, 0 },
+		{ "remeshAll",		false,	false,	0, 0 },
+		{ "remeshQueued",	false,	false,	1, 1 },
+		{ "longRaycast",	true,	true,	1, 1 },
+		{ "shortRaycast",	true,	true,	1, 1 },
+		{ "raycast",		true,	true,	1, 1 },
+		{ "findDecor",		false,	false,	0, 1 },
+		{ "frame",			false,	false,	1, 0 },
+		{ "densityRaycast",	true,	true,	1, 1 },
+		{ "densities",		true,	false,	0, 0 },
+	};
+
+	template<typename T>
+	void append(std::vector<char>& buffer, const T& value)
+	{
+		const char* bytes = (const char*)&value;
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	template<typename T>
+	bool read(std::ifstream& file, T& value)
+	{
+		return (bool)file.read((char*)&value, sizeof(T));
+	}
+
+	// An event of the type with every field zero, the record functions fill in the fields the type uses
+	TerrainRecorder::Event makeEvent(TerrainRecorder::EventType type)
+	{
+		TerrainRecorder::Event event = { type, 0.0, float3(0, 0, 0), float3(0, 0, 0), { 0, 0, 0 }, { 0, 0 }, nullptr };
+		return event;
+	}
+}
+
+TerrainRecorder::~TerrainRecorder()
+{
+	stop();
+}
+
+bool TerrainRecorder::start(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	close();
+	m_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_file)
+		return false;
+	m_file.write(s_magic, sizeof(s_magic));
+	m_file.write((const char*)&s_version, sizeof(s_version));
+	m_buffer.clear();
+	m_buffer.reserve(s_flushSize + 64);
+	m_start = std::chrono::steady_clock::now();
+	m_lastMicroseconds = 0;
+	return true;
+}
+
+void TerrainRecorder::stop()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	close();
+}
+
+bool TerrainRecorder::isRecording() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_file.is_open();
+}
+
+void TerrainRecorder::close()
+{
+	if (!m_file.is_open())
+		return;
+	flush();
+	m_file.close();
+}
+
+void TerrainRecorder::flush()
+{
+	m_file.write(m_buffer.data(), m_buffer.size());
+	m_buffer.clear();
+}
+
+void TerrainRecorder::record(Event event)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_file.is_open())
+		return;
+	long long microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+	unsigned int delta = (unsigned int)min(microseconds - m_lastMicroseconds, 0xFFFFFFFFll);
+	m_lastMicroseconds = microseconds;
+
+	const EventLayout& layout = s_layouts[event.type];
+	append(m_buffer, event.type);
+	append(m_buffer, delta);
+	if (layout.position)
+		append(m_buffer, event.position);
+	if (layout.direction)
+		append(m_buffer, event.direction);
+	for (int i = 0; i < layout.sizes; i++)
+		append(m_buffer, event.sizes[i]);
+	for (int i = 0; i < layout.values; i++)
+		append(m_buffer, event.values[i]);
+	if (event.type == Event_Densities)
+		m_buffer.insert(m_buffer.end(), event.densities->begin(), event.densities->end());
+	if (m_buffer.size() >= s_flushSize)
+		flush();
+}
+
+void TerrainRecorder::recordInit(int3 size, float scale, int nrCubes, VoxelFormat format)
+{
+	Event event = makeEvent(Event_Init);
+	event.position = float3((float)size.x, (float)size.y, (float)size.z);
+	event.sizes[0] = scale;
+	event.values[0] = (unsigned int)nrCubes;
+	event.values[1] = (unsigned int)format;
+	record(event);
+}
+
+void TerrainRecorder::recordGenerate(unsigned int seed, int nrOfPlayers)
+{
+	Event event = makeEvent(Event_Generate);
+	event.values[0] = seed;
+	event.values[1] = (unsigned int)nrOfPlayers;
+	record(event);
+}
+
+void TerrainRecorder::recordDensities(int3 size, std::shared_ptr<const std::vector<unsigned char>> densities)
+{
+	Event event = makeEvent(Event_Densities);
+	event.position = float3((float)size.x, (float)size.y, (float)size.z);
+	event.densities = std::move(densities);
+	record(event);
+}
+
+void TerrainRecorder::recordEdit(EventType type, float3 position, float size0, float size1, float size2)
+{
+	Event event = makeEvent(type);
+	event.position = position;
+	event.sizes[0] = size0;
+	event.sizes[1] = size1;
+	event.sizes[2] = size2;
+	record(event);
+}
+
+void TerrainRecorder::recordRemesh(EventType type, float budget, bool async)
+{
+	Event event = makeEvent(type);
+	event.sizes[0] = budget;
+	event.values[0] = async ? 1 : 0;
+	record(event);
+}
+
+void TerrainRecorder::recordRaycast(EventType type, float3 position, float3 direction, float distance, bool hit)
+{
+	Event event = makeEvent(type);
+	event.position = position;
+	event.direction = direction;
+	event.sizes[0] = distance;
+	event.values[0] = hit ? 1 : 0;
+	record(event);
+}
+
+void TerrainRecorder::recordFindDecor(int collectionCount)
+{
+	Event event = makeEvent(Event_FindDecor);
+	event.values[0] = (unsigned int)collectionCount;
+	record(event);
+}
+
+void TerrainRecorder::recordFrame(float seconds)
+{
+	Event event = makeEvent(Event_Frame);
+	event.sizes[0] = seconds;
+	record(event);
+}
+
+bool TerrainRecorder::load(const std::string& path, std::vector<Event>& events)
+{
+	std::ifstream file(path, std::ios::binary);
+	char magic[4];
+	unsigned int version;
+	if (!file.read(magic, sizeof(magic)) || memcmp(magic, s_magic, sizeof(magic)) != 0 || !read(file, version) || version < 1 || version > s_version)
+		return false;
+
+	events.clear();
+	long long microseconds = 0;
+	unsigned char type;
+	while (read(file, type))
+	{
+		unsigned int delta;
+		if (type >= Event_TypeCount)
+			return false;
+		if (!read(file, delta))
+			break;
+		microseconds += delta;
+
+		Event event = makeEvent((EventType)type);
+		event.time = microseconds * 1e-6;
+		const EventLayout& layout = s_layouts[type];
+		bool complete = true;
+		if (layout.position)
+			complete &= read(file, event.position);
+		if (layout.direction)
+			complete &= read(file, event.direction);
+		for (int i = 0; i < layout.sizes; i++)
+			complete &= read(file, event.sizes[i]);
+		for (int i = 0; i < layout.values; i++)
+			complete &= read(file, event.values[i]);
+		if (complete && event.type == Event_Densities)
+		{
+			std::shared_ptr<std::vector<unsigned char>> densities = std::make_shared<std::vector<unsigned char>>((size_t)event.position.x * (size_t)event.position.y * (size_t)event.position.z);
+			complete = (bool)file.read((char*)densities->data(), densities->size());
+			event.densities = densities;
+		}
+		if (!complete)
+			break; // cut short by a crash, keep the events before it
+		events.push_back(event);
+	}
+	return true;
+}
+
+const char* TerrainRecorder::getEventName(EventType type)
+{
+	return type < Event_TypeCount ? s_layouts[type].name : "unknown";
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "VoxelTraits.h"
+
+/*
+Records what the game asks of the terrain, to replay a session without the game (see Benchmarks/TerrainReplay.cpp).
+Edits are recorded in data space and rays in local space, so a replay doesn't need the terrain's transform.
+The file is a header followed by events, each event is its type, the microseconds since the event before it and only the fields its type uses.
+A recording started on a terrain that already has data begins with its densities, so edits made before the recording replay too.
+*/
+class TerrainRecorder
+{
+public:
+	enum EventType : unsigned char {
+		Event_Init,				// position: data size. sizes[0]: scale. values: nrCubes, voxel format
+		Event_Generate,			// values: seed, nrOfPlayers. generateData_testCave
+		Event_DestroySphere,	// position. sizes: radius
+		Event_DamageSphere,		// position. sizes: radius, smoothing
+		Event_DamageCylinder,	// position. sizes: radius, height, strength
+		Event_RemeshAll,		// runAllMarchingCubes
+		Event_RemeshQueued,		// sizes[0]: remesh budget. values[0]: 1 if the game remeshed asynchronously
+		Event_LongRaycast,		// position, direction. sizes[0]: distance. values[0]: 1 if it hit
+		Event_ShortRaycast,		// as Event_LongRaycast
+		Event_Raycast,			// as Event_LongRaycast, raycast_localSpace picks the short or long raycast
+		Event_FindDecor,		// values[0]: collection count
+		Event_Frame,			// sizes[0]: frame time in seconds. Marks the end of a frame
+		Event_DensityRaycast,	// as Event_LongRaycast
+		Event_Densities,		// position: data size. Followed by the 8 bit densities of every cell, x fastest. setTerrainData
+		Event_TypeCount
+	};
+	struct Event {
+		EventType type;
+		double time;		// seconds since the recording started
+		float3 position;
+		float3 direction;
+		float sizes[3];
+		unsigned int values[2];
+		std::shared_ptr<const std::vector<unsigned char>> densities;	// Event_Densities only
+	};
+
+private:
+	std::ofstream m_file;
+	std::vector<char> m_buffer;		// events not written to the file yet
+	mutable std::mutex m_mutex;		// rays may be cast from several threads
+	std::chrono::steady_clock::time_point m_start;
+	long long m_lastMicroseconds = 0;
+
+	void flush();
+	// Writes what is left and closes the file, with m_mutex held
+	void close();
+
+public:
+	TerrainRecorder() = default;
+	~TerrainRecorder();
+
+	// Starts a new file, returns false if it can't be created
+	bool start(const std::string& path);
+	// Writes what is left and closes the file
+	void stop();
+	bool isRecording() const;
+
+	// Fields the event's type doesn't use are left out, the time is taken here
+	void record(Event event);
+	void recordInit(int3 size, float scale, int nrCubes, VoxelFormat format);
+	void recordGenerate(unsigned int seed, int nrOfPlayers);
+	void recordDensities(int3 size, std::shared_ptr<const std::vector<unsigned char>> densities);
+	void recordEdit(EventType type, float3 position, float size0, float size1 = 0, float size2 = 0);
+	void recordRemesh(EventType type, float budget = 0, bool async = false);
+	void recordRaycast(EventType type, float3 position, float3 direction, float distance, bool hit);
+	void recordFindDecor(int collectionCount);
+	void recordFrame(float seconds);
+
+	// Reads every event of a recording, returns false if the file can't be read or isn't a recording
+	static bool load(const std::string& path, std::vector<Event>& events);
+	static const char* getEventName(EventType type);
+};
@@ -0,0 +1,129 @@
+#include "pch.h"
+#include "TerrainTrace.h"
+
+std::atomic<bool> TerrainTrace::s_enabled(false);
+
+namespace
+{
+	struct TraceEvent {
+		const char* name;
+		long long begin;	// nanoseconds since the trace started
+		long long duration;
+		int3 chunk;
+		int triangles;
+	};
+
+	// Events of one thread. Its mutex is only contended while the trace is written
+	struct ThreadEvents {
+		std::mutex mutex;
+		std::vector<TraceEvent> events;
+		std::thread::id thread;
+		int index;
+		unsigned int generation;	// trace the events belong to, older events are dropped when the thread records again
+	};
+
+	std::mutex s_threadsMutex;
+	std::vector<std::unique_ptr<ThreadEvents>> s_threads;	// never shrinks, threads keep a pointer to theirs
+	std::atomic<std::chrono::steady_clock::rep> s_start(0);	// of the trace, in steady_clock ticks
+	std::thread::id s_mainThread;
+	std::atomic<unsigned int> s_generation(0);
+	thread_local ThreadEvents* t_events = nullptr;
+
+	ThreadEvents& getThreadEvents()
+	{
+		if (!t_events)
+		{
+			std::lock_guard<std::mutex> lock(s_threadsMutex);
+			s_threads.push_back(std::make_unique<ThreadEvents>());
+			t_events = s_threads.back().get();
+			t_events->thread = std::this_thread::get_id();
+			t_events->index = (int)s_threads.size();
+			t_events->generation = s_generation.load();
+		}
+		return *t_events;
+	}
+}
+
+void TerrainTrace::record(const char* name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end, int3 chunk, int triangles)
+{
+	ThreadEvents& thread = getThreadEvents();
+	std::lock_guard<std::mutex> lock(thread.mutex);
+	unsigned int generation = s_generation.load(std::memory_order_relaxed);
+	if (thread.generation != generation)
+	{
+		thread.events.clear();
+		thread.generation = generation;
+	}
+	std::chrono::steady_clock::time_point traceStart(std::chrono::steady_clock::duration(s_start.load(std::memory_order_relaxed)));
+	long long start = std::chrono::duration_cast<std::chrono::nanoseconds>(begin - traceStart).count();
+	long long duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+	thread.events.push_back({ name, start, duration, chunk, triangles });
+}
+
+void TerrainTrace::start()
+{
+	std::lock_guard<std::mutex> lock(s_threadsMutex);
+	s_enabled = false;
+	s_generation++;
+	s_start = std::chrono::steady_clock::now().time_since_epoch().count();
+	s_mainThread = std::this_thread::get_id();
+	s_enabled = true;
+}
+
+void TerrainTrace::stop()
+{
+	s_enabled = false;
+}
+
+size_t TerrainTrace::getEventCount()
+{
+	std::lock_guard<std::mutex> lock(s_threadsMutex);
+	unsigned int generation = s_generation.load();
+	size_t count = 0;
+	for (const std::unique_ptr<ThreadEvents>& thread : s_threads)
+	{
+		std::lock_guard<std::mutex> threadLock(thread->mutex);
+		if (thread->generation == generation)
+			count += thread->events.size();
+	}
+	return count;
+}
+
+bool TerrainTrace::write(const std::string& path)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	std::lock_guard<std::mutex> lock(s_threadsMutex);
+	unsigned int generation = s_generation.load();
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Terrain\"}}");
+	for (const std::unique_ptr<ThreadEvents>& thread : s_threads)
+	{
+		std::lock_guard<std::mutex> threadLock(thread->mutex);
+		if (thread->generation != generation || thread->events.empty())
+			continue;
+		bool main = (thread->thread == s_mainThread);
+		fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s%s\"}}", thread->index, main ? "main" : "worker ", main ? "" : std::to_string(thread->index).c_str());
+		fprintf(file, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}", thread->index, main ? 0 : thread->index);
+		for (const TraceEvent& event : thread->events)
+		{
+			// Chrome traces are in microseconds
+			fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"terrain\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", event.name, thread->index, event.begin * 1e-3, event.duration * 1e-3);
+			if (event.chunk.x >= 0 || event.triangles >= 0)
+			{
+				fprintf(file, ",\"args\":{");
+				if (event.chunk.x >= 0)
+					fprintf(file, "\"chunk\":\"%d %d %d\"%s", event.chunk.x, event.chunk.y, event.chunk.z, event.triangles >= 0 ? "," : "");
+				if (event.triangles >= 0)
+					fprintf(file, "\"triangles\":%d", event.triangles);
+				fprintf(file, "}");
+			}
+			fprintf(file, "}");
+		}
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
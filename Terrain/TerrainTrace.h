@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/*
+Timing of the terrain's work on every thread, written as a Chrome trace (chrome://tracing, ui.perfetto.dev).
+The engine's Profiler only sees the main thread, this also sees the remeshes on the thread pool, phase by phase.
+Scopes are recorded only between start and stop, otherwise a scope is a single relaxed load of a flag.
+Every thread keeps its own events, so recording threads never wait on each other.
+*/
+class TerrainTrace
+{
+private:
+	static std::atomic<bool> s_enabled;
+
+	static void record(const char* name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end, int3 chunk, int triangles);
+
+public:
+	// Times its lifetime as an event of the calling thread. The name must outlive the trace, string literals do
+	class Scope
+	{
+	private:
+		const char* m_name;
+		std::chrono::steady_clock::time_point m_begin;
+		int3 m_chunk;
+		int m_triangles = -1;
+	public:
+		Scope(const char* name, int3 chunk = int3(-1, -1, -1)) : m_name(nullptr)
+		{
+			if (isEnabled())
+			{
+				m_name = name;
+				m_chunk = chunk;
+				m_begin = std::chrono::steady_clock::now();
+			}
+		}
+		~Scope()
+		{
+			if (m_name)
+				record(m_name, m_begin, std::chrono::steady_clock::now(), m_chunk, m_triangles);
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+		// Attached to the event along with the chunk
+		void setTriangles(size_t triangles) { m_triangles = (int)triangles; }
+	};
+
+	static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+	// Drops the events of an earlier trace and starts recording. The calling thread is named main in the trace
+	static void start();
+	static void stop();
+	// Writes the events recorded so far as Chrome trace json, returns false if the file can't be written
+	static bool write(const std::string& path);
+	static size_t getEventCount();
+};
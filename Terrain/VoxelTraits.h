@@ -0,0 +1,161 @@
+#pragma once
+#include <cstring>
+
+/*
+Voxel formats the terrain data can be stored in, picked per map when the handler is initialized.
+Densities are always in [0, 255] with the surface at 126, whatever the format. 8 bits is the smallest,
+16 bits, half and float keep fractions so carving and smoothing don't step along the 8 bit grid.
+
+A traits type describes a format:
+	Type		what a brick cell holds
+	Sample		what the mesher reads from its voxel window, Type unless it can't be compared directly (half)
+	scale		samples per density unit, the surface value times scale is the surface in samples
+	toSample, toDensity, fromDensity	conversions, fromDensity clamps to [0, 255]
+*/
+enum VoxelFormat {
+	Voxel_UInt8,
+	Voxel_UInt16,
+	Voxel_Half,
+	Voxel_Float,
+	Voxel_FormatCount
+};
+
+// IEEE half precision, converted with round to nearest even. Densities are never negative, infinite or NaN
+namespace HalfFloat
+{
+	inline unsigned short fromFloat(float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		unsigned int sign = (bits >> 16) & 0x8000u;
+		int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+		unsigned int mantissa = bits & 0x7FFFFFu;
+		if (exponent <= 0)
+		{
+			if (exponent < -10)
+				return (unsigned short)sign;
+			// subnormal half
+			mantissa |= 0x800000u;
+			int shift = 14 - exponent;
+			unsigned int half = mantissa >> shift;
+			unsigned int rest = mantissa & ((1u << shift) - 1);
+			unsigned int halfway = 1u << (shift - 1);
+			if (rest > halfway || (rest == halfway && (half & 1)))
+				half++;
+			return (unsigned short)(sign | half);
+		}
+		if (exponent >= 31)
+			return (unsigned short)(sign | 0x7C00u);
+		unsigned int half = ((unsigned int)exponent << 10) | (mantissa >> 13);
+		unsigned int rest = mantissa & 0x1FFFu;
+		if (rest > 0x1000u || (rest == 0x1000u && (half & 1)))
+			half++; // may carry into the exponent, which is still the right rounding
+		return (unsigned short)(sign | half);
+	}
+
+	inline float toFloat(unsigned short half)
+	{
+		unsigned int sign = (unsigned int)(half & 0x8000u) << 16;
+		unsigned int exponent = (half >> 10) & 0x1F;
+		unsigned int mantissa = half & 0x3FFu;
+		unsigned int bits;
+		if (exponent == 0)
+		{
+			if (mantissa == 0)
+				bits = sign;
+			else
+			{
+				// normalize the subnormal
+				exponent = 127 - 15 + 1;
+				while (!(mantissa & 0x400u))
+				{
+					mantissa <<= 1;
+					exponent--;
+				}
+				bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+			}
+		}
+		else if (exponent == 31)
+			bits = sign | 0x7F800000u | (mantissa << 13);
+		else
+			bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+}
+
+inline float clampDensity(float density)
+{
+	return density < 0.f ? 0.f : (density > 255.f ? 255.f : density);
+}
+
+struct VoxelUInt8
+{
+	typedef unsigned char Type;
+	typedef unsigned char Sample;
+	static const VoxelFormat format = Voxel_UInt8;
+	static constexpr float scale = 1.f;
+	static const char* getName() { return "uint8"; }
+	static Sample toSample(Type value) { return value; }
+	static float toDensity(Type value) { return (float)value; }
+	static Type fromDensity(float density) { return (Type)clampDensity(density); } // truncates, like the casts edits have always used
+};
+
+struct VoxelUInt16
+{
+	typedef unsigned short Type;
+	typedef unsigned short Sample;
+	static const VoxelFormat format = Voxel_UInt16;
+	static constexpr float scale = 257.f; // 255 * 257 = 65535
+	static const char* getName() { return "uint16"; }
+	static Sample toSample(Type value) { return value; }
+	static float toDensity(Type value) { return value * (1.f / scale); }
+	static Type fromDensity(float density) { return (Type)(clampDensity(density) * scale + 0.5f); }
+};
+
+struct VoxelHalf
+{
+	typedef unsigned short Type;	// the half's bits
+	typedef float Sample;
+	static const VoxelFormat format = Voxel_Half;
+	static constexpr float scale = 1.f;
+	static const char* getName() { return "half"; }
+	static Sample toSample(Type value) { return HalfFloat::toFloat(value); }
+	static float toDensity(Type value) { return HalfFloat::toFloat(value); }
+	static Type fromDensity(float density) { return HalfFloat::fromFloat(clampDensity(density)); }
+};
+
+struct VoxelFloat
+{
+	typedef float Type;
+	typedef float Sample;
+	static const VoxelFormat format = Voxel_Float;
+	static constexpr float scale = 1.f;
+	static const char* getName() { return "float"; }
+	static Sample toSample(Type value) { return value; }
+	static float toDensity(Type value) { return value; }
+	static Type fromDensity(float density) { return clampDensity(density); }
+};
+
+// Calls function with a default constructed traits object of the format, returns what it returns
+template<typename Function>
+decltype(auto) dispatchVoxelFormat(VoxelFormat format, Function&& function)
+{
+	switch (format)
+	{
+	case Voxel_UInt16:
+		return function(VoxelUInt16());
+	case Voxel_Half:
+		return function(VoxelHalf());
+	case Voxel_Float:
+		return function(VoxelFloat());
+	default:
+		return function(VoxelUInt8());
+	}
+}
+
+inline const char* getVoxelFormatName(VoxelFormat format)
+{
+	return dispatchVoxelFormat(format, [](auto voxel) { return decltype(voxel)::getName(); });
+}
@@ -0,0 +1,19 @@
+#include "pch.h"
+#include "VoxelVolume.h"
+#include "DenseVolume.h"
+#include "BrickVolume.h"
+
+const char* getVoxelStorageName(VoxelStorage storage)
+{
+	return storage == Storage_Bricks ? "bricks" : "dense";
+}
+
+std::shared_ptr<VoxelVolume> createVoxelVolume(VoxelFormat format, VoxelStorage storage)
+{
+	return dispatchVoxelFormat(format, [&](auto voxel) -> std::shared_ptr<VoxelVolume>
+	{
+		if (storage == Storage_Bricks)
+			return std::make_shared<BrickVolume<decltype(voxel)>>();
+		return std::make_shared<DenseVolume<decltype(voxel)>>();
+	});
+}
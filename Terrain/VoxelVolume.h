@@ -0,0 +1,128 @@
+#pragma once
+#include <memory>
+#include "VoxelTraits.h"
+
+// How the cells of the terrain data are laid out, chosen at init
+enum VoxelStorage
+{
+	Storage_Dense,		// one array of every cell, x fastest, see DenseVolume
+	Storage_Bricks,		// 8x8x8 bricks, solid and air bricks stored as a single value, see BrickVolume
+	Storage_Count
+};
+
+const char* getVoxelStorageName(VoxelStorage storage);
+
+template<typename VoxelTraits> class DenseVolume;
+template<typename VoxelTraits> class BrickVolume;
+
+/*
+The terrain data whatever its voxel format and storage. Code that reads or writes many cells casts it to the volume class of its
+format and storage, see visitVoxelVolume. The density functions are for the odd cell, they convert to and from densities in [0, 255].
+*/
+class VoxelVolume
+{
+protected:
+	VoxelFormat m_format;
+	VoxelStorage m_storage;
+	int m_sizeX = 0;
+	int m_sizeY = 0;
+	int m_sizeZ = 0;
+	bool m_retireFreedBricks = false;
+
+	VoxelVolume(VoxelFormat format, VoxelStorage storage) : m_format(format), m_storage(storage) {}
+public:
+	virtual ~VoxelVolume() = default;
+
+	VoxelFormat getFormat() const;
+	VoxelStorage getStorage() const;
+	int getSizeX() const;
+	int getSizeY() const;
+	int getSizeZ() const;
+
+	virtual void fillDensity(float density) = 0;
+	// Copies a dense x-fastest array of 8 bit densities of the volume's size
+	virtual void loadDensities(const unsigned char* data) = 0;
+	// Copies the volume to a dense x-fastest array of its size, densities rounded to 8 bits
+	virtual void saveDensities(unsigned char* data) const = 0;
+	// Positions must be inside the volume
+	virtual float getDensity(int x, int y, int z) const = 0;
+	// Returns true if the stored value changed. Positions must be inside the volume
+	virtual bool setDensity(int x, int y, int z, float density) = 0;
+	virtual void compact() = 0;
+	// Makes compact retire the bricks it frees instead of reusing them, for readers on other threads. See BrickVolume::compact
+	void setRetireFreedBricks(bool retire);
+	// Returns the retired bricks to the pool, once no reader from before they were retired is left
+	virtual void releaseRetiredBricks() = 0;
+	virtual size_t getRetiredBrickCount() const = 0;
+	// Bricks are only counted by brick storage, dense storage returns 0
+	virtual size_t getBrickCount() const = 0;
+	virtual size_t getDenseBrickCount() const = 0;
+	// Bytes allocated for the cells and the tables that find them
+	virtual size_t getMemorySize() const = 0;
+};
+
+inline VoxelFormat VoxelVolume::getFormat() const
+{
+	return m_format;
+}
+
+inline VoxelStorage VoxelVolume::getStorage() const
+{
+	return m_storage;
+}
+
+inline int VoxelVolume::getSizeX() const
+{
+	return m_sizeX;
+}
+
+inline int VoxelVolume::getSizeY() const
+{
+	return m_sizeY;
+}
+
+inline int VoxelVolume::getSizeZ() const
+{
+	return m_sizeZ;
+}
+
+inline void VoxelVolume::setRetireFreedBricks(bool retire)
+{
+	m_retireFreedBricks = retire;
+}
+
+/*
+Calls function with the volume as the DenseVolume or BrickVolume of the voxel format Voxel, for code that already knows the format.
+Callers include DenseVolume.h and BrickVolume.h, the casts need the whole classes.
+*/
+template<typename Voxel, typename Function>
+decltype(auto) visitVoxelStorage(VoxelVolume& volume, Function&& function)
+{
+	if (volume.getStorage() == Storage_Bricks)
+		return function(static_cast<BrickVolume<Voxel>&>(volume));
+	return function(static_cast<DenseVolume<Voxel>&>(volume));
+}
+
+template<typename Voxel, typename Function>
+decltype(auto) visitVoxelStorage(const VoxelVolume& volume, Function&& function)
+{
+	if (volume.getStorage() == Storage_Bricks)
+		return function(static_cast<const BrickVolume<Voxel>&>(volume));
+	return function(static_cast<const DenseVolume<Voxel>&>(volume));
+}
+
+// Calls function with the volume as the volume class of its voxel format and storage
+template<typename Function>
+decltype(auto) visitVoxelVolume(VoxelVolume& volume, Function&& function)
+{
+	return dispatchVoxelFormat(volume.getFormat(), [&](auto voxel) -> decltype(auto) { return visitVoxelStorage<decltype(voxel)>(volume, function); });
+}
+
+template<typename Function>
+decltype(auto) visitVoxelVolume(const VoxelVolume& volume, Function&& function)
+{
+	return dispatchVoxelFormat(volume.getFormat(), [&](auto voxel) -> decltype(auto) { return visitVoxelStorage<decltype(voxel)>(volume, function); });
+}
+
+// Creates an empty volume of the format and storage
+std::shared_ptr<VoxelVolume> createVoxelVolume(VoxelFormat format, VoxelStorage storage);
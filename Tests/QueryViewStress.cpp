@@ -0,0 +1,125 @@
+/*
+Stress test of TerrainQueryView, readers on other threads query the latest view while the main thread edits and remeshes the terrain.
+The readers cast rays and read densities, the cells they read are being written by the edits. A view's epoch must never go back
+and every density must be in [0, 255]. Runs once for each storage of the terrain data, bricks also free and reuse cells. Meant to run under ThreadSanitizer, which reports the reads that race the edits:
+	cmake -S . -B build-tsan -DTERRAIN_TSAN=ON && cmake --build build-tsan && ctest --test-dir build-tsan
+Returns 0 when nothing went wrong, ThreadSanitizer fails the run itself when it found a race.
+*/
+#include "pch.h"
+#include "MarchingCubeTerrain.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+namespace
+{
+	const int SIZE = 64;
+	const int READERS = 3;
+	const int EDITS = 200;
+	const int QUERIES_PER_VIEW = 32;
+
+	struct ReaderResult
+	{
+		size_t views = 0;
+		size_t queries = 0;
+		size_t errors = 0;
+	};
+
+	void readViews(const MarchingCubeTerrain& terrain, const std::atomic<bool>& stop, unsigned int seed, ReaderResult& result)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		unsigned long long lastEpoch = 0;
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			std::shared_ptr<const TerrainQueryView> view = terrain.acquireQueryView();
+			if (!view)
+				continue;
+			if (view->getEpoch() < lastEpoch)
+			{
+				printf("view epoch went back from %llu to %llu\n", lastEpoch, view->getEpoch());
+				result.errors++;
+			}
+			lastEpoch = view->getEpoch();
+			result.views++;
+
+			for (int i = 0; i < QUERIES_PER_VIEW; i++)
+			{
+				float3 position(unit(random), unit(random), unit(random));
+				float3 direction(unit(random) - 0.5f, unit(random) - 0.5f, unit(random) - 0.5f);
+				direction.Normalize();
+				float distance = 1.f;
+				float3 intersectionPosition, intersectionNormal;
+				view->raycast_localSpace(position, direction, distance, intersectionPosition, intersectionNormal);
+
+				float3 dataPos = position * (float)SIZE;
+				float density = view->getTerrainValue_dataSpace(dataPos);
+				if (!(density >= 0.f && density <= 255.f))
+				{
+					printf("density %.2f at %.2f %.2f %.2f\n", density, dataPos.x, dataPos.y, dataPos.z);
+					result.errors++;
+				}
+				// interpolates the cells around the position, see TerrainQueryView::sampleDensity
+				float3 flow = view->getDataFieldFlow_dataSpace(dataPos);
+				if (!std::isfinite(flow.x) || !std::isfinite(flow.y) || !std::isfinite(flow.z))
+				{
+					printf("flow %.2f %.2f %.2f at %.2f %.2f %.2f\n", flow.x, flow.y, flow.z, dataPos.x, dataPos.y, dataPos.z);
+					result.errors++;
+				}
+				result.queries++;
+			}
+		}
+	}
+
+	// Returns the number of errors the readers found
+	size_t stressStorage(VoxelStorage storage)
+	{
+		MarchingCubeTerrain terrain;
+		terrain.init(SIZE, SIZE, SIZE, 16.f, 16, Voxel_UInt8, storage);
+		terrain.generateData_testCave(2, 1234);
+		terrain.runAllMarchingCubes();
+
+		std::atomic<bool> stop(false);
+		ReaderResult results[READERS];
+		std::vector<std::thread> readers;
+		for (int i = 0; i < READERS; i++)
+			readers.emplace_back(readViews, std::cref(terrain), std::cref(stop), 100u + i, std::ref(results[i]));
+
+		// edits on this thread, as the game makes them, each followed by the remesh that publishes a new view
+		std::mt19937 random(99);
+		std::uniform_real_distribution<float> cell(0.f, (float)SIZE);
+		for (int i = 0; i < EDITS; i++)
+		{
+			float3 position(cell(random), cell(random), cell(random));
+			if (i % 3 == 0)
+				terrain.destroySphere_dataSpace(position, 6.f);
+			else
+				terrain.damageSphere_dataSpace(position, 4.f);
+			terrain.runQueuedMarchingCubes();
+		}
+		stop = true;
+		for (std::thread& reader : readers)
+			reader.join();
+
+		ReaderResult total;
+		for (const ReaderResult& result : results)
+		{
+			total.views += result.views;
+			total.queries += result.queries;
+			total.errors += result.errors;
+		}
+		printf("%s storage: %d edits, %zu views and %zu queries read on %d threads, %zu errors\n", getVoxelStorageName(storage),
+			EDITS, total.views, total.queries, READERS, total.errors);
+		return total.errors;
+	}
+}
+
+int main()
+{
+	size_t errors = 0;
+	for (int storage = 0; storage < Storage_Count; storage++)
+		errors += stressStorage((VoxelStorage)storage);
+	return errors == 0 ? 0 : 1;
+}